@@ -0,0 +1,489 @@
+//==================================================================================================
+// compiledpattern.cpp
+//
+// Implementation of the CompiledPattern object and the pattern compiler that produces it.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "compiledpattern.h"
+#include "pathmatcher.h"
+#include "patterntokens.h"
+
+#include <cwctype>
+
+using namespace std;
+
+
+// =================================================================================================
+// Local Helper Functions
+// =================================================================================================
+
+namespace {
+
+    //----------------------------------------------------------------------------------------------
+    bool equalAt (wstring_view str, size_t offset, const wstring& lowerLiteral)
+    {
+        // Return true if the lowercase literal appears in the string at the given offset, compared
+        // without regard to case.
+
+        if (offset + lowerLiteral.size() > str.size())
+            return false;
+
+        for (size_t i = 0;  i < lowerLiteral.size();  ++i) {
+            if (static_cast<wchar_t>(towlower(str[offset + i])) != lowerLiteral[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool expandAlternation (wstring_view pattern, size_t limit, vector<wstring>& result)
+    {
+        // Expand a pattern of plain literals and brace groups into the full list of strings it
+        // matches. Returns false if the expansion would exceed the given limit.
+
+        result.assign(1, wstring{});
+
+        for (size_t i = 0;  i < pattern.size();  ++i) {
+            auto groupLength = PathMatch::braceGroupLength(pattern, i);
+
+            if (!groupLength) {
+                for (auto& str : result)
+                    str += pattern[i];
+                continue;
+            }
+
+            // Split the group at its top-level commas, and expand each alternative in turn.
+
+            vector<wstring> groupStrings;
+            auto group = pattern.substr(i + 1, groupLength - 2);
+            size_t altStart = 0;
+
+            for (size_t j = 0;  j <= group.size();  ++j) {
+                if (j < group.size()) {
+                    if (auto nestedLength = PathMatch::braceGroupLength(group, j)) {
+                        j += nestedLength - 1;
+                        continue;
+                    }
+                    if (group[j] != L',')
+                        continue;
+                }
+
+                vector<wstring> altStrings;
+                if (!expandAlternation(group.substr(altStart, j - altStart), limit, altStrings))
+                    return false;
+                groupStrings.insert(groupStrings.end(), altStrings.begin(), altStrings.end());
+                altStart = j + 1;
+            }
+
+            if (result.size() * groupStrings.size() > limit)
+                return false;
+
+            vector<wstring> product;
+            product.reserve(result.size() * groupStrings.size());
+            for (const auto& head : result) {
+                for (const auto& tail : groupStrings)
+                    product.push_back(head + tail);
+            }
+
+            result.swap(product);
+            i += groupLength - 1;
+        }
+
+        return true;
+    }
+}
+
+
+// =================================================================================================
+// PathMatch Namespace
+// =================================================================================================
+
+namespace PathMatch {
+
+//--------------------------------------------------------------------------------------------------
+wstring lowercase (wstring_view str)
+{
+    wstring result { str };
+    for (auto& c : result)
+        c = static_cast<wchar_t>(towlower(c));
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+const wchar_t* engineName (MatchEngine engine)
+{
+    switch (engine) {
+        case MatchEngine::Recursive:  return L"recursive";
+        case MatchEngine::Reverse:    return L"reverse";
+        case MatchEngine::ShiftAnd:   return L"shift-and";
+        case MatchEngine::LazyDfa:    return L"lazy-dfa";
+        case MatchEngine::LiteralSet: return L"literal-set";
+    }
+    return L"?";
+}
+
+
+//==================================================================================================
+// LiteralFilter
+//==================================================================================================
+
+bool LiteralFilter::isTrivial() const
+{
+    return prefix.empty() && suffix.empty() && literals.empty()
+        && (minLength == 0) && (maxLength == SIZE_MAX);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool LiteralFilter::passes (wstring_view str) const
+{
+    // Test the length bounds first, as they're the cheapest, and then the anchored literals. The
+    // interior literals must then appear in order, between the prefix and the suffix.
+
+    if (str.size() < minLength || str.size() > maxLength)
+        return false;
+
+    if (!equalAt(str, 0, prefix) || !equalAt(str, str.size() - suffix.size(), suffix))
+        return false;
+
+    auto position = prefix.size();
+    auto end      = str.size() - suffix.size();
+
+    for (const auto& literal : literals) {
+        for (;;) {
+            if (position + literal.size() > end)
+                return false;
+            if (equalAt(str, position, literal))
+                break;
+            ++position;
+        }
+        position += literal.size();
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+LiteralFilter extractLiteralFilter (wstring_view pattern)
+{
+    // Scan the pattern for runs of literal characters. A run that opens the pattern is a required
+    // prefix, a run that closes the pattern is a required suffix, and all others must appear in
+    // between, in order.
+    //
+    // The minimum length counts every literal, '?' and [class] character, plus every slash except
+    // those immediately following a multi-character wildcard (because "*/" and ".../" may match
+    // the empty string). Since repeated slashes in a path compare as a single slash, the maximum
+    // length is bounded only for patterns with neither wildcards nor slashes. Brace groups are
+    // skipped whole: nothing inside them is required, and they leave the length unbounded.
+
+    LiteralFilter filter;
+
+    auto tokens = tokenizePattern(pattern).tokens;
+    if (tokens.empty())
+        return filter;
+
+    vector<wstring> runs;
+    wstring run;
+    bool runAtStart  = false;
+    bool bounded     = true;
+    size_t minLength = 0;
+
+    for (size_t i = 0;  i < tokens.size();  ++i) {
+        auto& token = tokens[i];
+
+        if (token.type == TokenType::Literal) {
+            if (i == 0)
+                runAtStart = true;
+            run += token.ch;
+            ++minLength;
+            continue;
+        }
+
+        if (!run.empty()) {
+            runs.push_back(run);
+            run.clear();
+        }
+
+        if (token.type == TokenType::AnyChar || token.type == TokenType::Class) {
+            ++minLength;
+        } else if (token.type == TokenType::Slash) {
+            bounded = false;
+            if (i == 0 || !isMultiWild(tokens[i-1].type))
+                ++minLength;
+        } else if (token.type == TokenType::GroupOpen) {
+            bounded = false;
+            for (int depth = 1;  depth > 0;  ) {
+                auto type = tokens[++i].type;
+                if (type == TokenType::GroupOpen)
+                    ++depth;
+                else if (type == TokenType::GroupClose)
+                    --depth;
+            }
+        } else {
+            bounded = false;
+        }
+    }
+
+    auto runAtEnd = !run.empty();
+    if (runAtEnd)
+        runs.push_back(run);
+
+    // A run both at start and end means the pattern is one pure literal; treat it as a prefix.
+
+    size_t first = 0;
+    size_t last  = runs.size();
+
+    if (runAtStart && !runs.empty()) {
+        filter.prefix = runs[first++];
+    }
+
+    if (runAtEnd && first < last) {
+        filter.suffix = runs[--last];
+    }
+
+    filter.literals.assign(runs.begin() + first, runs.begin() + last);
+    filter.minLength = minLength;
+    filter.maxLength = bounded ? minLength : SIZE_MAX;
+
+    return filter;
+}
+
+
+//==================================================================================================
+// PrefilterCounters
+//==================================================================================================
+
+PrefilterCounters& PrefilterCounters::operator+= (const PrefilterCounters& other)
+{
+    tested      += other.tested;
+    rejected    += other.rejected;
+    fullTests   += other.fullTests;
+    fullMatches += other.fullMatches;
+    return *this;
+}
+
+
+//==================================================================================================
+// CompiledPattern
+//==================================================================================================
+
+CompiledPattern::CompiledPattern (
+    const wstring&        pattern,
+    optional<MatchEngine> engine,
+    size_t                dfaMemoryLimit)
+  : m_source(pattern)
+{
+    m_pathFilter = extractLiteralFilter(pattern);
+    m_filtered   = !m_pathFilter.isTrivial();
+
+    // Select the full match engine. Patterns that begin with an ellipsis and contain no other
+    // multi-character wildcard are anchored at the end of the path. These can be matched right to
+    // left from the end of the path in time proportional to the length of the pattern tail, rather
+    // than trying the tail at every offset of the path. Other short patterns go to the Shift-And
+    // engine, and longer patterns (or those with brace alternations) to the lazy DFA. The
+    // recursive engine understands neither character classes nor brace groups, so patterns with
+    // those always get an automaton.
+
+    auto compiled = tokenizePattern(pattern);
+    const auto& tokens = compiled.tokens;
+
+    m_literal = true;
+    for (const auto& token : tokens) {
+        m_literal = m_literal && (token.type == TokenType::Literal);
+        m_spansDirectories = m_spansDirectories || (token.type == TokenType::Ellipsis)
+                          || (token.type == TokenType::Slash);
+    }
+
+    auto needsAutomaton = compiled.hasAlternation || !compiled.classes.empty();
+
+    auto useEngine = [&](MatchEngine candidate) {
+        return !engine || (*engine == candidate);
+    };
+
+    // Alternations of plain literals within a single path segment (such as "{a1,a2,...,a5000}")
+    // are expanded into a hash set, so each candidate costs one lookup regardless of the number
+    // of alternatives.
+
+    auto plainAlternation = compiled.hasAlternation;
+    for (const auto& token : tokens) {
+        plainAlternation = plainAlternation
+                        && (token.type == TokenType::Literal || isGroupMarker(token.type));
+    }
+
+    if (useEngine(MatchEngine::LiteralSet) && plainAlternation) {
+        auto literalSet = make_shared<LiteralSet>();
+        if (expandAlternation(pattern, mc_MaxLiteralSetSize, literalSet->names)) {
+            erase_if(literalSet->names, [&](const wstring& name) {
+                return !literalSet->lowercase.insert(lowercase(name)).second;
+            });
+            for (const auto& name : literalSet->names) {
+                literalSet->minLength = min(literalSet->minLength, name.size());
+                literalSet->maxLength = max(literalSet->maxLength, name.size());
+            }
+            m_engine     = MatchEngine::LiteralSet;
+            m_literalSet = literalSet;
+            return;
+        }
+    }
+
+    if (useEngine(MatchEngine::Reverse) && !tokens.empty() && tokens[0].type == TokenType::Ellipsis) {
+        auto anchored = true;
+        wstring tail;
+
+        for (size_t i = 1;  anchored && i < tokens.size();  ++i) {
+            switch (tokens[i].type) {
+                case TokenType::Literal: tail += tokens[i].ch; break;
+                case TokenType::AnyChar: tail += L'?';         break;
+                case TokenType::Slash:   tail += L'/';         break;
+                default:                 anchored = false;     break;
+            }
+        }
+
+        if (anchored) {
+            m_engine = MatchEngine::Reverse;
+            m_reverseTail.assign(tail.rbegin(), tail.rend());
+            return;
+        }
+    }
+
+    if (useEngine(MatchEngine::ShiftAnd) && !tokens.empty() && m_shiftAnd.compile(compiled)) {
+        m_engine = MatchEngine::ShiftAnd;
+        return;
+    }
+
+    if ((useEngine(MatchEngine::LazyDfa) || needsAutomaton) && !tokens.empty()) {
+        m_engine  = MatchEngine::LazyDfa;
+        m_lazyDfa = make_shared<const PathMatch::LazyDfa>(compiled, dfaMemoryLimit);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool CompiledPattern::reverseMatch (wstring_view path) const
+{
+    // Match the reversed pattern tail against the path, walking backward from the end of the path.
+    // Once the tail is consumed, the leading ellipsis matches whatever remains. A slash in the tail
+    // consumes a whole run of path slashes. A slash that immediately follows the ellipsis may also
+    // match the empty string, but only at the very start of the path (".../foo" matches "foo" but
+    // not "xfoo").
+
+    auto i = path.size();
+
+    for (size_t j = 0;  j < m_reverseTail.size();  ++j) {
+        auto c = m_reverseTail[j];
+
+        if (c == L'/') {
+            if (i == 0 && j + 1 == m_reverseTail.size())
+                return true;
+            if (i == 0 || !isSlashChar(path[i-1]))
+                return false;
+            while (i > 0 && isSlashChar(path[i-1]))
+                --i;
+        } else {
+            if (i == 0 || isSlashChar(path[i-1]))
+                return false;
+            if (c != L'?' && static_cast<wchar_t>(towlower(path[i-1])) != c)
+                return false;
+            --i;
+        }
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool CompiledPattern::literalSetMatch (wstring_view path) const
+{
+    // Look up the lowercase path in the set of alternatives. Paths outside the range of
+    // alternative lengths are rejected before paying for the lowercase copy and hash.
+
+    if (path.size() < m_literalSet->minLength || path.size() > m_literalSet->maxLength)
+        return false;
+
+    thread_local wstring lowerPath;
+    lowerPath.assign(path);
+    for (auto& c : lowerPath)
+        c = static_cast<wchar_t>(towlower(c));
+
+    return m_literalSet->lowercase.contains(lowerPath);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool CompiledPattern::matches (const wchar_t* path, size_t length, PrefilterCounters& counters) const
+{
+    // Run the cheap prefilter first, and only if the path survives perform the full match. The
+    // reverse and literal set engines are themselves no more expensive than the prefilter, so they
+    // skip that stage.
+
+    ++counters.tested;
+
+    if (m_engine == MatchEngine::Reverse || m_engine == MatchEngine::LiteralSet) {
+        ++counters.fullTests;
+        auto matched = (m_engine == MatchEngine::Reverse)
+                     ? reverseMatch({path, length})
+                     : literalSetMatch({path, length});
+        if (!matched)
+            return false;
+        ++counters.fullMatches;
+        return true;
+    }
+
+    if (m_filtered && !m_pathFilter.passes({path, length})) {
+        ++counters.rejected;
+        return false;
+    }
+
+    ++counters.fullTests;
+
+    bool matched;
+
+    switch (m_engine) {
+        case MatchEngine::ShiftAnd: matched = m_shiftAnd.matches({path, length}); break;
+        case MatchEngine::LazyDfa:  matched = m_lazyDfa->matches({path, length});  break;
+        default:                    matched = pathMatch(m_source.c_str(), path);   break;
+    }
+
+    if (!matched)
+        return false;
+
+    ++counters.fullMatches;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool CompiledPattern::matches (const wstring& path) const
+{
+    PrefilterCounters counters;
+    return matches(path.c_str(), path.size(), counters);
+}
+
+
+}; // Namespace PathMatch
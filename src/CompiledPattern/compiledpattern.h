@@ -0,0 +1,197 @@
+#ifndef _INCLUDED_COMPILEDPATTERN_H
+//==================================================================================================
+// compiledpattern.h
+//
+// Declarations for the CompiledPattern object. A CompiledPattern is a path match pattern (using the
+// special operators '?', '*', '**', '...', '[...]' and '{...,...}') that has been analyzed once up
+// front, so that it can be tested cheaply against many candidate paths.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_COMPILEDPATTERN_H
+
+
+#include "lazydfa.h"
+#include "shiftandmatcher.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+// Returns a lowercase copy of the given string. Path matching is case-insensitive, so all literals
+// extracted by the pattern compiler are stored in lowercase.
+std::wstring lowercase (std::wstring_view str);
+
+
+struct LiteralFilter
+{
+    //----------------------------------------------------------------------------------------------
+    // A LiteralFilter holds necessary (but not sufficient) conditions that a string must satisfy in
+    // order to match a pattern: its length bounds, and the literal runs that must appear in it. A
+    // string that fails the filter can never match the pattern; a string that passes the filter
+    // must still be confirmed with a full match.
+    //----------------------------------------------------------------------------------------------
+
+    std::wstring              prefix;                // Required leading literal (lowercase)
+    std::wstring              suffix;                // Required trailing literal (lowercase)
+    std::vector<std::wstring> literals;              // Required interior literals, in order
+    size_t                    minLength {0};         // Minimum string length
+    size_t                    maxLength {SIZE_MAX};  // Maximum string length (SIZE_MAX: unbounded)
+
+    // True if the filter accepts every string, and so isn't worth running.
+    bool isTrivial() const;
+
+    // True if the given string satisfies all filter conditions (compared without regard to case).
+    bool passes (std::wstring_view str) const;
+};
+
+// Extract the literal filter for the given pattern. The pattern may be a full path pattern, or a
+// single normalized path component (where U+2026 denotes an ellipsis).
+LiteralFilter extractLiteralFilter (std::wstring_view pattern);
+
+
+struct PrefilterCounters
+{
+    // Hit-rate counters for the prefilter stage that precedes full pattern matching.
+
+    uint64_t tested {0};       // Candidates tested against a prefilter
+    uint64_t rejected {0};     // Candidates rejected by the prefilter alone
+    uint64_t fullTests {0};    // Candidates that required a full pattern match
+    uint64_t fullMatches {0};  // Candidates that passed the full pattern match
+
+    PrefilterCounters& operator+= (const PrefilterCounters& other);
+};
+
+
+// The engines a CompiledPattern can use to perform a full match.
+enum class MatchEngine
+{
+    Recursive,   // General recursive matcher (pathMatch)
+    Reverse,     // Suffix-anchored: leading ellipsis, then no multi-character wildcards
+    ShiftAnd,    // Bit-parallel automaton, for patterns of up to ShiftAndMatcher::mc_MaxTokens
+    LazyDfa,     // Deterministic automaton built on demand, shared across threads
+    LiteralSet   // Hash lookup, for brace alternations of plain literals within one path segment
+};
+
+// Returns the short name of the given engine, for reports.
+const wchar_t* engineName (MatchEngine engine);
+
+
+class CompiledPattern
+{
+    //----------------------------------------------------------------------------------------------
+    // A CompiledPattern holds a path match pattern together with the information extracted from it
+    // by the pattern compiler: a literal prefilter for the whole path, and the cheapest engine able
+    // to perform the full match. A traversal compiles each directory-level pattern component on
+    // its own, so each level gets its own prefilter.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    CompiledPattern() = default;
+
+    // Compile the given pattern. By default the compiler picks the cheapest engine that can handle
+    // the pattern. A specific engine may be requested instead (mostly for testing and benchmarks);
+    // if that engine can't handle the pattern, the recursive engine is used. The DFA memory limit
+    // bounds the transition cache of the lazy DFA engine.
+    explicit CompiledPattern (
+        const std::wstring&        pattern,
+        std::optional<MatchEngine> engine = std::nullopt,
+        size_t                     dfaMemoryLimit = LazyDfa::mc_DefaultMemoryLimit);
+
+    // The original pattern string.
+    const std::wstring& source() const { return m_source; }
+
+    // The prefilter for entire candidate paths.
+    const LiteralFilter& pathFilter() const { return m_pathFilter; }
+
+    // The engine selected to perform full matches.
+    MatchEngine engine() const { return m_engine; }
+
+    // True if the pattern has no special operators, and so matches only its own text (ignoring
+    // case).
+    bool isLiteral() const { return m_literal; }
+
+    // True if the pattern can match across directory levels: it contains an ellipsis or a slash
+    // (for a single normalized path component, a slash can only come from a brace group).
+    bool spansDirectories() const { return m_spansDirectories; }
+
+    // The lazy DFA, if that engine was selected, otherwise null. Copies of a CompiledPattern share
+    // the same DFA, so its cache warms up once no matter how many threads or copies use it.
+    const LazyDfa* lazyDfa() const { return m_lazyDfa.get(); }
+
+    // The expanded alternatives (in their original case, without duplicates), if the literal set
+    // engine was selected, otherwise null. Since these are the only strings the pattern can match,
+    // a small set may be probed for directly rather than matched against every directory entry.
+    const std::vector<std::wstring>* literalAlternatives() const {
+        return m_literalSet ? &m_literalSet->names : nullptr;
+    }
+
+    // Alternations that expand to more than this many literals are left to the lazy DFA.
+    static const size_t mc_MaxLiteralSetSize = 1 << 16;
+
+    // Returns true if the given null-terminated path of the given length matches the pattern,
+    // updating the given counters.
+    bool matches (const wchar_t* path, size_t length, PrefilterCounters& counters) const;
+    bool matches (const std::wstring& path) const;
+
+  private:
+
+    struct LiteralSet
+    {
+        std::vector<std::wstring>        names;       // Alternatives, in original case
+        std::unordered_set<std::wstring> lowercase;   // Alternatives, in lowercase
+        size_t minLength {SIZE_MAX};                  // Length of the shortest alternative
+        size_t maxLength {0};                         // Length of the longest alternative
+    };
+
+    bool reverseMatch (std::wstring_view path) const;
+    bool literalSetMatch (std::wstring_view path) const;
+
+    std::wstring               m_source;            // Original pattern string
+    bool                       m_filtered {false};  // True if the path filter is non-trivial
+    LiteralFilter              m_pathFilter;        // Whole-path prefilter
+    bool                       m_literal {false};   // True if the pattern is a plain literal
+    bool                       m_spansDirectories {false};  // True if matches may span directories
+
+    MatchEngine     m_engine {MatchEngine::Recursive};  // Full match engine
+    ShiftAndMatcher m_shiftAnd;     // Shift-And engine tables
+    std::shared_ptr<const PathMatch::LazyDfa> m_lazyDfa;   // Lazy DFA engine
+    std::shared_ptr<const LiteralSet> m_literalSet;        // Literal set engine
+    std::wstring    m_reverseTail;  // Reverse engine: pattern tail after the ellipsis, reversed,
+                                    // with '/' for a run of slashes, '?' for any character, and
+                                    // lowercase literals otherwise.
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_COMPILEDPATTERN_H
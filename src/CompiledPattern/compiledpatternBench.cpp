@@ -0,0 +1,158 @@
+//==================================================================================================
+// compiledpatternBench.cpp
+//
+// Head-to-head timing of the CompiledPattern match engines. Each pattern is compiled once for each
+// engine that can handle it, and then timed against the same set of candidate paths.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include <compiledpattern.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace PathMatch;
+
+
+static const wstring benchPatterns[] {
+    L"....obj",
+    L"...*Test.cpp",
+    L".../include/?.h",
+    L"src/.../*Test.cpp",
+    L"...cache...tmp",
+    L"*/*/*.h",
+    L"a*a*a*a*a*a*b",
+    L"...a...a...a...b",
+    L"{README,TODO}.md",
+};
+
+static const wstring benchPaths[] {
+    L"pathmatch.obj",
+    L"build/Release/pathmatch.obj",
+    L"src/PathMatcher/pathmatcherTest.cpp",
+    L"src/PathMatcher/pathmatcher.cpp",
+    L"src/CompiledPattern/compiledpattern.h",
+    L"third_party/boost/libs/filesystem/include/boost/filesystem/path.h",
+    L"out/cache/objects/12/34/5678/tmp",
+    L"Users/someone/AppData/Local/Temp/cache.tmp",
+    L"docs/README.md",
+    L"README.md",
+    L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaac",
+    L"a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/c",
+};
+
+
+//--------------------------------------------------------------------------------------------------
+double nsPerMatch (const CompiledPattern& pattern, int& matchCount)
+{
+    // Returns the average time in nanoseconds to test one path against the given pattern.
+
+    const int iterations = 20000;
+
+    PrefilterCounters counters;
+    matchCount = 0;
+
+    auto start = chrono::steady_clock::now();
+
+    for (int i = 0;  i < iterations;  ++i) {
+        for (const auto& path : benchPaths)
+            matchCount += pattern.matches(path.c_str(), path.size(), counters);
+    }
+
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+
+    matchCount /= iterations;
+    return elapsed / (double(iterations) * size(benchPaths));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void benchSharedDfa (int threadCount)
+{
+    // Time one lazy DFA pattern shared by several threads, and report how many transitions had to
+    // be computed. With a shared cache, the miss count is independent of the thread count.
+
+    wcout << L"\nShared lazy DFA, " << threadCount << L" threads\n";
+    wcout << left << setw(22) << L"Pattern" << right << setw(10) << L"ns/match" << setw(10)
+          << L"states" << setw(10) << L"misses" << L'\n';
+
+    for (const auto& patternString : benchPatterns) {
+        CompiledPattern pattern (patternString, MatchEngine::LazyDfa);
+
+        auto start = chrono::steady_clock::now();
+
+        vector<thread> threads;
+        for (int t = 0;  t < threadCount;  ++t) {
+            threads.emplace_back([&pattern] {
+                int matchCount;
+                nsPerMatch(pattern, matchCount);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        auto stats = pattern.lazyDfa()->stats();
+
+        wcout << left << setw(22) << patternString << right << setw(10) << fixed << setprecision(1)
+              << elapsed / (20000.0 * size(benchPaths) * threadCount)
+              << setw(10) << stats.states << setw(10) << stats.misses << L'\n';
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main()
+{
+    const MatchEngine engines[] {
+        MatchEngine::Recursive, MatchEngine::Reverse, MatchEngine::ShiftAnd, MatchEngine::LazyDfa,
+        MatchEngine::LiteralSet
+    };
+
+    wcout << left << setw(22) << L"Pattern" << setw(12) << L"Engine"
+          << right << setw(10) << L"ns/match" << setw(10) << L"matches" << L'\n';
+
+    for (const auto& patternString : benchPatterns) {
+        for (auto engine : engines) {
+            CompiledPattern pattern (patternString, engine);
+
+            if (pattern.engine() != engine)
+                continue;   // This engine can't handle the pattern.
+
+            int matchCount;
+            auto ns = nsPerMatch(pattern, matchCount);
+
+            wcout << left << setw(22) << patternString << setw(12) << engineName(engine)
+                  << right << setw(10) << fixed << setprecision(1) << ns
+                  << setw(10) << matchCount << L'\n';
+        }
+    }
+
+    benchSharedDfa (4);
+}
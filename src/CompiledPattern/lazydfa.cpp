@@ -0,0 +1,224 @@
+//==================================================================================================
+// lazydfa.cpp
+//
+// Implementation of the LazyDfa object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "lazydfa.h"
+
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+
+namespace PathMatch {
+
+//--------------------------------------------------------------------------------------------------
+size_t LazyDfa::StateSetHash::operator() (const PatternNfa::StateSet& states) const
+{
+    size_t hash = states.size();
+    for (auto state : states)
+        hash = (hash * 0x100000001b3ull) ^ state;
+    return hash;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+LazyDfa::LazyDfa (const PatternTokens& pattern, size_t memoryLimit)
+  : m_memoryLimit(memoryLimit)
+{
+    m_nfa.build(pattern);
+
+    // Cap the state table at the most states that could fit in the memory limit. Every state costs
+    // at least its own structure plus its transition slots. Most patterns need only a handful of
+    // states, so the table starts small and grows toward the cap as states are added.
+
+    auto minStateBytes = sizeof(State) + m_nfa.classCount() * sizeof(atomic<uint32_t>);
+    m_capacity = min<size_t>(max<size_t>(2, m_memoryLimit / minStateBytes), mc_Unknown);
+
+    addState({});                     // State 0 is the dead state.
+    m_start = addState(m_nfa.startSet());
+}
+
+
+//--------------------------------------------------------------------------------------------------
+LazyDfa::~LazyDfa()
+{
+    auto count = m_stateCount.load();
+    for (uint32_t i = 0;  i < count;  ++i)
+        delete stateSlot(i).load();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+atomic<LazyDfa::State*>& LazyDfa::stateSlot (uint32_t index) const
+{
+    // Return the state table slot for the given index. Block b holds mc_FirstBlockSize << b slots,
+    // starting at index mc_FirstBlockSize * (2^b - 1).
+
+    auto block = bit_width(index / mc_FirstBlockSize + 1) - 1;
+    auto first = mc_FirstBlockSize * ((uint32_t{1} << block) - 1);
+
+    return m_blocks[block][index - first];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+uint32_t LazyDfa::addState (PatternNfa::StateSet&& nfaStates) const
+{
+    // Return the index of the DFA state for the given NFA state set, adding it to the cache if
+    // needed. Returns mc_Unknown if the state is new but the cache is full.
+
+    lock_guard<mutex> lock (m_mutex);
+
+    auto existing = m_index.find(nfaStates);
+    if (existing != m_index.end())
+        return existing->second;
+
+    auto classes = m_nfa.classCount();
+    auto bytes   = sizeof(State) + classes * sizeof(atomic<uint32_t>)
+                 + 2 * nfaStates.size() * sizeof(uint32_t)    // State set, and its index key
+                 + 4 * sizeof(void*);                         // Index node overhead
+
+    auto index = m_stateCount.load(memory_order_relaxed);
+
+    if (index >= 2 && (index >= m_capacity || m_bytes.load(memory_order_relaxed) + bytes > m_memoryLimit))
+        return mc_Unknown;
+
+    // Add a block to the state table when the last one is full. The final block is cut short at the
+    // capacity.
+
+    auto block = bit_width(index / mc_FirstBlockSize + 1) - 1;
+    if (!m_blocks[block]) {
+        auto first = mc_FirstBlockSize * ((size_t{1} << block) - 1);
+        auto size  = min<size_t>(size_t{mc_FirstBlockSize} << block, m_capacity - first);
+        m_blocks[block] = make_unique<atomic<State*>[]>(size);
+    }
+
+    auto state = new State;
+    state->accepting = m_nfa.accepts(nfaStates);
+    state->nfaStates = std::move(nfaStates);
+    state->next      = make_unique<atomic<uint32_t>[]>(classes);
+
+    // The dead state transitions only to itself.
+
+    for (uint32_t cls = 0;  cls < classes;  ++cls)
+        state->next[cls].store(state->nfaStates.empty() ? mc_Dead : mc_Unknown, memory_order_relaxed);
+
+    m_index.emplace(state->nfaStates, index);
+    m_bytes.fetch_add(bytes, memory_order_relaxed);
+
+    // Publish the fully constructed state before publishing the new count.
+
+    stateSlot(index).store(state, memory_order_release);
+    m_stateCount.store(index + 1, memory_order_release);
+
+    return index;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+uint32_t LazyDfa::transition (const State& state, uint32_t cls) const
+{
+    // Return the target state index for the given transition, computing and caching it on a miss.
+    // Two threads may race to compute the same transition; both arrive at the same target state,
+    // so the duplicate store is harmless.
+
+    auto target = state.next[cls].load(memory_order_acquire);
+    if (target != mc_Unknown)
+        return target;
+
+    m_misses.fetch_add(1, memory_order_relaxed);
+
+    PatternNfa::StateSet targetStates;
+    m_nfa.step(state.nfaStates, cls, targetStates);
+
+    target = addState(std::move(targetStates));
+    if (target != mc_Unknown)
+        state.next[cls].store(target, memory_order_release);
+
+    return target;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool LazyDfa::simulate (PatternNfa::StateSet states, wstring_view rest) const
+{
+    // Match the rest of a path by direct NFA simulation, without touching the cache.
+
+    m_fallbacks.fetch_add(1, memory_order_relaxed);
+
+    PatternNfa::StateSet next;
+
+    for (auto c : rest) {
+        m_nfa.step(states, m_nfa.charClass(c), next);
+        if (next.empty())
+            return false;
+        states.swap(next);
+    }
+
+    return m_nfa.accepts(states);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool LazyDfa::matches (wstring_view path) const
+{
+    auto state = stateSlot(m_start).load(memory_order_acquire);
+
+    for (size_t i = 0;  i < path.size();  ++i) {
+        auto target = transition(*state, m_nfa.charClass(path[i]));
+
+        if (target == mc_Dead)
+            return false;
+
+        if (target == mc_Unknown) {
+            // The cache is full. Finish this path by simulating the NFA from this character.
+            PatternNfa::StateSet next;
+            m_nfa.step(state->nfaStates, m_nfa.charClass(path[i]), next);
+            return simulate(std::move(next), path.substr(i + 1));
+        }
+
+        state = stateSlot(target).load(memory_order_acquire);
+    }
+
+    return state->accepting;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+LazyDfa::Stats LazyDfa::stats() const
+{
+    return {
+        m_stateCount.load(),
+        m_bytes.load(),
+        m_misses.load(),
+        m_fallbacks.load()
+    };
+}
+
+
+}; // Namespace PathMatch
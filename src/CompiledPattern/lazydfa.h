@@ -0,0 +1,137 @@
+#ifndef _INCLUDED_LAZYDFA_H
+//==================================================================================================
+// lazydfa.h
+//
+// Declarations for the LazyDfa object, a deterministic automaton for a path match pattern that is
+// built on demand and shared by all threads matching against the same compiled pattern.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_LAZYDFA_H
+
+
+#include "patternnfa.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+class LazyDfa
+{
+    //----------------------------------------------------------------------------------------------
+    // The LazyDfa determinizes a PatternNfa one transition at a time, as paths exercise it. Each
+    // DFA state stands for a set of NFA states, and holds one transition slot per character
+    // class.
+    //
+    // Transitions that have been seen before are followed with a single atomic load and no locks.
+    // This is the common case once the automaton has warmed up. On a miss, the thread computes the
+    // target NFA state set itself, and takes a lock only to add the new state to the shared cache.
+    // States are never freed or moved while the LazyDfa lives, so readers never see a dangling
+    // state.
+    //
+    // The cache is bounded by a memory limit. Once the limit is reached no new states are added,
+    // and a match that needs an uncached state falls back to simulating the NFA directly for the
+    // rest of that path.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    static const size_t mc_DefaultMemoryLimit = 1 << 20;  // Default cache memory limit (bytes)
+
+    struct Stats
+    {
+        size_t   states;     // Number of cached DFA states
+        size_t   bytes;      // Approximate cache memory in use
+        uint64_t misses;     // Transitions computed from the NFA
+        uint64_t fallbacks;  // Matches that fell back to NFA simulation when the cache was full
+    };
+
+    explicit LazyDfa (const PatternTokens& pattern, size_t memoryLimit = mc_DefaultMemoryLimit);
+    ~LazyDfa();
+
+    LazyDfa (const LazyDfa&) = delete;
+    LazyDfa& operator= (const LazyDfa&) = delete;
+
+    // Returns true if the given path matches the pattern. Safe to call from many threads at once.
+    bool matches (std::wstring_view path) const;
+
+    // Current cache statistics.
+    Stats stats() const;
+
+  private:
+
+    struct State
+    {
+        PatternNfa::StateSet nfaStates;   // The NFA states this DFA state stands for
+        bool                 accepting;   // True if the set includes the NFA final state
+
+        // Transition slots, one per character class: the target state index, or mc_Unknown.
+        std::unique_ptr<std::atomic<uint32_t>[]> next;
+    };
+
+    static const uint32_t mc_Unknown = UINT32_MAX;   // Transition not yet computed
+    static const uint32_t mc_Dead    = 0;            // The empty (never matching) state
+
+    struct StateSetHash
+    {
+        size_t operator() (const PatternNfa::StateSet& states) const;
+    };
+
+    static const uint32_t mc_FirstBlockSize = 16;   // States in the first block of the state table
+    static const size_t   mc_MaxBlocks      = 29;   // Blocks needed to reach any 32-bit index
+
+    std::atomic<State*>& stateSlot (uint32_t index) const;
+    uint32_t addState (PatternNfa::StateSet&& nfaStates) const;
+    uint32_t transition (const State& state, uint32_t cls) const;
+    bool simulate (PatternNfa::StateSet states, std::wstring_view rest) const;
+
+    PatternNfa m_nfa;
+    size_t     m_memoryLimit;
+    size_t     m_capacity;      // Maximum number of states
+    uint32_t   m_start;         // Index of the start state
+
+    // State table (append only), in blocks that double in size. Blocks are added as the table
+    // fills, and never move, so a reader may follow any published state index without a lock.
+    mutable std::unique_ptr<std::atomic<State*>[]> m_blocks[mc_MaxBlocks];
+    mutable std::atomic<uint32_t>                  m_stateCount {0};
+    mutable std::atomic<size_t>                    m_bytes {0};
+
+    mutable std::mutex m_mutex;   // Guards m_index, m_blocks and the addition of new states
+    mutable std::unordered_map<PatternNfa::StateSet, uint32_t, StateSetHash> m_index;
+
+    mutable std::atomic<uint64_t> m_misses {0};
+    mutable std::atomic<uint64_t> m_fallbacks {0};
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_LAZYDFA_H
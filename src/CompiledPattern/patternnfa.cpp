@@ -0,0 +1,339 @@
+//==================================================================================================
+// patternnfa.cpp
+//
+// Implementation of the PatternNfa object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "patternnfa.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <limits>
+
+using namespace std;
+
+
+namespace PathMatch {
+
+//--------------------------------------------------------------------------------------------------
+uint32_t PatternNfa::addState()
+{
+    m_states.emplace_back();
+    return static_cast<uint32_t>(m_states.size() - 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+uint32_t PatternNfa::addCharSet (CharSet::Kind kind, wchar_t ch, uint32_t index)
+{
+    // Return the index of the given character set, adding it if it's new.
+
+    for (uint32_t i = 0;  i < m_charSets.size();  ++i) {
+        const auto& charSet = m_charSets[i];
+        if (charSet.kind == kind && charSet.ch == ch && charSet.index == index)
+            return i;
+    }
+
+    m_charSets.push_back({kind, ch, index});
+    return static_cast<uint32_t>(m_charSets.size() - 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PatternNfa::build (const PatternTokens& pattern)
+{
+    // Each token extends the automaton from the current state:
+    //
+    //     Literal, '?', [class]
+    //         One edge to a new state.
+    //
+    //     Slash
+    //         A slash edge to a new state that also loops on further slashes, since a run of path
+    //         slashes compares as a single slash.
+    //
+    //     '*', '...'
+    //         The current state is the wildcard's entry state. A matching character moves to a
+    //         separate looping state, and both states have an epsilon edge to the state for the
+    //         next token. Since "*/" and ".../" also match the empty string, an entry state
+    //         followed by a slash gets another epsilon edge past the slash. Keeping the entry state
+    //         distinct from the loop state limits that edge to wildcards that have consumed nothing.
+    //
+    //     '{' ',' '}'
+    //         Each alternative of a brace group runs from its own start state, reached by an
+    //         epsilon edge from the group's start, and ends with an epsilon edge to the group's end
+    //         state. Alternatives are matched as independent sub-patterns, so slash runs and the
+    //         empty "*/" rule don't carry across group boundaries.
+
+    struct Group
+    {
+        uint32_t start;
+        uint32_t end;
+    };
+
+    m_states.clear();
+    m_charSets.clear();
+    m_classes = pattern.classes;
+
+    vector<Group> groups;
+    auto current = addState();
+    uint32_t pendingSkip = UINT32_MAX;    // Wildcard entry state awaiting its skip-slash edge
+
+    for (const auto& token : pattern.tokens) {
+
+        auto addEdge = [&](uint32_t charSet) {
+            auto next = addState();
+            m_states[current].edges.push_back({charSet, next});
+            current = next;
+        };
+
+        switch (token.type) {
+            case TokenType::Literal:
+                addEdge (addCharSet(CharSet::Kind::Literal, token.ch));
+                break;
+
+            case TokenType::AnyChar:
+                addEdge (addCharSet(CharSet::Kind::AnyButSlash));
+                break;
+
+            case TokenType::Class:
+                addEdge (addCharSet(CharSet::Kind::Class, 0, token.index));
+                break;
+
+            case TokenType::Slash: {
+                auto slash = addCharSet(CharSet::Kind::Slash);
+                addEdge (slash);
+                m_states[current].edges.push_back({slash, current});
+                if (pendingSkip != UINT32_MAX)
+                    m_states[pendingSkip].epsilons.push_back(current);
+                break;
+            }
+
+            case TokenType::Star:
+            case TokenType::Ellipsis: {
+                auto charSet = addCharSet((token.type == TokenType::Star) ? CharSet::Kind::AnyButSlash
+                                                                          : CharSet::Kind::Any);
+                auto loop = addState();
+                auto next = addState();
+                m_states[current].edges.push_back({charSet, loop});
+                m_states[current].epsilons.push_back(next);
+                m_states[loop].edges.push_back({charSet, loop});
+                m_states[loop].epsilons.push_back(next);
+                pendingSkip = current;
+                current = next;
+                continue;   // Keep the pending skip for a following slash.
+            }
+
+            case TokenType::GroupOpen: {
+                Group group { addState(), addState() };
+                m_states[current].epsilons.push_back(group.start);
+                current = addState();
+                m_states[group.start].epsilons.push_back(current);
+                groups.push_back(group);
+                break;
+            }
+
+            case TokenType::GroupNext: {
+                m_states[current].epsilons.push_back(groups.back().end);
+                current = addState();
+                m_states[groups.back().start].epsilons.push_back(current);
+                break;
+            }
+
+            case TokenType::GroupClose: {
+                m_states[current].epsilons.push_back(groups.back().end);
+                current = groups.back().end;
+                groups.pop_back();
+                break;
+            }
+        }
+
+        pendingSkip = UINT32_MAX;
+    }
+
+    m_final = current;
+
+    buildClasses();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PatternNfa::inCharSet (const CharSet& charSet, wchar_t lowercaseChar) const
+{
+    switch (charSet.kind) {
+        case CharSet::Kind::Any:         return true;
+        case CharSet::Kind::AnyButSlash: return !isSlashChar(lowercaseChar);
+        case CharSet::Kind::Slash:       return isSlashChar(lowercaseChar);
+        case CharSet::Kind::Literal:     return lowercaseChar == charSet.ch;
+        case CharSet::Kind::Class:       return m_classes[charSet.index].matches(lowercaseChar);
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+uint32_t PatternNfa::classify (wchar_t lowercaseChar, vector<vector<bool>>& signatures)
+{
+    // Return the class of the given character. A character's signature is the list of edge
+    // character sets that accept it; characters with equal signatures share a class.
+
+    vector<bool> signature (m_charSets.size());
+
+    for (size_t i = 0;  i < m_charSets.size();  ++i)
+        signature[i] = inCharSet(m_charSets[i], lowercaseChar);
+
+    for (uint32_t cls = 0;  cls < signatures.size();  ++cls) {
+        if (signatures[cls] == signature)
+            return cls;
+    }
+
+    signatures.push_back(signature);
+    return static_cast<uint32_t>(signatures.size() - 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PatternNfa::buildClasses()
+{
+    // Partition the alphabet into character classes. ASCII characters are classified one by one.
+    // Non-ASCII characters are split into intervals at every boundary of a non-ASCII literal or
+    // class range; within each interval all characters share one class.
+
+    vector<vector<bool>> signatures;
+
+    for (wchar_t c = 0;  c < 128;  ++c)
+        m_asciiClasses[c] = classify(static_cast<wchar_t>(towlower(c)), signatures);
+
+    // Boundaries are computed in 32 bits: the end of an interval that runs to the last character
+    // (U+FFFF, where wchar_t is 16 bits) doesn't fit in a wchar_t. Such a boundary ends the
+    // alphabet, so it is dropped.
+
+    vector<uint32_t> boundaries { 128 };
+
+    auto addInterval = [&](wchar_t first, wchar_t last) {
+        boundaries.push_back(static_cast<uint32_t>(first));
+        boundaries.push_back(static_cast<uint32_t>(last) + 1);
+    };
+
+    for (const auto& charSet : m_charSets) {
+        if (charSet.kind == CharSet::Kind::Literal && static_cast<uint32_t>(charSet.ch) >= 128)
+            addInterval(charSet.ch, charSet.ch);
+    }
+
+    for (const auto& charClass : m_classes) {
+        for (const auto& range : charClass.wideRanges())
+            addInterval(range.first, range.second);
+    }
+
+    sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    const auto lastChar = static_cast<uint32_t>(numeric_limits<wchar_t>::max());
+
+    m_wideClasses.clear();
+    for (auto boundary : boundaries) {
+        if (boundary > lastChar)
+            break;
+        auto c = static_cast<wchar_t>(boundary);
+        m_wideClasses.push_back({c, classify(c, signatures)});
+    }
+
+    // Record which classes each character set accepts.
+
+    m_classCount = static_cast<uint32_t>(signatures.size());
+    m_accepts.assign(m_charSets.size(), vector<bool>(m_classCount));
+
+    for (uint32_t cls = 0;  cls < m_classCount;  ++cls) {
+        for (size_t i = 0;  i < m_charSets.size();  ++i)
+            m_accepts[i][cls] = signatures[cls][i];
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+uint32_t PatternNfa::charClass (wchar_t c) const
+{
+    if (static_cast<uint32_t>(c) < 128)
+        return m_asciiClasses[c];
+
+    auto lc = static_cast<wchar_t>(towlower(c));
+
+    if (static_cast<uint32_t>(lc) < 128)
+        return m_asciiClasses[lc];
+
+    auto entry = upper_bound(m_wideClasses.begin(), m_wideClasses.end(), pair<wchar_t,uint32_t>{lc, UINT32_MAX});
+    return (--entry)->second;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PatternNfa::closure (StateSet& states) const
+{
+    // Extend the state set with every state reachable through epsilon edges, then sort it so that
+    // equal sets compare equal.
+
+    for (size_t i = 0;  i < states.size();  ++i) {
+        for (auto target : m_states[states[i]].epsilons) {
+            if (find(states.begin(), states.end(), target) == states.end())
+                states.push_back(target);
+        }
+    }
+
+    sort(states.begin(), states.end());
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PatternNfa::StateSet PatternNfa::startSet() const
+{
+    StateSet states { 0 };
+    closure(states);
+    return states;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PatternNfa::accepts (const StateSet& states) const
+{
+    return binary_search(states.begin(), states.end(), m_final);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PatternNfa::step (const StateSet& states, uint32_t cls, StateSet& result) const
+{
+    result.clear();
+
+    for (auto state : states) {
+        for (const auto& edge : m_states[state].edges) {
+            if (m_accepts[edge.charSet][cls] && find(result.begin(), result.end(), edge.target) == result.end())
+                result.push_back(edge.target);
+        }
+    }
+
+    closure(result);
+}
+
+
+}; // Namespace PathMatch
@@ -0,0 +1,125 @@
+#ifndef _INCLUDED_PATTERNNFA_H
+//==================================================================================================
+// patternnfa.h
+//
+// Declarations for the PatternNfa object, the nondeterministic automaton for a path match pattern.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATTERNNFA_H
+
+
+#include "patterntokens.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+class PatternNfa
+{
+    //----------------------------------------------------------------------------------------------
+    // A PatternNfa is a nondeterministic automaton, with epsilon edges, for a tokenized pattern.
+    // Unlike the ShiftAndMatcher, it has no limit on pattern length, and it handles brace
+    // alternation.
+    //
+    // Path characters are first mapped to character classes: all characters in a class behave
+    // identically in every transition of the automaton. ASCII characters are mapped through a
+    // table, and other characters through a sorted table of range boundaries.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    using StateSet = std::vector<uint32_t>;   // Sorted set of state indices
+
+    // Build the automaton for the given pattern tokens.
+    void build (const PatternTokens& tokens);
+
+    // The number of character classes.
+    uint32_t classCount() const { return m_classCount; }
+
+    // Returns the character class of the given path character.
+    uint32_t charClass (wchar_t c) const;
+
+    // The epsilon closure of the initial state.
+    StateSet startSet() const;
+
+    // True if the given state set contains the final state.
+    bool accepts (const StateSet& states) const;
+
+    // Compute the epsilon-closed set of states reached from 'states' on a character of class 'cls'.
+    void step (const StateSet& states, uint32_t cls, StateSet& result) const;
+
+  private:
+
+    struct CharSet
+    {
+        // The set of characters accepted by an edge.
+
+        enum class Kind : uint8_t { Any, AnyButSlash, Slash, Literal, Class };
+
+        Kind     kind;
+        wchar_t  ch;        // Lowercase literal (Kind::Literal)
+        uint32_t index;     // Character class index (Kind::Class)
+    };
+
+    struct Edge
+    {
+        uint32_t charSet;   // Index into m_charSets
+        uint32_t target;
+    };
+
+    struct State
+    {
+        std::vector<Edge>     edges;      // Character-consuming transitions
+        std::vector<uint32_t> epsilons;   // Epsilon transitions
+    };
+
+    uint32_t addState();
+    uint32_t addCharSet (CharSet::Kind kind, wchar_t ch = 0, uint32_t index = 0);
+    bool inCharSet (const CharSet& charSet, wchar_t lowercaseChar) const;
+    uint32_t classify (wchar_t lowercaseChar, std::vector<std::vector<bool>>& signatures);
+    void buildClasses();
+    void closure (StateSet& states) const;
+
+    std::vector<State>     m_states;
+    uint32_t               m_final {0};
+
+    std::vector<CharSet>   m_charSets;      // Distinct edge character sets
+    std::vector<CharClass> m_classes;       // Bracketed character classes, from the tokenizer
+
+    uint32_t m_classCount {0};
+    std::vector<std::vector<bool>> m_accepts;   // [charSet][class]: true if class is in the set
+    uint32_t m_asciiClasses[128] {};            // Class of each (lowercased) ASCII character
+    std::vector<std::pair<wchar_t,uint32_t>> m_wideClasses;   // Class of each non-ASCII interval,
+                                                              // by interval start
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_PATTERNNFA_H
@@ -0,0 +1,251 @@
+//==================================================================================================
+// patterntokens.cpp
+//
+// Implementation of the pattern tokenizer shared by the CompiledPattern match engines.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "patterntokens.h"
+
+#include <algorithm>
+#include <cwctype>
+
+using namespace std;
+
+
+namespace PathMatch {
+
+namespace {
+    const auto c_ellipsis = L'\u2026';   // U+2026 - Horizontal Ellipsis (normalized pattern form)
+
+    //----------------------------------------------------------------------------------------------
+    wchar_t lower (wchar_t c)
+    {
+        return static_cast<wchar_t>(towlower(c));
+    }
+}
+
+
+//==================================================================================================
+// CharClass
+//==================================================================================================
+
+CharClass::CharClass (wstring_view members, bool negated)
+  : m_negated(negated)
+{
+    // Members are single characters or 'a-z' style ranges. Ranges between two uppercase letters
+    // are folded to lowercase, as are single characters, since membership is tested against the
+    // lowercase form of a path character.
+
+    for (size_t i = 0;  i < members.size();  ++i) {
+        wchar_t first = members[i];
+        wchar_t last  = first;
+
+        if (i + 2 < members.size() && members[i+1] == L'-') {
+            last = members[i+2];
+            i += 2;
+        }
+
+        if (first == last || (iswupper(first) && iswupper(last))) {
+            first = lower(first);
+            last  = lower(last);
+        }
+
+        if (first > last)
+            continue;   // Ignore empty ranges.
+
+        for (auto c = first;  c <= last && static_cast<uint32_t>(c) < 128;  ++c)
+            m_ascii[c >> 6] |= uint64_t{1} << (c & 63);
+
+        if (static_cast<uint32_t>(last) >= 128)
+            m_ranges.push_back({max<wchar_t>(first, 128), last});
+    }
+
+    sort(m_ranges.begin(), m_ranges.end());
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool CharClass::matches (wchar_t c) const
+{
+    if (isSlashChar(c))
+        return false;
+
+    auto lc = lower(c);
+    bool member = false;
+
+    if (static_cast<uint32_t>(lc) < 128) {
+        member = (m_ascii[lc >> 6] >> (lc & 63)) & 1;
+    } else {
+        for (const auto& range : m_ranges) {
+            if (lc < range.first)
+                break;
+            if (lc <= range.second) {
+                member = true;
+                break;
+            }
+        }
+    }
+
+    return member != m_negated;
+}
+
+
+//==================================================================================================
+// Tokenizer
+//==================================================================================================
+
+size_t charClassLength (wstring_view pattern, size_t offset)
+{
+    // A class is '[', an optional '!' or '^' negation, then one or more members up to the closing
+    // ']'. A ']' right after the opening (or the negation) is a member. Classes may not contain
+    // slashes.
+
+    if (offset >= pattern.size() || pattern[offset] != L'[')
+        return 0;
+
+    auto i = offset + 1;
+
+    if (i < pattern.size() && (pattern[i] == L'!' || pattern[i] == L'^'))
+        ++i;
+    if (i < pattern.size() && pattern[i] == L']')
+        ++i;
+
+    for (;  i < pattern.size();  ++i) {
+        if (isSlashChar(pattern[i]))
+            return 0;
+        if (pattern[i] == L']')
+            return i + 1 - offset;
+    }
+
+    return 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+size_t braceGroupLength (wstring_view pattern, size_t offset)
+{
+    // A group runs from '{' to its matching '}', and must have at least one ',' at its own level.
+    // Character classes inside the group are skipped over whole.
+
+    if (offset >= pattern.size() || pattern[offset] != L'{')
+        return 0;
+
+    int  depth    = 0;
+    bool hasComma = false;
+
+    for (auto i = offset;  i < pattern.size();  ++i) {
+        auto c = pattern[i];
+
+        if (auto classLength = charClassLength(pattern, i)) {
+            i += classLength - 1;
+        } else if (c == L'{') {
+            ++depth;
+        } else if (c == L',' && depth == 1) {
+            hasComma = true;
+        } else if (c == L'}' && --depth == 0) {
+            return hasComma ? (i + 1 - offset) : 0;
+        }
+    }
+
+    return 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PatternTokens tokenizePattern (wstring_view pattern)
+{
+    // Split the pattern into a sequence of tokens, following the same rules that pathMatch() uses
+    // when it interprets a pattern: runs of slashes collapse to a single slash, and runs of
+    // adjacent multi-character wildcards collapse to a single asterisk, or to an ellipsis if any of
+    // them spans directories.
+
+    PatternTokens result;
+    auto& tokens = result.tokens;
+
+    vector<size_t> groupEnds;   // Offsets of the closing braces of the open groups
+
+    for (size_t i = 0;  i < pattern.size();  ++i) {
+        auto c = pattern[i];
+        auto remaining = pattern.size() - i;
+
+        TokenType type;
+        uint32_t  index = 0;
+
+        if (isSlashChar(c)) {
+            type = TokenType::Slash;
+        } else if (c == c_ellipsis) {
+            type = TokenType::Ellipsis;
+        } else if (remaining >= 3 && c == L'.' && pattern[i+1] == L'.' && pattern[i+2] == L'.') {
+            type = TokenType::Ellipsis;
+            i += 2;
+        } else if (remaining >= 2 && c == L'*' && pattern[i+1] == L'*') {
+            type = TokenType::Ellipsis;
+            i += 1;
+        } else if (c == L'*') {
+            type = TokenType::Star;
+        } else if (c == L'?') {
+            type = TokenType::AnyChar;
+        } else if (auto classLength = charClassLength(pattern, i)) {
+            auto members = pattern.substr(i + 1, classLength - 2);
+            auto negated = (members[0] == L'!' || members[0] == L'^') && members.size() > 1;
+            if (negated)
+                members.remove_prefix(1);
+            type  = TokenType::Class;
+            index = static_cast<uint32_t>(result.classes.size());
+            result.classes.emplace_back(members, negated);
+            i += classLength - 1;
+        } else if (auto groupLength = braceGroupLength(pattern, i)) {
+            type = TokenType::GroupOpen;
+            groupEnds.push_back(i + groupLength - 1);
+            result.hasAlternation = true;
+        } else if (c == L',' && !groupEnds.empty()) {
+            type = TokenType::GroupNext;
+        } else if (c == L'}' && !groupEnds.empty() && groupEnds.back() == i) {
+            type = TokenType::GroupClose;
+            groupEnds.pop_back();
+        } else {
+            tokens.push_back({TokenType::Literal, lower(c), 0});
+            continue;
+        }
+
+        if (!tokens.empty()) {
+            auto& last = tokens.back();
+            if (type == TokenType::Slash && last.type == TokenType::Slash)
+                continue;
+            if (isMultiWild(type) && isMultiWild(last.type)) {
+                if (type == TokenType::Ellipsis)
+                    last.type = TokenType::Ellipsis;
+                continue;
+            }
+        }
+
+        tokens.push_back({type, 0, index});
+    }
+
+    return result;
+}
+
+
+}; // Namespace PathMatch
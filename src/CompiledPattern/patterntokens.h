@@ -0,0 +1,129 @@
+#ifndef _INCLUDED_PATTERNTOKENS_H
+//==================================================================================================
+// patterntokens.h
+//
+// Declarations for the pattern tokenizer shared by the CompiledPattern match engines.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATTERNTOKENS_H
+
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+enum class TokenType
+{
+    Literal,        // Single literal character
+    AnyChar,        // '?': any single character except slash
+    Class,          // '[...]': any single character (except slash) in a character class
+    Star,           // '*': any number of characters except slash
+    Ellipsis,       // '...', '**', or U+2026: any number of characters including slash
+    Slash,          // One or more forward or backward slashes
+    GroupOpen,      // '{' opening a brace alternation
+    GroupNext,      // ',' separating two brace alternatives
+    GroupClose      // '}' closing a brace alternation
+};
+
+struct Token
+{
+    TokenType type;
+    wchar_t   ch;       // Lowercase literal character (for TokenType::Literal only)
+    uint32_t  index;    // Character class index (for TokenType::Class only)
+};
+
+
+class CharClass
+{
+    //----------------------------------------------------------------------------------------------
+    // A bracketed character class, such as "[a-z0-9_]" or "[!.]". Membership is tested without
+    // regard to case, and a class never matches a slash. ASCII membership is held in a bitmap;
+    // other characters are tested against the sorted range table.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    CharClass() = default;
+
+    // Build the class from the text between the brackets (with any leading '!' or '^' removed).
+    CharClass (std::wstring_view members, bool negated);
+
+    // True if the character is a member of the class.
+    bool matches (wchar_t c) const;
+
+    // The lowercase non-ASCII member ranges (inclusive), in order.
+    const std::vector<std::pair<wchar_t,wchar_t>>& wideRanges() const { return m_ranges; }
+
+  private:
+
+    bool     m_negated {false};
+    uint64_t m_ascii[2] {0, 0};                               // Lowercase ASCII membership
+    std::vector<std::pair<wchar_t,wchar_t>> m_ranges;         // Lowercase non-ASCII ranges
+};
+
+
+struct PatternTokens
+{
+    std::vector<Token>     tokens;
+    std::vector<CharClass> classes;       // Character classes referenced by Class tokens
+
+    bool hasAlternation {false};          // True if the tokens include any brace groups
+};
+
+
+// Return true if the character is a forward or backward slash.
+inline bool isSlashChar (wchar_t c) { return (c == L'/') || (c == L'\\'); }
+
+// Return true if the token type matches multiple characters.
+inline bool isMultiWild (TokenType type) {
+    return (type == TokenType::Star) || (type == TokenType::Ellipsis);
+}
+
+// Return true if the token type is a brace group marker.
+inline bool isGroupMarker (TokenType type) {
+    return (type == TokenType::GroupOpen) || (type == TokenType::GroupNext)
+        || (type == TokenType::GroupClose);
+}
+
+// Split the pattern into a sequence of match tokens. A '[' without a closing ']', or a '{' without
+// a closing '}' and at least one ',', is taken literally.
+PatternTokens tokenizePattern (std::wstring_view pattern);
+
+// Returns the length of the character class that begins at the given offset (including brackets),
+// or zero if there is no valid class there.
+size_t charClassLength (std::wstring_view pattern, size_t offset);
+
+// Returns the length of the brace group that begins at the given offset (including braces), or zero
+// if there is no valid group there.
+size_t braceGroupLength (std::wstring_view pattern, size_t offset);
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_PATTERNTOKENS_H
@@ -0,0 +1,203 @@
+//==================================================================================================
+// shiftandmatcher.cpp
+//
+// Implementation of the ShiftAndMatcher object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "shiftandmatcher.h"
+
+#include <cwctype>
+
+using namespace std;
+
+
+namespace PathMatch {
+
+//--------------------------------------------------------------------------------------------------
+bool ShiftAndMatcher::compile (const PatternTokens& pattern)
+{
+    // Translate each token into the transitions of the state before it. For token k:
+    //
+    //     Literal, '?',
+    //     [class] ........ state k advances to k+1 on a matching character.
+    //     Slash .......... state k advances to k+1 on a slash, and state k+1 loops on further
+    //                      slashes (a run of path slashes compares as a single slash). Since state
+    //                      k+1 may also loop for a following '*', this loop applies only directly
+    //                      after another slash.
+    //     '*' ............ state k loops on any non-slash character, with an epsilon edge to k+1.
+    //     Ellipsis ....... state k loops on any character, with an epsilon edge to k+1.
+    //
+    // A multi-character wildcard followed by a slash may also match the empty string, so such
+    // wildcards get an additional epsilon edge from k to k+2. This edge is only taken on entry to
+    // state k, before the wildcard has consumed any characters (".../x" matches "x" but not "ax").
+
+    const auto& tokens = pattern.tokens;
+
+    if (tokens.size() > mc_MaxTokens || pattern.hasAlternation)
+        return false;
+
+    *this = ShiftAndMatcher();
+
+    uint64_t slashAdvance = 0;
+    uint64_t slashLoop    = 0;   // Ellipsis loops (slash runs are kept separately)
+
+    for (size_t k = 0;  k < tokens.size();  ++k) {
+        const uint64_t bit = uint64_t{1} << k;
+        const auto& token = tokens[k];
+
+        switch (token.type) {
+            case TokenType::Literal:
+                if (token.ch < 128) {
+                    for (wchar_t c = 0;  c < 128;  ++c) {
+                        if (static_cast<wchar_t>(towlower(c)) == token.ch)
+                            m_advance[c] |= bit;
+                    }
+                } else {
+                    auto entry = m_wideLiterals.begin();
+                    while (entry != m_wideLiterals.end() && entry->first != token.ch)
+                        ++entry;
+                    if (entry == m_wideLiterals.end())
+                        m_wideLiterals.push_back({token.ch, bit});
+                    else
+                        entry->second |= bit;
+                }
+                break;
+
+            case TokenType::AnyChar:
+                m_anyAdvance |= bit;
+                break;
+
+            case TokenType::Class: {
+                const auto& charClass = pattern.classes[token.index];
+                for (wchar_t c = 0;  c < 128;  ++c) {
+                    if (charClass.matches(c))
+                        m_advance[c] |= bit;
+                }
+                m_wideClasses.push_back({charClass, bit});
+                break;
+            }
+
+            default:   // Group markers never appear without alternation.
+                break;
+
+            case TokenType::Slash:
+                slashAdvance |= bit;
+                m_slashRun   |= bit << 1;
+                break;
+
+            case TokenType::Star:
+            case TokenType::Ellipsis:
+                m_anyLoop |= bit;
+                m_skipOne |= bit;
+                if (k + 1 < tokens.size() && tokens[k+1].type == TokenType::Slash)
+                    m_skipTwo |= bit;
+                if (token.type == TokenType::Ellipsis)
+                    slashLoop |= bit;
+                break;
+        }
+    }
+
+    // Fold the character-class masks into the ASCII tables.
+
+    for (wchar_t c = 0;  c < 128;  ++c) {
+        if (isSlashChar(c)) {
+            m_advance[c] = slashAdvance;
+            m_loop[c]    = slashLoop;
+        } else {
+            m_advance[c] |= m_anyAdvance;
+            m_loop[c]     = m_anyLoop;
+        }
+    }
+
+    m_accept = uint64_t{1} << tokens.size();
+    m_start  = closure(1);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+uint64_t ShiftAndMatcher::closure (uint64_t states) const
+{
+    // Follow epsilon edges until no new states are added. Epsilon chains only arise from patterns
+    // like "*/*/x", so this rarely takes more than two passes.
+
+    for (;;) {
+        auto next = states | ((states & m_skipOne) << 1) | ((states & m_skipTwo) << 2);
+        if (next == states)
+            return states;
+        states = next;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool ShiftAndMatcher::matches (wstring_view path) const
+{
+    auto states    = m_start;
+    auto lastSlash = false;
+
+    for (auto c : path) {
+        uint64_t advance;
+        uint64_t loop;
+
+        if (static_cast<uint32_t>(c) < 128) {
+            advance = m_advance[c];
+            loop    = m_loop[c];
+            if (lastSlash && isSlashChar(c))
+                loop |= m_slashRun;
+        } else {
+            auto lower = static_cast<wchar_t>(towlower(c));
+            advance = m_anyAdvance;
+            loop    = m_anyLoop;
+            for (const auto& entry : m_wideLiterals) {
+                if (entry.first == lower)
+                    advance |= entry.second;
+            }
+            for (const auto& entry : m_wideClasses) {
+                if (entry.first.matches(lower))
+                    advance |= entry.second;
+            }
+        }
+
+        // The epsilon edge past a following slash applies only to a wildcard that has matched
+        // nothing yet, so states that merely loop in place take just the edge to the next state.
+
+        auto arrived = (states & advance) << 1;
+        auto looped  = states & loop;
+
+        states = closure(arrived) | looped | ((looped & m_skipOne) << 1);
+
+        if (!states)
+            return false;
+
+        lastSlash = isSlashChar(c);
+    }
+
+    return (states & m_accept) != 0;
+}
+
+
+}; // Namespace PathMatch
@@ -0,0 +1,90 @@
+#ifndef _INCLUDED_SHIFTANDMATCHER_H
+//==================================================================================================
+// shiftandmatcher.h
+//
+// Declarations for the ShiftAndMatcher object, a bit-parallel (Shift-And) path pattern matcher for
+// short patterns.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_SHIFTANDMATCHER_H
+
+
+#include "patterntokens.h"
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+class ShiftAndMatcher
+{
+    //----------------------------------------------------------------------------------------------
+    // The ShiftAndMatcher simulates the pattern's nondeterministic automaton with one bit per
+    // state in a single 64-bit word. State k means "the first k pattern tokens have been matched".
+    // Each path character costs a few table lookups, shifts and masks, with no backtracking, so
+    // patterns with many wildcards cannot trigger the recursive matcher's pathological cases.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    // Patterns with at most this many tokens fit (one more state is needed for the final match).
+    static const size_t mc_MaxTokens = 63;
+
+    // Build the automaton tables. Returns false if the pattern has too many tokens, or contains
+    // brace alternations (which don't fit a linear chain of states).
+    bool compile (const PatternTokens& pattern);
+
+    // Returns true if the given path matches the compiled pattern.
+    bool matches (std::wstring_view path) const;
+
+  private:
+
+    uint64_t closure (uint64_t states) const;
+
+    uint64_t m_start  {0};         // Initial state set (state 0 plus its epsilon closure)
+    uint64_t m_accept {0};         // Final state bit
+
+    uint64_t m_skipOne {0};        // States with an epsilon edge to the next state (multi-wilds)
+    uint64_t m_skipTwo {0};        // States with an epsilon edge past a following slash
+
+    uint64_t m_advance[128] {};    // Per-ASCII-character masks of states that advance
+    uint64_t m_loop[128] {};       // Per-ASCII-character masks of states that loop in place
+
+    uint64_t m_anyAdvance {0};     // States that advance on any non-slash character ('?')
+    uint64_t m_anyLoop {0};        // States that loop on any non-slash character ('*', '...')
+    uint64_t m_slashRun {0};       // States that loop on a slash that follows another slash
+
+    std::vector<std::pair<wchar_t,uint64_t>> m_wideLiterals;    // Advance masks for non-ASCII literals
+    std::vector<std::pair<CharClass,uint64_t>> m_wideClasses;  // Advance masks for [class] tokens,
+                                                               // applied to non-ASCII characters
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_SHIFTANDMATCHER_H
@@ -0,0 +1,142 @@
+//==================================================================================================
+// mappedfile.cpp
+//
+// Implementation of the MappedFile object, using file mappings on Windows and mmap elsewhere.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+namespace PathMatch {
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void MappedFile::close()
+{
+    if (m_data) {
+        #ifdef _WIN32
+            UnmapViewOfFile(m_data);
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        #else
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        #endif
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool MappedFile::open (const fs::path& file)
+{
+    close();
+
+    #ifdef _WIN32
+
+        auto handle = CreateFileW(
+            file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (handle == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(handle, &fileSize)) {
+            CloseHandle(handle);
+            return false;
+        }
+
+        if (fileSize.QuadPart == 0) {
+            CloseHandle(handle);
+            return true;
+        }
+
+        auto mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(handle);    // The mapping keeps the file open.
+
+        if (!mapping)
+            return false;
+
+        auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            return false;
+        }
+
+        m_mapping = mapping;
+        m_data    = static_cast<const uint8_t*>(view);
+        m_size    = static_cast<size_t>(fileSize.QuadPart);
+
+    #else
+
+        auto fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        if (status.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+
+        auto view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);    // The mapping keeps the file open.
+
+        if (view == MAP_FAILED)
+            return false;
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<size_t>(status.st_size);
+
+    #endif
+
+    return true;
+}
+
+
+}; // Namespace PathMatch
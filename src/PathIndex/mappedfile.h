@@ -0,0 +1,80 @@
+#ifndef _INCLUDED_MAPPEDFILE_H
+//==================================================================================================
+// mappedfile.h
+//
+// Declarations for the MappedFile object, a read-only memory mapping of an entire file.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_MAPPEDFILE_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+
+namespace PathMatch
+{
+
+class MappedFile
+{
+    //----------------------------------------------------------------------------------------------
+    // A MappedFile maps the whole of a file into memory, read-only, for as long as the object
+    // lives. Pages are read from disk on demand, and are shared by every process that maps the
+    // same file.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile (const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+
+    // Map the given file, replacing any current mapping. Returns false if the file can't be opened
+    // or mapped. An empty file maps successfully, with null data.
+    bool open (const std::filesystem::path& file);
+
+    // Unmap the current file, if any.
+    void close();
+
+    // The mapped file contents.
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+
+    const uint8_t* m_data {nullptr};
+    size_t         m_size {0};
+
+    #ifdef _WIN32
+        void* m_mapping {nullptr};   // File mapping handle
+    #endif
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_MAPPEDFILE_H
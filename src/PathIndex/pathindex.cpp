@@ -0,0 +1,1634 @@
+//==================================================================================================
+// pathindex.cpp
+//
+// Implementation of the PathIndex object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "pathindex.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+
+namespace PathMatch {
+
+string toUtf8 (wstring_view str)
+{
+    // Encode a wide string in UTF-8. Surrogate pairs (on platforms with 16-bit wchar_t) are
+    // combined; unpaired surrogates are encoded as they are.
+
+    string result;
+    result.reserve(str.size());
+
+    for (size_t i = 0;  i < str.size();  ++i) {
+        auto code = static_cast<uint32_t>(str[i]);
+
+        if (sizeof(wchar_t) == 2 && code >= 0xd800 && code < 0xdc00 && i + 1 < str.size()) {
+            auto low = static_cast<uint32_t>(str[i+1]);
+            if (low >= 0xdc00 && low < 0xe000) {
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                ++i;
+            }
+        }
+
+        if (code < 0x80) {
+            result += static_cast<char>(code);
+        } else if (code < 0x800) {
+            result += static_cast<char>(0xc0 | (code >> 6));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            result += static_cast<char>(0xe0 | (code >> 12));
+            result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            result += static_cast<char>(0xf0 | (code >> 18));
+            result += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+void addTrigrams (string_view text, vector<uint32_t>& trigrams)
+{
+    for (size_t i = 0;  i + 3 <= text.size();  ++i) {
+        trigrams.push_back((uint32_t{static_cast<uint8_t>(text[i])} << 16)
+                         | (uint32_t{static_cast<uint8_t>(text[i+1])} << 8)
+                         |  uint32_t{static_cast<uint8_t>(text[i+2])});
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void appendUtf8 (wstring& result, string_view str)
+{
+    // Decode UTF-8 and append it to a wide string. Malformed sequences decode to U+FFFD.
+
+    for (size_t i = 0;  i < str.size();  ) {
+        auto lead = static_cast<uint8_t>(str[i]);
+        size_t length = (lead < 0x80) ? 1 : (lead >= 0xf0) ? 4 : (lead >= 0xe0) ? 3 : (lead >= 0xc0) ? 2 : 0;
+
+        if (length == 0 || i + length > str.size()) {
+            result += L'\ufffd';
+            ++i;
+            continue;
+        }
+
+        uint32_t code = (length == 1) ? lead : (lead & (0x7f >> length));
+        for (size_t j = 1;  j < length;  ++j)
+            code = (code << 6) | (static_cast<uint8_t>(str[i+j]) & 0x3f);
+        i += length;
+
+        if (sizeof(wchar_t) == 2 && code >= 0x10000) {
+            code -= 0x10000;
+            result += static_cast<wchar_t>(0xd800 + (code >> 10));
+            result += static_cast<wchar_t>(0xdc00 + (code & 0x3ff));
+        } else {
+            result += static_cast<wchar_t>(code);
+        }
+    }
+}
+
+
+namespace {
+
+    const char     c_magic[8] { 'P', 'M', 'I', 'N', 'D', 'E', 'X', 0 };
+    const uint32_t c_version = 5;
+
+    // Directories modified less than this long before an index was built may have been modified
+    // again within the same file time tick, so they are always read again on refresh.
+    const auto c_racyInterval = chrono::seconds(2);
+
+    struct IndexHeader
+    {
+        char     magic[8];          // c_magic
+        uint32_t version;           // c_version
+        uint32_t flags;             // HeaderFlags
+        uint64_t entryCount;        // Number of entries, including the root
+        uint64_t rootOffset;        // File offset of the root path
+        uint64_t rootLength;        // Length of the root path, in bytes
+        uint64_t nodesOffset;       // File offset of the node data
+        uint64_t nodesLength;       // Length of the node data, in bytes
+        int64_t  buildTime;         // File time when the build (or refresh) started
+        uint64_t entryTableOffset;  // File offset of the entry table (trigram indexes only)
+        uint64_t trigramsOffset;    // File offset of the trigram table (trigram indexes only)
+        uint64_t trigramCount;      // Number of trigrams
+        uint64_t postingsOffset;    // File offset of the posting lists (trigram indexes only)
+        uint64_t postingsLength;    // Length of the posting lists, in bytes
+    };
+
+    enum HeaderFlags : uint32_t
+    {
+        TrigramsFlag = 1            // The index includes trigram posting lists
+    };
+
+    //----------------------------------------------------------------------------------------------
+    void writeVarint (string& out, uint64_t value)
+    {
+        // Append a variable-length integer: seven bits per byte, low bits first, with the high bit
+        // set on all but the last byte.
+
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    uint64_t zigzag (int64_t value)
+    {
+        // Map signed values to unsigned ones, so that small magnitudes of either sign stay small.
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    int64_t unzigzag (uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    int64_t fileTicks (fs::file_time_type time)
+    {
+        return time.time_since_epoch().count();
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool readVarint (const uint8_t*& ptr, const uint8_t* end, uint64_t& value)
+    {
+        // Read a variable-length integer, advancing the pointer. Returns false if the integer runs
+        // past the end of the data.
+
+        value = 0;
+
+        for (int shift = 0;  ptr < end && shift < 64;  shift += 7) {
+            auto byte = *ptr++;
+            value |= uint64_t{byte & 0x7fu} << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    wstring normalizedRoot (const fs::path& root)
+    {
+        // Return the root path lexically normalized, with forward slashes and no trailing slash
+        // (unless the root is itself a root directory). The current directory becomes empty.
+
+        auto result = root.lexically_normal().generic_wstring();
+
+        while (result.size() > 1 && result.back() == L'/' && result[result.size() - 2] != L':')
+            result.pop_back();
+
+        if (result == L".")
+            result.clear();
+
+        return result;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void splitPath (const wstring& path, vector<wstring>& components, vector<size_t>& offsets)
+    {
+        // Split a forward-slash path into its components, along with the offset of each in the
+        // path. A leading slash is its own "/" component, as in a normalized pattern.
+
+        components.clear();
+        offsets.clear();
+
+        size_t start = 0;
+
+        if (!path.empty() && path[0] == L'/') {
+            components.push_back(L"/");
+            offsets.push_back(0);
+            start = 1;
+        }
+
+        while (start < path.size()) {
+            auto end = path.find(L'/', start);
+            if (end == wstring::npos)
+                end = path.size();
+            if (end > start) {
+                components.emplace_back(path, start, end - start);
+                offsets.push_back(start);
+            }
+            start = end + 1;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool componentMatches (
+        const MatchPlan& plan, size_t index, const wstring& name, PrefilterCounters& counters)
+    {
+        // Return true if the path component matches the pattern component. Root and parent
+        // directory components only match themselves; name patterns never match them.
+
+        if (plan.isRoot(index))
+            return name == L"/";
+        if (plan.isParent(index))
+            return name == L"..";
+        if (name == L"/" || name == L"..")
+            return false;
+
+        return plan.compiled(index).matches(name.c_str(), name.size(), counters);
+    }
+
+    //==============================================================================================
+    // Plan States
+    //==============================================================================================
+
+    struct PlanState
+    {
+        // A position in a match plan reached by the leading components of a path. Optional plan
+        // components may match no path component at all, so a path can reach several positions at
+        // once, and each is followed independently.
+
+        size_t index;                   // Next plan component to match (size() once all matched)
+        size_t spanStart {SIZE_MAX};    // Path component that begins the span subpath, once begun
+
+        bool operator== (const PlanState&) const = default;
+    };
+
+    using PlanStates = vector<PlanState>;
+
+    //----------------------------------------------------------------------------------------------
+    void addState (const MatchPlan& plan, PlanStates& states, PlanState state)
+    {
+        // Add the state (if it's new), along with the states reached by skipping each optional
+        // component from there.
+
+        for (;;) {
+            if (find(states.begin(), states.end(), state) != states.end())
+                return;
+            states.push_back(state);
+            if (state.spanStart != SIZE_MAX || state.index == plan.size() || !plan.isOptional(state.index))
+                return;
+            ++state.index;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void advanceStates (
+        const MatchPlan&   plan,
+        const PlanStates&  states,
+        const wstring&     name,
+        size_t             depth,
+        PrefilterCounters& counters,
+        PlanStates&        next)
+    {
+        // Set 'next' to the states reached by matching the given path component (at the given depth
+        // in the path) from each of the given states. Components before the span match one at a
+        // time. The first component of the span subpath must match the span prefix; after that,
+        // every component extends the subpath.
+
+        auto span = plan.spanIndex();
+        next.clear();
+
+        for (auto state : states) {
+            if (state.spanStart == SIZE_MAX) {
+                if (state.index == plan.size())
+                    continue;
+
+                if (state.index < span) {
+                    if (componentMatches(plan, state.index, name, counters))
+                        addState(plan, next, {state.index + 1});
+                    continue;
+                }
+
+                if (name == L"/" || name == L".." || (plan.spanPrefix() && !plan.spanPrefix()->matches(name)))
+                    continue;
+
+                state.spanStart = depth;
+            }
+
+            addState(plan, next, state);
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool statesMatch (
+        const MatchPlan&      plan,
+        const PlanStates&     states,
+        const wstring&        path,
+        const vector<size_t>& offsets,
+        bool                  isDirectory,
+        PrefilterCounters&    counters)
+    {
+        // Return true if PathMatcher would report the entry with the given path, which reached the
+        // given states: if any state has matched every component, or has a span subpath that
+        // matches the span pattern.
+
+        if (plan.dirsOnly() && !isDirectory)
+            return false;
+
+        for (auto state : states) {
+            if (state.spanStart == SIZE_MAX) {
+                if (state.index == plan.size())
+                    return true;
+                continue;
+            }
+
+            if (plan.spanMatchesAll())
+                return true;
+
+            auto offset = offsets[state.spanStart];
+            if (plan.spanPattern().matches(path.c_str() + offset, path.size() - offset, counters))
+                return true;
+        }
+
+        return false;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool statesContinue (const MatchPlan& plan, const PlanStates& states)
+    {
+        // Return true if a path that reached the given states could be extended to a match.
+
+        for (auto state : states) {
+            if (state.spanStart != SIZE_MAX || state.index < plan.size())
+                return true;
+        }
+
+        return false;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool entryMatches (
+        const MatchPlan&       plan,
+        const wstring&         path,
+        const vector<wstring>& components,
+        const vector<size_t>&  offsets,
+        bool                   isDirectory,
+        PrefilterCounters&     counters)
+    {
+        // Return true if PathMatcher would report the entry with the given path, by matching each
+        // of its components against the plan in turn.
+
+        PlanStates states, next;
+        addState(plan, states, {0});
+
+        for (size_t depth = 0;  depth < components.size() && !states.empty();  ++depth) {
+            advanceStates(plan, states, components[depth], depth, counters, next);
+            states.swap(next);
+        }
+
+        return !components.empty() && statesMatch(plan, states, path, offsets, isDirectory, counters);
+    }
+
+    //==============================================================================================
+    // Trie Nodes
+    //==============================================================================================
+
+    struct TrieNode
+    {
+        // A decoded trie node. Each node is followed by its descendants, and then by its next
+        // sibling.
+
+        string_view    name;        // UTF-8 name (empty for the root)
+        string_view    key;         // UTF-8 lowercase name, by which siblings are sorted
+        uint8_t        flags;       // EntryFlags
+        int64_t        time;        // Modification time (listed directories only)
+        uint64_t       childCount;  // Number of children (directories only)
+        const uint8_t* childTable;  // Offset of each child, relative to the first child
+        const uint8_t* children;    // Start of the node's descendants
+        const uint8_t* next;        // End of the node's descendants (its next sibling)
+    };
+
+    //----------------------------------------------------------------------------------------------
+    string foldedName (wstring_view name)
+    {
+        // Return the sort key of an entry name: its UTF-8 encoding in lowercase, as literal pattern
+        // components are compared.
+        return toUtf8(lowercase(name));
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool precedes (string_view keyA, string_view nameA, string_view keyB, string_view nameB)
+    {
+        // The sibling order: by lowercase name, then (for names that differ only in case) by name.
+        return (keyA != keyB) ? (keyA < keyB) : (nameA < nameB);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool readNode (const uint8_t* ptr, const uint8_t* end, TrieNode& node)
+    {
+        // Decode the node at the given position. Returns false if the node data is malformed, or
+        // the node's descendants run past the end of the data.
+
+        uint64_t nameLength, time = 0;
+
+        if (!readVarint(ptr, end, nameLength) || nameLength >= static_cast<uint64_t>(end - ptr))
+            return false;
+
+        node.name  = string_view(reinterpret_cast<const char*>(ptr), nameLength);
+        node.key   = node.name;
+        ptr       += nameLength;
+        node.flags = *ptr++;
+
+        if (node.flags & PathIndex::FoldedFlag) {
+            uint64_t keyLength;
+            if (!readVarint(ptr, end, keyLength) || keyLength > static_cast<uint64_t>(end - ptr))
+                return false;
+            node.key = string_view(reinterpret_cast<const char*>(ptr), keyLength);
+            ptr     += keyLength;
+        }
+
+        if ((node.flags & PathIndex::ListedFlag) && !readVarint(ptr, end, time))
+            return false;
+
+        node.time       = unzigzag(time);
+        node.childCount = 0;
+        node.childTable = ptr;
+
+        uint64_t length = 0;
+
+        if (node.flags & PathIndex::DirectoryFlag) {
+            if (end - ptr < static_cast<ptrdiff_t>(sizeof(length)))
+                return false;
+            memcpy(&length, ptr, sizeof(length));
+            ptr += sizeof(length);
+            if (length > static_cast<uint64_t>(end - ptr) || length < sizeof(node.childCount))
+                return false;
+
+            // The descendants lead with the child offset table.
+
+            memcpy(&node.childCount, ptr, sizeof(node.childCount));
+            if (node.childCount > (length - sizeof(node.childCount)) / sizeof(uint64_t))
+                return false;
+            node.childTable = ptr + sizeof(node.childCount);
+            node.children   = node.childTable + node.childCount * sizeof(uint64_t);
+            node.next       = ptr + length;
+            return true;
+        }
+
+        node.children = ptr;
+        node.next     = ptr;
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool readChild (const TrieNode& node, uint64_t ordinal, TrieNode& child)
+    {
+        // Decode the child of a directory node with the given ordinal, found through the node's
+        // child offset table. Returns false if the child's node data is malformed.
+
+        uint64_t offset;
+        memcpy(&offset, node.childTable + ordinal * sizeof(offset), sizeof(offset));
+
+        return offset < static_cast<uint64_t>(node.next - node.children)
+            && readNode(node.children + offset, node.next, child);
+    }
+
+
+    class TrieWriter
+    {
+        //------------------------------------------------------------------------------------------
+        // The TrieWriter encodes trie nodes in depth-first order. A directory node's descendant
+        // length and child offsets aren't known until its descendants have been written, so the
+        // nodes are built in memory and these are filled in as the descendants are written.
+        //------------------------------------------------------------------------------------------
+
+      public:
+
+        // Write a node with the given name and sort key, and return a token to pass to end() once
+        // its descendants are written. A directory node must be given its number of children.
+        size_t begin (string_view name, string_view key, uint8_t flags, int64_t time = 0, uint64_t childCount = 0)
+        {
+            // Record the node's offset in its parent's child table.
+
+            if (!m_open.empty()) {
+                auto& parent = m_open.back();
+                if (parent.written < parent.count) {
+                    uint64_t offset = m_data.size() - parent.children;
+                    memcpy(&m_data[parent.table + parent.written * sizeof(offset)], &offset, sizeof(offset));
+                    ++parent.written;
+                }
+            }
+
+            if (key != name)
+                flags |= PathIndex::FoldedFlag;
+
+            writeVarint(m_data, name.size());
+            m_data.append(name);
+            m_data += static_cast<char>(flags);
+
+            if (flags & PathIndex::FoldedFlag) {
+                writeVarint(m_data, key.size());
+                m_data.append(key);
+            }
+
+            if (flags & PathIndex::ListedFlag)
+                writeVarint(m_data, zigzag(time));
+
+            ++m_count;
+
+            if (!(flags & PathIndex::DirectoryFlag))
+                return string::npos;
+
+            m_data.append(sizeof(uint64_t), '\0');
+            auto token = m_data.size();
+
+            m_data.append(reinterpret_cast<const char*>(&childCount), sizeof(childCount));
+            m_data.append(childCount * sizeof(uint64_t), '\0');
+            m_open.push_back({token + sizeof(childCount), m_data.size(), childCount, 0});
+
+            return token;
+        }
+
+        // Finish the node begun with the given token.
+        void end (size_t token)
+        {
+            if (token == string::npos)
+                return;
+
+            m_open.pop_back();
+
+            uint64_t length = m_data.size() - token;
+            memcpy(&m_data[token - sizeof(length)], &length, sizeof(length));
+        }
+
+        uint64_t count() const { return m_count; }
+        const string& data() const { return m_data; }
+
+      private:
+
+        struct OpenDirectory
+        {
+            size_t   table;       // Position of the child offset table
+            size_t   children;    // Position of the first child
+            uint64_t count;       // Number of children
+            uint64_t written;     // Children written so far
+        };
+
+        string                m_data;          // Encoded nodes
+        uint64_t              m_count {0};     // Nodes written
+        vector<OpenDirectory> m_open;          // Directory nodes whose descendants are being written
+    };
+
+
+    //==============================================================================================
+    // Tree Indexer
+    //==============================================================================================
+
+    class Indexer
+    {
+        //------------------------------------------------------------------------------------------
+        // The Indexer walks a directory tree and writes its nodes, optionally reusing the nodes of
+        // an old index of the same tree.
+        //------------------------------------------------------------------------------------------
+
+      public:
+
+        Indexer (TrieWriter& writer, IndexBuildStats& stats, const uint8_t* oldEnd, int64_t trustedTime)
+          : m_writer(writer), m_stats(stats), m_oldEnd(oldEnd), m_trustedTime(trustedTime)
+        {}
+
+        // Add the directory with the given file system path and UTF-8 name, followed by its
+        // contents. If the directory is in the old index, then 'old' is its old node.
+        void addDirectory (const fs::path& directory, string_view name, string_view key, const TrieNode* old);
+
+        // True if malformed old index data was found.
+        bool oldCorrupt() const { return m_oldCorrupt; }
+
+      private:
+
+        struct Child
+        {
+            string   name;           // UTF-8 name
+            string   key;            // UTF-8 lowercase name
+            fs::path path;           // File system path
+            uint8_t  flags;          // Entry flags (DirectoryFlag and LinkFlag only)
+        };
+
+        bool listDirectory (const fs::path& directory, vector<Child>& children);
+        void addChild (const Child& child, const TrieNode* old);
+
+        TrieWriter&      m_writer;
+        IndexBuildStats& m_stats;
+        const uint8_t*   m_oldEnd;               // End of the old index nodes
+        int64_t          m_trustedTime;          // Old times before this can be trusted
+        bool             m_oldCorrupt {false};
+    };
+
+    //----------------------------------------------------------------------------------------------
+    void Indexer::addDirectory (const fs::path& directory, string_view name, string_view key, const TrieNode* old)
+    {
+        auto dirPath = directory.empty() ? fs::path(L".") : directory;
+
+        error_code errorCode;
+        auto time = fs::last_write_time(dirPath, errorCode);
+        auto timeKnown = !errorCode;
+        auto ticks = timeKnown ? fileTicks(time) : 0;
+
+        TrieNode oldChild;
+
+        // If the directory hasn't changed since the old index was built, then carry over its old
+        // entries rather than reading it again. Subdirectories may have changed nonetheless, so
+        // each is checked in turn.
+
+        if (old && (old->flags & PathIndex::ListedFlag) && timeKnown && ticks == old->time
+            && old->time < m_trustedTime) {
+            ++m_stats.directoriesReused;
+
+            auto token = m_writer.begin(
+                name, key, PathIndex::DirectoryFlag | PathIndex::ListedFlag, ticks, old->childCount);
+
+            for (auto ptr = old->children;  ptr < old->next;  ptr = oldChild.next) {
+                if (!readNode(ptr, old->next, oldChild)) {
+                    m_oldCorrupt = true;
+                    break;
+                }
+
+                wstring childName;
+                appendUtf8(childName, oldChild.name);
+
+                auto flags = static_cast<uint8_t>(oldChild.flags & (PathIndex::DirectoryFlag | PathIndex::LinkFlag));
+                addChild({string(oldChild.name), string(oldChild.key), directory / childName, flags}, &oldChild);
+            }
+
+            m_writer.end(token);
+            return;
+        }
+
+        vector<Child> children;
+        auto listed = listDirectory(directory, children);
+
+        uint8_t flags = PathIndex::DirectoryFlag;
+        if (listed && timeKnown)
+            flags |= PathIndex::ListedFlag;
+
+        if (listed)
+            ++m_stats.directoriesListed;
+
+        auto token = m_writer.begin(name, key, flags, ticks, children.size());
+
+        // Merge the fresh entries with the old ones (both in sibling order). Where the old index has
+        // an entry of the same name and kind, it's passed along so that a subdirectory's own
+        // contents may still be reused.
+
+        auto oldPtr  = old ? old->children : nullptr;
+        auto oldNext = old ? old->next : nullptr;
+        bool oldValid = false;
+
+        for (const auto& child : children) {
+            while (oldPtr && (oldValid || oldPtr < oldNext)) {
+                if (!oldValid) {
+                    if (!readNode(oldPtr, oldNext, oldChild)) {
+                        m_oldCorrupt = true;
+                        oldPtr = nullptr;
+                        break;
+                    }
+                    oldValid = true;
+                }
+                if (!precedes(oldChild.key, oldChild.name, child.key, child.name))
+                    break;
+                oldPtr   = oldChild.next;
+                oldValid = false;
+            }
+
+            auto sameEntry = oldValid && oldChild.name == child.name
+                          && (oldChild.flags & (PathIndex::DirectoryFlag | PathIndex::LinkFlag)) == child.flags;
+
+            addChild(child, sameEntry ? &oldChild : nullptr);
+        }
+
+        m_writer.end(token);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool Indexer::listDirectory (const fs::path& directory, vector<Child>& children)
+    {
+        // Read the directory's entries, in sibling order. Returns false if it can't be read.
+
+        error_code errorCode;
+
+        fs::directory_iterator entries (directory.empty() ? fs::path(L".") : directory, errorCode);
+        if (errorCode)
+            return false;
+
+        for (const auto& entry : entries) {
+            uint8_t flags = 0;
+            if (entry.is_directory(errorCode)) {
+                flags |= PathIndex::DirectoryFlag;
+                if (entry.is_symlink(errorCode))
+                    flags |= PathIndex::LinkFlag;
+            }
+            auto name = entry.path().filename().wstring();
+            children.push_back({toUtf8(name), foldedName(name), entry.path(), flags});
+        }
+
+        sort(children.begin(), children.end(), [](const Child& a, const Child& b) {
+            return precedes(a.key, a.name, b.key, b.name);
+        });
+
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void Indexer::addChild (const Child& child, const TrieNode* old)
+    {
+        // Add a directory entry. Directories (other than links) are followed by their contents.
+
+        ++((child.flags & PathIndex::DirectoryFlag) ? m_stats.directories : m_stats.files);
+
+        if ((child.flags & PathIndex::DirectoryFlag) && !(child.flags & PathIndex::LinkFlag))
+            addDirectory(child.path, child.name, child.key, old);
+        else
+            m_writer.end(m_writer.begin(child.name, child.key, child.flags));
+    }
+
+
+    //==============================================================================================
+    // Trie Query
+    //==============================================================================================
+
+    class TrieQuery
+    {
+        //------------------------------------------------------------------------------------------
+        // A TrieQuery walks the index trie in step with a match plan. Components before the plan's
+        // span match one level at a time, so a directory whose component fails to match is skipped
+        // along with everything below it, without decoding any of it. Past the span (which begins
+        // with an ellipsis), any path can still be extended to a match, so nothing more can be
+        // pruned; entries there are matched against the span pattern. Since optional components
+        // may match no level at all, each level carries the set of plan states its path reached,
+        // so an entry is visited (and reported) once however many ways it can match. Siblings are
+        // sorted by their lowercase names, so a literal component (or a small set of them) is found
+        // by binary search rather than by reading every sibling.
+        //------------------------------------------------------------------------------------------
+
+      public:
+
+        TrieQuery (
+            const MatchPlan&          plan,
+            PathIndex::MatchCallback* callback,
+            void*                     userData,
+            MatchStats&               stats)
+          : m_plan(plan), m_callback(callback), m_userData(userData), m_stats(stats)
+        {}
+
+        // Run the query over the trie with the given root node and root path. Returns false if
+        // malformed node data was found.
+        bool run (const TrieNode& root, const wstring& rootPath);
+
+      private:
+
+        bool probeKeys (const PlanStates& states, uint64_t childCount, vector<string>& keys) const;
+        void visitChildren (const TrieNode& node);
+        void visitChild (const TrieNode& child, size_t pathLength);
+
+        const MatchPlan&          m_plan;
+        PathIndex::MatchCallback* m_callback;
+        void*                     m_userData;
+        MatchStats&               m_stats;
+
+        wstring         m_path;           // Full path of the current node
+        vector<wstring> m_components;     // Components of the full path
+        vector<size_t>  m_offsets;        // Offset of each component in the full path
+        vector<PlanStates> m_states;      // Plan states reached by the path through each depth
+        bool            m_halted {false}; // True once the callback halts the query
+        bool            m_corrupt {false};
+    };
+
+    //----------------------------------------------------------------------------------------------
+    bool TrieQuery::run (const TrieNode& root, const wstring& rootPath)
+    {
+        // The components of the root path must each match in turn, just as the components of a
+        // node's name do. The current directory itself is never reported.
+
+        m_path = rootPath;
+        splitPath(m_path, m_components, m_offsets);
+
+        m_states.assign(m_components.size() + 1, {});
+        addState(m_plan, m_states[0], {0});
+
+        for (size_t depth = 0;  depth < m_components.size();  ++depth) {
+            advanceStates(m_plan, m_states[depth], m_components[depth], depth, m_stats.prefilter, m_states[depth + 1]);
+            if (m_states[depth + 1].empty())
+                return true;
+        }
+
+        const auto& states = m_states.back();
+
+        if (!m_components.empty() && statesMatch(m_plan, states, m_path, m_offsets, true, m_stats.prefilter)) {
+            ++m_stats.matchesReported;
+            if (!m_callback(m_path, true, m_userData))
+                return true;
+        }
+
+        if (statesContinue(m_plan, states))
+            visitChildren(root);
+
+        return !m_corrupt;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool TrieQuery::probeKeys (const PlanStates& states, uint64_t childCount, vector<string>& keys) const
+    {
+        // If the children can only match known names (those of literal components, or sets of
+        // them), then get their sort keys (ascending, without duplicates) and return true. Each
+        // key costs a binary search, so a set of names is only probed for if that's cheaper than
+        // reading every child.
+
+        const auto& plan = m_plan;
+        bool hasSet = false;
+
+        keys.clear();
+
+        for (auto state : states) {
+            if (state.spanStart == SIZE_MAX && state.index == plan.size())
+                continue;   // Matches no child
+
+            auto index = state.index;
+
+            if (state.spanStart != SIZE_MAX || index >= plan.spanIndex() || plan.isRoot(index) || plan.isParent(index))
+                return false;
+
+            const auto& compiled = plan.compiled(index);
+
+            if (compiled.isLiteral()) {
+                keys.push_back(foldedName(plan.text(index)));
+                continue;
+            }
+
+            auto alternatives = compiled.literalAlternatives();
+            if (!alternatives)
+                return false;
+
+            for (const auto& name : *alternatives)
+                keys.push_back(foldedName(name));
+
+            hasSet = true;
+        }
+
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+        return !hasSet || keys.size() * bit_width(childCount) < childCount;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void TrieQuery::visitChildren (const TrieNode& node)
+    {
+        // Visit the children of a directory node, and the descendants of each that may match.
+
+        auto pathLength = m_path.size();
+        vector<string> keys;
+
+        TrieNode child;
+
+        if (!probeKeys(m_states[m_components.size()], node.childCount, keys)) {
+            for (auto ptr = node.children;  ptr < node.next && !m_halted;  ptr = child.next) {
+                if (!readNode(ptr, node.next, child)) {
+                    m_corrupt = true;
+                    break;
+                }
+                visitChild(child, pathLength);
+            }
+            return;
+        }
+
+        // Find the first child with each key, then visit every child with that key (names that
+        // differ only in case share a key).
+
+        for (const auto& key : keys) {
+            uint64_t low = 0, high = node.childCount;
+
+            while (low < high && !m_corrupt) {
+                auto middle = low + (high - low) / 2;
+                ++m_stats.entriesRead;
+                if (!readChild(node, middle, child))
+                    m_corrupt = true;
+                else if (child.key < key)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+
+            for (auto ordinal = low;  ordinal < node.childCount && !m_halted && !m_corrupt;  ++ordinal) {
+                if (!readChild(node, ordinal, child)) {
+                    m_corrupt = true;
+                    break;
+                }
+                if (child.key != key)
+                    break;
+                visitChild(child, pathLength);
+            }
+
+            if (m_halted || m_corrupt)
+                break;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void TrieQuery::visitChild (const TrieNode& child, size_t pathLength)
+    {
+        // Visit a child of the directory with the given path length, and its descendants that may
+        // match.
+
+        auto depth = m_components.size();
+
+        ++m_stats.entriesRead;
+
+        m_path.resize(pathLength);
+        if (!m_path.empty() && m_path.back() != L'/')
+            m_path += L'/';
+
+        m_offsets.push_back(m_path.size());
+        m_components.emplace_back();
+        appendUtf8(m_components.back(), child.name);
+        m_path += m_components.back();
+
+        // The states reached at each depth are kept, so that their storage is reused.
+
+        if (m_states.size() < depth + 2)
+            m_states.resize(depth + 2);
+
+        auto& states = m_states[depth + 1];
+        advanceStates(m_plan, m_states[depth], m_components.back(), depth, m_stats.prefilter, states);
+
+        auto isDirectory = (child.flags & PathIndex::DirectoryFlag) != 0;
+
+        if (!states.empty()) {
+            if (statesMatch(m_plan, states, m_path, m_offsets, isDirectory, m_stats.prefilter)) {
+                ++m_stats.matchesReported;
+                m_halted = !m_callback(m_path, isDirectory, m_userData);
+            }
+            if (isDirectory && !m_halted && statesContinue(m_plan, states))
+                visitChildren(child);
+        }
+
+        m_components.pop_back();
+        m_offsets.pop_back();
+        m_path.resize(pathLength);
+    }
+
+    //==============================================================================================
+    // Trigram Index
+    //==============================================================================================
+
+    struct EntryRecord
+    {
+        uint64_t node;      // Offset of the entry's node, relative to the start of the node data
+        uint64_t parent;    // Ordinal of the parent entry (c_noParent for the root)
+    };
+
+    struct TrigramRecord
+    {
+        uint32_t trigram;   // Three UTF-8 bytes, first byte highest
+        uint32_t reserved;  // Zero
+        uint64_t offset;    // Offset of the posting list, relative to the start of the postings
+        uint64_t count;     // Number of entries in the posting list
+    };
+
+    const uint64_t c_noParent = UINT64_MAX;
+
+
+    class TrigramBuilder
+    {
+        //------------------------------------------------------------------------------------------
+        // The TrigramBuilder walks a finished trie, and writes the entry table (so that a path can
+        // be rebuilt from an entry ordinal), the trigram table, and the posting list of each
+        // trigram: the ordinals of the entries whose full lowercase paths contain it.
+        //------------------------------------------------------------------------------------------
+
+      public:
+
+        TrigramBuilder (const string& nodes, const wstring& root)
+          : m_nodes(nodes), m_root(root)
+        {}
+
+        // Build the tables. Returns false if the trie data is malformed.
+        bool build();
+
+        const vector<EntryRecord>&   entries() const { return m_entries; }
+        const vector<TrigramRecord>& trigrams() const { return m_trigrams; }
+        const string&                postings() const { return m_postings; }
+
+      private:
+
+        bool visit (const uint8_t* ptr, const uint8_t* end, uint64_t parent, const wstring& path);
+
+        const string&         m_nodes;
+        wstring               m_root;
+        vector<EntryRecord>   m_entries;
+        vector<TrigramRecord> m_trigrams;
+        string                m_postings;
+        vector<uint32_t>      m_pathTrigrams;                 // Trigrams of the current path
+        unordered_map<uint32_t, vector<uint64_t>> m_lists;    // Posting list of each trigram
+    };
+
+    //----------------------------------------------------------------------------------------------
+    bool TrigramBuilder::build()
+    {
+        auto data = reinterpret_cast<const uint8_t*>(m_nodes.data());
+
+        if (!visit(data, data + m_nodes.size(), c_noParent, m_root))
+            return false;
+
+        vector<uint32_t> keys;
+        keys.reserve(m_lists.size());
+        for (const auto& list : m_lists)
+            keys.push_back(list.first);
+        sort(keys.begin(), keys.end());
+
+        // Posting lists hold ascending ordinals, so each is stored as varint deltas.
+
+        for (auto key : keys) {
+            const auto& list = m_lists[key];
+            m_trigrams.push_back({key, 0, m_postings.size(), list.size()});
+
+            uint64_t previous = 0;
+            for (auto ordinal : list) {
+                writeVarint(m_postings, ordinal - previous);
+                previous = ordinal;
+            }
+        }
+
+        m_lists.clear();
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool TrigramBuilder::visit (const uint8_t* ptr, const uint8_t* end, uint64_t parent, const wstring& path)
+    {
+        // Add the node at the given position (with the given full path), and its descendants.
+
+        TrieNode node;
+        if (!readNode(ptr, end, node))
+            return false;
+
+        auto ordinal = m_entries.size();
+        m_entries.push_back({static_cast<uint64_t>(ptr - reinterpret_cast<const uint8_t*>(m_nodes.data())), parent});
+
+        m_pathTrigrams.clear();
+        addTrigrams(toUtf8(lowercase(path)), m_pathTrigrams);
+        sort(m_pathTrigrams.begin(), m_pathTrigrams.end());
+        m_pathTrigrams.erase(unique(m_pathTrigrams.begin(), m_pathTrigrams.end()), m_pathTrigrams.end());
+
+        for (auto trigram : m_pathTrigrams)
+            m_lists[trigram].push_back(ordinal);
+
+        wstring childPath;
+
+        for (auto child = node.children;  child < node.next;  ) {
+            TrieNode childNode;
+            if (!readNode(child, node.next, childNode))
+                return false;
+
+            childPath = path;
+            if (!childPath.empty() && childPath.back() != L'/')
+                childPath += L'/';
+            appendUtf8(childPath, childNode.name);
+
+            if (!visit(child, node.next, ordinal, childPath))
+                return false;
+
+            child = childNode.next;
+        }
+
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void requiredTrigrams (const MatchPlan& plan, vector<uint32_t>& trigrams)
+    {
+        // Collect the trigrams of the literals that every matching path must contain: those
+        // required by each component pattern before the span, and by the span pattern.
+
+        auto addFilter = [&trigrams](const LiteralFilter& filter) {
+            addTrigrams(toUtf8(filter.prefix), trigrams);
+            addTrigrams(toUtf8(filter.suffix), trigrams);
+            for (const auto& literal : filter.literals)
+                addTrigrams(toUtf8(literal), trigrams);
+        };
+
+        auto span = plan.spanIndex();
+
+        for (size_t index = 0;  index < span;  ++index) {
+            if (!plan.isRoot(index) && !plan.isParent(index))
+                addFilter(plan.compiled(index).pathFilter());
+        }
+
+        if (span < plan.size()) {
+            if (plan.spanPrefix())
+                addFilter(plan.spanPrefix()->pathFilter());
+            addFilter(plan.spanPattern().pathFilter());
+        }
+
+        sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    }
+}
+
+
+//==================================================================================================
+// PathIndex
+//==================================================================================================
+
+namespace {
+
+    //----------------------------------------------------------------------------------------------
+    bool writeIndex (
+        const fs::path&  root,
+        const fs::path&  file,
+        const uint8_t*   oldNodes,
+        const uint8_t*   oldEnd,
+        int64_t          trustedTime,
+        bool             trigrams,
+        wstring&         error,
+        IndexBuildStats& stats)
+    {
+        // Write the index of the tree under the given root to the given file, reusing nodes from
+        // the old index if one is given. The index is assembled in memory first, since each
+        // directory node leads with the length of its descendants, and the trigram tables are
+        // built from the finished trie.
+
+        auto rootPath = toUtf8(normalizedRoot(root));
+
+        IndexHeader header {};
+        memcpy(header.magic, c_magic, sizeof(c_magic));
+        header.version    = c_version;
+        header.rootOffset = sizeof(header);
+        header.rootLength = rootPath.size();
+        header.nodesOffset = header.rootOffset + header.rootLength;
+        header.buildTime  = fileTicks(fs::file_time_type::clock::now());
+
+        TrieWriter writer;
+        Indexer    indexer (writer, stats, oldEnd, trustedTime);
+
+        TrieNode oldRoot;
+        bool hasOld = oldNodes && readNode(oldNodes, oldEnd, oldRoot);
+
+        ++stats.directories;
+        indexer.addDirectory(root, "", "", hasOld ? &oldRoot : nullptr);
+
+        if ((oldNodes && !hasOld) || indexer.oldCorrupt()) {
+            error = L"Index file is corrupt; rebuild the index";
+            return false;
+        }
+
+        const auto& nodes = writer.data();
+
+        header.entryCount  = writer.count();
+        header.nodesLength = nodes.size();
+
+        TrigramBuilder trigramBuilder (nodes, normalizedRoot(root));
+
+        auto end = header.nodesOffset + header.nodesLength;
+
+        if (trigrams) {
+            trigramBuilder.build();
+            header.flags           |= TrigramsFlag;
+            header.entryTableOffset = end;
+            header.trigramsOffset   = header.entryTableOffset + header.entryCount * sizeof(EntryRecord);
+            header.trigramCount     = trigramBuilder.trigrams().size();
+            header.postingsOffset   = header.trigramsOffset + header.trigramCount * sizeof(TrigramRecord);
+            header.postingsLength   = trigramBuilder.postings().size();
+            end = header.postingsOffset + header.postingsLength;
+        }
+
+        ofstream out (file, ios::binary | ios::trunc);
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(rootPath.data(), rootPath.size());
+        out.write(nodes.data(), nodes.size());
+
+        if (trigrams) {
+            const auto& entries  = trigramBuilder.entries();
+            const auto& table    = trigramBuilder.trigrams();
+            const auto& postings = trigramBuilder.postings();
+
+            out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(EntryRecord));
+            out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(TrigramRecord));
+            out.write(postings.data(), postings.size());
+        }
+
+        out.close();
+
+        if (!out) {
+            error = L"Unable to write index file '" + file.wstring() + L"'";
+            return false;
+        }
+
+        stats.bytes = end;
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool replaceFile (const fs::path& tempFile, const fs::path& file, wstring& error)
+    {
+        // Replace the file with the temporary file. Queries running against the old file keep
+        // seeing it whole.
+
+        error_code errorCode;
+        fs::rename(tempFile, file, errorCode);
+
+        if (errorCode) {
+            error = L"Unable to replace index file '" + file.wstring() + L"'";
+            fs::remove(tempFile, errorCode);
+            return false;
+        }
+
+        return true;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathIndex::build (
+    const fs::path&  root,
+    const fs::path&  file,
+    bool             trigrams,
+    wstring&         error,
+    IndexBuildStats* stats)
+{
+    // The index is written to a temporary file, which then replaces the destination file, so that
+    // queries running against an existing index never see a partially written one.
+
+    error_code errorCode;
+
+    if (!fs::is_directory(root.empty() ? fs::path(L".") : root, errorCode)) {
+        error = L"'" + root.wstring() + L"' is not a directory";
+        return false;
+    }
+
+    auto tempFile = file;
+    tempFile += L".tmp";
+
+    IndexBuildStats buildStats;
+
+    if (!writeIndex(root, tempFile, nullptr, nullptr, 0, trigrams, error, buildStats)) {
+        fs::remove(tempFile, errorCode);
+        return false;
+    }
+
+    if (!replaceFile(tempFile, file, error))
+        return false;
+
+    if (stats)
+        *stats = buildStats;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathIndex::refresh (const fs::path& file, wstring& error, IndexBuildStats* stats)
+{
+    auto tempFile = file;
+    tempFile += L".tmp";
+
+    IndexBuildStats buildStats;
+    error_code      errorCode;
+
+    {
+        // The old index must be closed before it can be replaced (on Windows).
+
+        PathIndex old;
+        if (!old.open(file, error))
+            return false;
+
+        fs::path root = old.m_root;
+
+        if (!fs::is_directory(root.empty() ? fs::path(L".") : root, errorCode)) {
+            error = L"Index root '" + old.m_root + L"' is not a directory";
+            return false;
+        }
+
+        auto trustedTime = old.m_buildTime
+                         - chrono::duration_cast<fs::file_time_type::duration>(c_racyInterval).count();
+
+        auto trigrams = old.hasTrigrams();
+
+        if (!writeIndex(root, tempFile, old.m_nodes, old.m_nodesEnd, trustedTime, trigrams, error, buildStats)) {
+            fs::remove(tempFile, errorCode);
+            return false;
+        }
+    }
+
+    if (!replaceFile(tempFile, file, error))
+        return false;
+
+    if (stats)
+        *stats = buildStats;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathIndex::open (const fs::path& file, wstring& error)
+{
+    m_root.clear();
+    m_entryCount = 0;
+    m_nodes = m_nodesEnd = nullptr;
+    m_entryTable = nullptr;
+    m_trigramTable = nullptr;
+    m_trigramCount = 0;
+    m_postings = m_postingsEnd = nullptr;
+
+    if (!m_file.open(file)) {
+        error = L"Unable to read index file '" + file.wstring() + L"'";
+        return false;
+    }
+
+    auto invalid = [&]() {
+        m_file.close();
+        error = L"'" + file.wstring() + L"' is not a valid pathmatch index";
+        return false;
+    };
+
+    auto data = m_file.data();
+    auto size = m_file.size();
+
+    // Returns true if the given region lies within the file.
+    auto inFile = [size](uint64_t offset, uint64_t length) {
+        return offset <= size && length <= size - offset;
+    };
+
+    IndexHeader header;
+
+    if (size < sizeof(header))
+        return invalid();
+
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, c_magic, sizeof(c_magic)) != 0)
+        return invalid();
+
+    if (header.version != c_version) {
+        m_file.close();
+        error = L"Index file '" + file.wstring() + L"' has format version "
+              + to_wstring(header.version) + L" (expected " + to_wstring(c_version)
+              + L"); rebuild the index";
+        return false;
+    }
+
+    if (!inFile(header.rootOffset, header.rootLength) || !inFile(header.nodesOffset, header.nodesLength))
+        return invalid();
+
+    if ((header.flags & TrigramsFlag)
+        && (header.entryCount > size / sizeof(EntryRecord)
+            || header.trigramCount > size / sizeof(TrigramRecord)
+            || !inFile(header.entryTableOffset, header.entryCount * sizeof(EntryRecord))
+            || !inFile(header.trigramsOffset, header.trigramCount * sizeof(TrigramRecord))
+            || !inFile(header.postingsOffset, header.postingsLength))) {
+        return invalid();
+    }
+
+    // The root node must span all of the node data.
+
+    auto nodes    = data + header.nodesOffset;
+    auto nodesEnd = nodes + header.nodesLength;
+
+    TrieNode root;
+    if (!readNode(nodes, nodesEnd, root) || root.next != nodesEnd || !(root.flags & DirectoryFlag))
+        return invalid();
+
+    appendUtf8(m_root, {reinterpret_cast<const char*>(data + header.rootOffset), header.rootLength});
+
+    m_entryCount = header.entryCount;
+    m_buildTime  = header.buildTime;
+    m_nodes      = nodes;
+    m_nodesEnd   = nodesEnd;
+
+    if (header.flags & TrigramsFlag) {
+        m_entryTable   = data + header.entryTableOffset;
+        m_trigramTable = data + header.trigramsOffset;
+        m_trigramCount = header.trigramCount;
+        m_postings     = data + header.postingsOffset;
+        m_postingsEnd  = m_postings + header.postingsLength;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathIndex::match (
+    const wstring& pattern,
+    MatchCallback* callback,
+    void*          userData,
+    MatchStats*    stats) const
+{
+    return match(MatchPlan(pattern), callback, userData, stats);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathIndex::match (
+    const MatchPlan& plan,
+    MatchCallback*   callback,
+    void*            userData,
+    MatchStats*      stats) const
+{
+    // Patterns that require literal text are answered from the trigram posting lists, if the index
+    // has them. All other patterns walk the trie.
+
+    if (!callback || !m_nodes || plan.empty())
+        return false;
+
+    MatchStats queryStats;
+    bool       result;
+
+    vector<uint32_t> trigrams;
+    if (hasTrigrams())
+        requiredTrigrams(plan, trigrams);
+
+    if (!trigrams.empty()) {
+        result = trigramMatch(plan, trigrams, callback, userData, queryStats);
+    } else {
+        TrieNode root;
+        result = readNode(m_nodes, m_nodesEnd, root)
+              && TrieQuery(plan, callback, userData, queryStats).run(root, m_root);
+    }
+
+    if (stats)
+        *stats = queryStats;
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathIndex::postingList (uint32_t trigram, vector<uint64_t>& list) const
+{
+    // Decode the posting list of the given trigram into 'list'. Returns false if the posting data
+    // is malformed; a trigram that appears in no path has an empty list.
+
+    list.clear();
+
+    // Binary search the trigram table.
+
+    size_t low = 0, high = m_trigramCount;
+    TrigramRecord record {};
+
+    while (low < high) {
+        auto mid = low + (high - low) / 2;
+        memcpy(&record, m_trigramTable + mid * sizeof(record), sizeof(record));
+        if (record.trigram < trigram)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low == m_trigramCount)
+        return true;
+
+    memcpy(&record, m_trigramTable + low * sizeof(record), sizeof(record));
+    if (record.trigram != trigram)
+        return true;
+
+    if (record.offset > static_cast<uint64_t>(m_postingsEnd - m_postings) || record.count > m_entryCount)
+        return false;
+
+    auto ptr = m_postings + record.offset;
+    uint64_t ordinal = 0;
+
+    list.reserve(record.count);
+
+    for (uint64_t i = 0;  i < record.count;  ++i) {
+        uint64_t delta;
+        if (!readVarint(ptr, m_postingsEnd, delta))
+            return false;
+        ordinal += delta;
+        list.push_back(ordinal);
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathIndex::trigramMatch (
+    const MatchPlan&        plan,
+    const vector<uint32_t>& trigrams,
+    MatchCallback*          callback,
+    void*                   userData,
+    MatchStats&             stats) const
+{
+    // Intersect the posting lists of the required trigrams, shortest first, to get the candidate
+    // entries. Each candidate's path is then rebuilt from the entry table and confirmed with a
+    // full match. Candidates are in ordinal order, which is the order of a trie walk.
+
+    vector<vector<uint64_t>> lists (trigrams.size());
+
+    for (size_t i = 0;  i < trigrams.size();  ++i) {
+        if (!postingList(trigrams[i], lists[i]))
+            return false;
+        if (lists[i].empty())
+            return true;
+    }
+
+    sort(lists.begin(), lists.end(),
+         [](const vector<uint64_t>& a, const vector<uint64_t>& b) { return a.size() < b.size(); });
+
+    auto candidates = std::move(lists[0]);
+
+    for (size_t i = 1;  i < lists.size() && !candidates.empty();  ++i) {
+        vector<uint64_t> both;
+        set_intersection(candidates.begin(), candidates.end(), lists[i].begin(), lists[i].end(),
+                         back_inserter(both));
+        candidates.swap(both);
+    }
+
+    vector<string_view> names;          // Names from the candidate up to the root
+    wstring             path;           // Full path
+    vector<wstring>     components;     // Components of the full path
+    vector<size_t>      offsets;        // Offset of each component in the full path
+
+    for (auto ordinal : candidates) {
+        ++stats.entriesRead;
+
+        if (ordinal == 0 && m_root.empty())
+            continue;   // The current directory itself is never reported.
+
+        // Gather the names on the way up to the root.
+
+        names.clear();
+        uint8_t flags = 0;
+
+        for (auto entry = ordinal;  entry != c_noParent;  ) {
+            EntryRecord record;
+            TrieNode    node;
+
+            if (entry >= m_entryCount)
+                return false;
+
+            memcpy(&record, m_entryTable + entry * sizeof(record), sizeof(record));
+
+            if (record.node >= static_cast<uint64_t>(m_nodesEnd - m_nodes)
+                || !readNode(m_nodes + record.node, m_nodesEnd, node)
+                || (record.parent != c_noParent && record.parent >= entry)) {
+                return false;
+            }
+
+            if (entry == ordinal)
+                flags = node.flags;
+            if (record.parent != c_noParent)
+                names.push_back(node.name);
+
+            entry = record.parent;
+        }
+
+        path = m_root;
+        for (auto name = names.rbegin();  name != names.rend();  ++name) {
+            if (!path.empty() && path.back() != L'/')
+                path += L'/';
+            appendUtf8(path, *name);
+        }
+
+        splitPath(path, components, offsets);
+
+        auto isDirectory = (flags & DirectoryFlag) != 0;
+
+        if (!entryMatches(plan, path, components, offsets, isDirectory, stats.prefilter))
+            continue;
+
+        ++stats.matchesReported;
+        if (!callback(path, isDirectory, userData))
+            break;
+    }
+
+    return true;
+}
+
+
+}; // Namespace PathMatch
@@ -0,0 +1,207 @@
+#ifndef _INCLUDED_PATHINDEX_H
+//==================================================================================================
+// pathindex.h
+//
+// Declarations for the PathIndex object, a persistent snapshot of a directory tree that answers
+// path patterns without touching the file system.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATHINDEX_H
+
+
+#include "mappedfile.h"
+#include "pathmatcher.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+// Encode a wide string in UTF-8, as paths are stored in index files.
+std::string toUtf8 (std::wstring_view str);
+
+// Decode UTF-8 and append it to a wide string. Malformed sequences decode to U+FFFD.
+void appendUtf8 (std::wstring& result, std::string_view str);
+
+// Append the trigrams of the given (lowercase UTF-8) text: each run of three bytes, packed with the
+// first byte highest.
+void addTrigrams (std::string_view text, std::vector<uint32_t>& trigrams);
+
+
+struct IndexBuildStats
+{
+    uint64_t directories {0};        // Directories indexed (including the root)
+    uint64_t files {0};              // Other entries indexed
+    uint64_t bytes {0};              // Size of the index file
+    uint64_t directoriesListed {0};  // Directories read from the file system
+    uint64_t directoriesReused {0};  // Directories whose entries were carried over from the old index
+};
+
+
+class PathIndex
+{
+    //----------------------------------------------------------------------------------------------
+    // A PathIndex is a file that records every entry in a directory tree: its name, and whether
+    // it's a directory. Entries are stored as a trie of nodes in depth-first order, with the
+    // entries of each directory sorted by their lowercase UTF-8 names (then by their exact names).
+    // Each directory node records the length of its descendants, so a query can step over a whole
+    // subtree without decoding it, and the offset of each child, so a query for a literal name can
+    // binary search the directory's entries.
+    //
+    // An opened index is memory mapped, so it costs little to open, and its pages are shared among
+    // all processes that query the same index.
+    //
+    // Each directory whose contents were read also records its modification time. An index can
+    // then be refreshed cheaply: only directories whose modification time has changed are read
+    // again, and the entries of the others are carried over from the old index.
+    //
+    // Index file layout (all integers little-endian):
+    //
+    //     Header             see IndexHeader in pathindex.cpp
+    //     Root path          UTF-8, not null terminated
+    //     Nodes              per node: varint name length, UTF-8 name bytes, flags byte
+    //                        (EntryFlags), a varint length and the UTF-8 bytes of the lowercase
+    //                        name if it differs from the name, a zigzag varint modification time
+    //                        for listed directories, and a uint64 descendant byte length for
+    //                        directories. A directory's descendants lead with a uint64 child
+    //                        count and a uint64 offset of each child (relative to the first
+    //                        child); then the children and their descendants follow. The root
+    //                        node has an empty name.
+    //
+    // An index may also hold trigram posting lists, for patterns whose literals could lie anywhere
+    // in a path. Each trigram (three UTF-8 bytes of a lowercase full path) lists the ordinals of
+    // the entries whose paths contain it, so the candidates for a pattern are the intersection of
+    // the lists of the trigrams in its required literals. These sections follow the nodes:
+    //
+    //     Entry table        per entry (in depth-first order): uint64 node offset, uint64 parent
+    //                        entry ordinal
+    //     Trigram table      per trigram (ascending): uint32 trigram, uint32 zero, uint64 posting
+    //                        list offset, uint64 posting list entry count
+    //     Posting lists      per list: varint deltas between ascending entry ordinals
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    // Entry flag bits.
+    enum EntryFlags : uint8_t
+    {
+        DirectoryFlag = 1,    // The entry is a directory (or a link to one)
+        ListedFlag    = 2,    // The directory's contents (and modification time) are recorded
+        LinkFlag      = 4,    // The directory is a link, and was not followed
+        FoldedFlag    = 8     // The lowercase name differs from the name, and is recorded too
+    };
+
+    PathIndex() = default;
+
+    // Walk the tree under the given root, and write its index to the given file. Directories that
+    // can't be read are indexed without their contents, and links to directories are not followed.
+    // If 'trigrams' is true, the index also holds trigram posting lists. Returns false (with a
+    // description in 'error') if the index file can't be written.
+    static bool build (
+        const std::filesystem::path& root,
+        const std::filesystem::path& file,
+        bool                         trigrams,
+        std::wstring&                error,
+        IndexBuildStats*             stats = nullptr);
+
+    // Bring an existing index file up to date with the file system. Each directory is read again
+    // only if its modification time differs from the one recorded in the index (or is too recent
+    // to be trusted); otherwise its entries are carried over. The index root is resolved from the
+    // current directory, as it was when the index was built. Trigram posting lists are rebuilt if
+    // the index has them. Returns false (with a description in
+    // 'error') if the index can't be read or written.
+    static bool refresh (
+        const std::filesystem::path& file,
+        std::wstring&                error,
+        IndexBuildStats*             stats = nullptr);
+
+    // Open an index file. Returns false (with a description in 'error') if the file can't be read,
+    // or isn't a valid index.
+    bool open (const std::filesystem::path& file, std::wstring& error);
+
+    // The root path of the indexed tree, as given to build() (lexically normalized, with forward
+    // slashes). An empty root is the directory that was current when the index was built.
+    const std::wstring& root() const { return m_root; }
+
+    // The number of indexed entries, including the root.
+    uint64_t size() const { return m_entryCount; }
+
+    // True if the index holds trigram posting lists.
+    bool hasTrigrams() const { return m_trigramTable != nullptr; }
+
+    // The callback function signature used to report matching entries.
+    using MatchCallback = bool (const std::wstring& path, bool isDirectory, void* userData);
+
+    // Report every indexed entry that matches the pattern: the same entries PathMatcher::match
+    // would report from the directory where the index was built, provided they lie within the
+    // indexed tree. Names are compared without regard to case. Reported paths use forward slashes.
+    // The callback returns false to halt the query. Returns false if the pattern is empty or the
+    // index isn't open. Subtrees that can't hold a match are skipped without being read. If
+    // 'stats' is given, it receives the query's counters.
+    bool match (
+        const std::wstring& pattern,
+        MatchCallback*      callback,
+        void*               userData,
+        MatchStats*         stats = nullptr) const;
+
+    // Report every indexed entry that matches an already compiled pattern.
+    bool match (
+        const MatchPlan& plan,
+        MatchCallback*   callback,
+        void*            userData,
+        MatchStats*      stats = nullptr) const;
+
+  private:
+
+    bool postingList (uint32_t trigram, std::vector<uint64_t>& list) const;
+
+    bool trigramMatch (
+        const MatchPlan&             plan,
+        const std::vector<uint32_t>& trigrams,
+        MatchCallback*               callback,
+        void*                        userData,
+        MatchStats&                  stats) const;
+
+    MappedFile     m_file;                // Mapped index file
+    std::wstring   m_root;                // Root path
+    uint64_t       m_entryCount {0};      // Number of entries
+    int64_t        m_buildTime {0};       // File time when the index was built
+    const uint8_t* m_nodes {nullptr};     // Start of the node data (the root node)
+    const uint8_t* m_nodesEnd {nullptr};
+    const uint8_t* m_entryTable {nullptr};     // Entry table (trigram indexes only)
+    const uint8_t* m_trigramTable {nullptr};   // Trigram table (trigram indexes only)
+    uint64_t       m_trigramCount {0};         // Number of trigrams
+    const uint8_t* m_postings {nullptr};       // Posting lists (trigram indexes only)
+    const uint8_t* m_postingsEnd {nullptr};
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_PATHINDEX_H
@@ -0,0 +1,509 @@
+//==================================================================================================
+// ruleset.cpp
+//
+// Implementation of the RuleSet object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "ruleset.h"
+#include "pathindex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string_view>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+
+namespace PathMatch {
+
+struct RuleSet::RuleRecord
+{
+    uint64_t textOffset;    // Offset of the rule text, relative to the start of the text
+    uint32_t textLength;    // Length of the rule text, in bytes
+    uint32_t flags;         // RuleFlags
+};
+
+struct RuleSet::KeyRecord
+{
+    uint32_t key;           // Rule key (see below)
+    uint32_t count;         // Number of rules filed under the key
+    uint64_t offset;        // Offset of the key's rule list, in rule ordinals
+};
+
+}; // Namespace PathMatch
+
+
+namespace {
+
+    const char     c_magic[8] { 'P', 'M', 'R', 'U', 'L', 'E', 'S', 0 };
+    const uint32_t c_version = 1;
+
+    struct RuleSetHeader
+    {
+        char     magic[8];          // c_magic
+        uint32_t version;           // c_version
+        uint32_t reserved;          // Zero
+        uint64_t ruleCount;         // Number of rules
+        uint64_t keyCount;          // Number of keys
+        uint64_t listLength;        // Total length of the rule lists, in rule ordinals
+        uint64_t textLength;        // Length of the rule text, in bytes
+    };
+
+    enum RuleFlags : uint32_t
+    {
+        DirsOnlyFlag = 1            // The rule matches directories only
+    };
+
+    // A rule key is a trigram (three UTF-8 bytes, first byte highest) with a zero high byte, or a
+    // path prefix or suffix of one to three bytes, with the high byte giving its type and length.
+    // Rules without a key are filed under c_noKey, which sorts last.
+
+    const uint32_t c_prefixTag = 0;     // Prefix of length n: high byte c_prefixTag + n
+    const uint32_t c_suffixTag = 3;     // Suffix of length n: high byte c_suffixTag + n
+    const uint32_t c_noKey     = UINT32_MAX;
+
+    //----------------------------------------------------------------------------------------------
+    uint32_t affixKey (string_view text, uint32_t tag)
+    {
+        // Return the key of a path prefix or suffix (of up to three bytes) taken from the text.
+
+        uint32_t key = 0;
+        for (auto c : text)
+            key = (key << 8) | static_cast<uint8_t>(c);
+        return ((tag + static_cast<uint32_t>(text.size())) << 24) | key;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void addAffixKeys (string_view text, vector<uint32_t>& keys)
+    {
+        // Append the prefix and suffix keys of a (lowercase UTF-8) path.
+
+        for (size_t length = 1;  length <= 3 && length <= text.size();  ++length) {
+            keys.push_back(affixKey(text.substr(0, length), c_prefixTag));
+            keys.push_back(affixKey(text.substr(text.size() - length), c_suffixTag));
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    string lowercaseUtf8 (const wstring& path)
+    {
+        // Return the lowercase UTF-8 form of a path, with forward slashes.
+
+        auto lower = PathMatch::lowercase(path);
+        replace(lower.begin(), lower.end(), L'\\', L'/');
+        return PathMatch::toUtf8(lower);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void ruleKeys (const wstring& rule, vector<uint32_t>& keys)
+    {
+        // Collect the keys that a rule could be filed under: the trigrams of its required
+        // literals, and the prefix and suffix keys of its anchored literals.
+
+        auto filter = PathMatch::extractLiteralFilter(rule);
+
+        // A rule that is one plain literal is anchored at both ends.
+
+        auto suffix = filter.suffix;
+        if (suffix.empty() && filter.maxLength == filter.prefix.size())
+            suffix = filter.prefix;
+
+        if (!filter.prefix.empty()) {
+            auto prefix = PathMatch::toUtf8(filter.prefix);
+            keys.push_back(affixKey(string_view(prefix).substr(0, 3), c_prefixTag));
+            PathMatch::addTrigrams(prefix, keys);
+        }
+
+        if (!suffix.empty()) {
+            auto text = PathMatch::toUtf8(suffix);
+            keys.push_back(affixKey(string_view(text).substr(text.size() - min<size_t>(3, text.size())),
+                                    c_suffixTag));
+            PathMatch::addTrigrams(text, keys);
+        }
+
+        for (const auto& literal : filter.literals)
+            PathMatch::addTrigrams(PathMatch::toUtf8(literal), keys);
+
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void parseRules (string_view text, vector<wstring>& rules)
+    {
+        // Split rule file text into rules, one per line, skipping blank lines and comments.
+
+        if (text.starts_with("\xEF\xBB\xBF"))
+            text.remove_prefix(3);
+
+        while (!text.empty()) {
+            auto end  = text.find('\n');
+            auto line = text.substr(0, end);
+            text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            rules.emplace_back();
+            PathMatch::appendUtf8(rules.back(), line);
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool isRuleFile (const uint8_t* data, size_t size)
+    {
+        return size >= sizeof(c_magic) && memcmp(data, c_magic, sizeof(c_magic)) == 0;
+    }
+}
+
+
+namespace PathMatch {
+
+//--------------------------------------------------------------------------------------------------
+void RuleSet::assign (const vector<wstring>& rules)
+{
+    // Gather the rules and their candidate keys, then file each rule under its least shared key,
+    // and lay out the compiled form in memory.
+
+    struct Rule
+    {
+        wstring          text;        // Rule text, without trailing slashes
+        uint32_t         flags {0};
+        vector<uint32_t> keys;        // Candidate keys
+        uint32_t         key {c_noKey};
+    };
+
+    vector<Rule> ruleList;
+    unordered_map<uint32_t, uint32_t> keyUse;   // Number of rules that could use each key
+
+    for (const auto& text : rules) {
+        Rule rule;
+        rule.text = text;
+
+        if (!rule.text.empty() && (rule.text.back() == L'/' || rule.text.back() == L'\\')) {
+            rule.flags |= DirsOnlyFlag;
+            while (!rule.text.empty() && (rule.text.back() == L'/' || rule.text.back() == L'\\'))
+                rule.text.pop_back();
+        }
+
+        if (rule.text.empty())
+            continue;
+
+        ruleKeys(rule.text, rule.keys);
+        for (auto key : rule.keys)
+            ++keyUse[key];
+
+        ruleList.push_back(std::move(rule));
+    }
+
+    map<uint32_t, vector<uint32_t>> keyRules;   // Rules filed under each key, by key
+    string text;
+    vector<RuleRecord> ruleTable;
+
+    for (size_t i = 0;  i < ruleList.size();  ++i) {
+        auto& rule = ruleList[i];
+
+        for (auto key : rule.keys) {
+            if (rule.key == c_noKey || keyUse[key] < keyUse[rule.key])
+                rule.key = key;
+        }
+
+        keyRules[rule.key].push_back(static_cast<uint32_t>(i));
+
+        auto utf8 = toUtf8(rule.text);
+        ruleTable.push_back({text.size(), static_cast<uint32_t>(utf8.size()), rule.flags});
+        text += utf8;
+    }
+
+    vector<KeyRecord> keyTable;
+    vector<uint32_t>  lists;
+
+    for (const auto& [key, list] : keyRules) {
+        keyTable.push_back({key, static_cast<uint32_t>(list.size()), lists.size()});
+        lists.insert(lists.end(), list.begin(), list.end());
+    }
+
+    RuleSetHeader header {};
+    memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.version    = c_version;
+    header.ruleCount  = ruleTable.size();
+    header.keyCount   = keyTable.size();
+    header.listLength = lists.size();
+    header.textLength = text.size();
+
+    m_file.close();
+    m_buffer.clear();
+
+    auto append = [this](const void* data, size_t size) {
+        m_buffer.append(static_cast<const char*>(data), size);
+    };
+
+    append(&header, sizeof(header));
+    append(ruleTable.data(), ruleTable.size() * sizeof(RuleRecord));
+    append(keyTable.data(), keyTable.size() * sizeof(KeyRecord));
+    append(lists.data(), lists.size() * sizeof(uint32_t));
+    append(text.data(), text.size());
+
+    attach(reinterpret_cast<const uint8_t*>(m_buffer.data()), m_buffer.size());
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool RuleSet::open (const fs::path& file, wstring& error)
+{
+    m_file.close();
+    m_buffer.clear();
+    attach(nullptr, 0);
+
+    if (!m_file.open(file)) {
+        error = L"Unable to read rule file '" + file.wstring() + L"'";
+        return false;
+    }
+
+    if (!isRuleFile(m_file.data(), m_file.size())) {
+        vector<wstring> rules;
+        parseRules({reinterpret_cast<const char*>(m_file.data()), m_file.size()}, rules);
+        assign(rules);
+        return true;
+    }
+
+    RuleSetHeader header;
+
+    if (m_file.size() >= sizeof(header)) {
+        memcpy(&header, m_file.data(), sizeof(header));
+        if (header.version != c_version) {
+            m_file.close();
+            error = L"Rule file '" + file.wstring() + L"' has format version "
+                  + to_wstring(header.version) + L" (expected " + to_wstring(c_version)
+                  + L"); compile it again";
+            return false;
+        }
+    }
+
+    if (!attach(m_file.data(), m_file.size())) {
+        m_file.close();
+        error = L"'" + file.wstring() + L"' is not a valid pathmatch rule file";
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool RuleSet::write (const fs::path& file, wstring& error) const
+{
+    // Write to a temporary file and then replace the rule file, so that runs that have the old rule
+    // file mapped keep seeing it whole.
+
+    auto tempFile = file;
+    tempFile += L".tmp";
+
+    ofstream out (tempFile, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(m_data), m_size);
+    out.close();
+
+    error_code errorCode;
+
+    if (out)
+        fs::rename(tempFile, file, errorCode);
+
+    if (!out || errorCode) {
+        fs::remove(tempFile, errorCode);
+        error = L"Unable to write rule file '" + file.wstring() + L"'";
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool RuleSet::readRules (const fs::path& file, vector<wstring>& rules, wstring& error)
+{
+    MappedFile mapped;
+
+    if (!mapped.open(file)) {
+        error = L"Unable to read rule file '" + file.wstring() + L"'";
+        return false;
+    }
+
+    if (isRuleFile(mapped.data(), mapped.size())) {
+        error = L"'" + file.wstring() + L"' is already a compiled rule file";
+        return false;
+    }
+
+    parseRules({reinterpret_cast<const char*>(mapped.data()), mapped.size()}, rules);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool RuleSet::attach (const uint8_t* data, size_t size)
+{
+    // Locate the tables of the compiled rules. Only the table bounds are checked here, so that
+    // this takes the same time for any number of rules; offsets within the tables are checked as
+    // they're used.
+
+    m_data = data;
+    m_size = size;
+    m_ruleCount = m_keyCount = m_listsLength = m_textLength = 0;
+    m_rules = nullptr;
+    m_keys  = nullptr;
+    m_lists = nullptr;
+    m_text  = nullptr;
+    m_compiled.clear();
+
+    RuleSetHeader header;
+
+    if (!data || size < sizeof(header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+
+    if (!isRuleFile(data, size) || header.version != c_version)
+        return false;
+
+    // Each table must fit in what remains of the data after the tables before it.
+
+    auto offset = uint64_t{sizeof(header)};
+
+    auto fits = [&](uint64_t count, uint64_t recordSize) {
+        if (count > (size - offset) / recordSize)
+            return false;
+        offset += count * recordSize;
+        return true;
+    };
+
+    auto rulesOffset = offset;
+    if (!fits(header.ruleCount, sizeof(RuleRecord)))  return false;
+    auto keysOffset = offset;
+    if (!fits(header.keyCount, sizeof(KeyRecord)))    return false;
+    auto listsOffset = offset;
+    if (!fits(header.listLength, sizeof(uint32_t)))   return false;
+    auto textOffset = offset;
+    if (!fits(header.textLength, 1))                  return false;
+
+    m_ruleCount   = header.ruleCount;
+    m_keyCount    = header.keyCount;
+    m_listsLength = header.listLength;
+    m_textLength  = header.textLength;
+    m_rules = reinterpret_cast<const RuleRecord*>(data + rulesOffset);
+    m_keys  = reinterpret_cast<const KeyRecord*>(data + keysOffset);
+    m_lists = reinterpret_cast<const uint32_t*>(data + listsOffset);
+    m_text  = reinterpret_cast<const char*>(data + textOffset);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool RuleSet::matches (const wstring& path, bool isDirectory)
+{
+    // Test the path against the rules filed under each of its keys, and then against the rules
+    // that have no key.
+
+    if (!m_ruleCount)
+        return false;
+
+    auto text = lowercaseUtf8(path);
+
+    m_pathKeys.clear();
+    addTrigrams(text, m_pathKeys);
+    addAffixKeys(text, m_pathKeys);
+    sort(m_pathKeys.begin(), m_pathKeys.end());
+    m_pathKeys.erase(unique(m_pathKeys.begin(), m_pathKeys.end()), m_pathKeys.end());
+    m_pathKeys.push_back(c_noKey);
+
+    bool matched = false;
+
+    for (auto key : m_pathKeys) {
+        testKey(key, path, isDirectory, matched);
+        if (matched)
+            return true;
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void RuleSet::testKey (uint32_t key, const wstring& path, bool isDirectory, bool& matched)
+{
+    // Test the path against the rules filed under the given key.
+
+    auto keysEnd = m_keys + m_keyCount;
+    auto record  = lower_bound(m_keys, keysEnd, key,
+                               [](const KeyRecord& r, uint32_t k) { return r.key < k; });
+
+    if (record == keysEnd || record->key != key)
+        return;
+
+    if (record->offset > m_listsLength || record->count > m_listsLength - record->offset)
+        return;
+
+    for (auto rule = m_lists + record->offset;  rule < m_lists + record->offset + record->count;  ++rule) {
+        if (testRule(*rule, path, isDirectory)) {
+            matched = true;
+            return;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool RuleSet::testRule (uint32_t rule, const wstring& path, bool isDirectory)
+{
+    // Test the path against a single rule, compiling the rule on first use.
+
+    if (rule >= m_ruleCount)
+        return false;
+
+    const auto& record = m_rules[rule];
+
+    if ((record.flags & DirsOnlyFlag) && !isDirectory)
+        return false;
+
+    auto [compiled, inserted] = m_compiled.try_emplace(rule);
+
+    if (inserted) {
+        if (record.textOffset > m_textLength || record.textLength > m_textLength - record.textOffset)
+            return false;
+
+        wstring pattern;
+        appendUtf8(pattern, string_view(m_text + record.textOffset, record.textLength));
+        compiled->second = CompiledPattern(pattern);
+    }
+
+    return compiled->second.matches(path);
+}
+
+
+}; // Namespace PathMatch
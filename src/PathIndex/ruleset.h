@@ -0,0 +1,140 @@
+#ifndef _INCLUDED_RULESET_H
+//==================================================================================================
+// ruleset.h
+//
+// Declarations for the RuleSet object, which tests paths against a large set of patterns (such as
+// the rules of an ignore file), and which can be saved in a compiled form that loads without
+// parsing.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_RULESET_H
+
+
+#include "compiledpattern.h"
+#include "mappedfile.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+class RuleSet
+{
+    //----------------------------------------------------------------------------------------------
+    // A RuleSet holds a set of path patterns (rules), and reports whether a path matches any of
+    // them. A rule that ends in a slash matches directories only.
+    //
+    // Each rule is filed under a single key: a trigram of the literal text that every matching
+    // path must contain, or the first or last few bytes of the path if the rule is anchored there.
+    // Of the keys a rule could be filed under, the one shared by the fewest rules is chosen. A
+    // path is then tested only against the rules filed under its own trigrams, prefixes and
+    // suffixes, plus the few rules that have no key at all.
+    //
+    // The key table, the rule lists and the rule text can be written to a rule file, which is
+    // mapped into memory when opened, so that loading a rule set takes the same time no matter how
+    // many rules it holds. The file holds no match automata: each rule is compiled the first time
+    // it's tested, into a map held by the RuleSet. Testing a path therefore modifies the RuleSet,
+    // and a RuleSet is not safe to use from more than one thread at a time.
+    //
+    // Rule files start with a header:
+    //
+    //     char[8]  magic       "PMRULES\0"
+    //     uint32   version     Rule file format version
+    //     uint32   reserved    Zero
+    //     uint64   ruleCount   Number of rules
+    //     uint64   keyCount    Number of keys
+    //     uint64   listLength  Total length of the rule lists, in rule ordinals
+    //     uint64   textLength  Length of the rule text, in bytes
+    //
+    // followed by the rule table (ruleCount records of text offset, text length and flags), the
+    // key table (keyCount records of key, rule count and rule list offset, sorted by key), the
+    // rule lists (32-bit rule ordinals), and the rule text (UTF-8, without trailing slashes). All
+    // values are in native byte order.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    RuleSet() = default;
+
+    RuleSet (const RuleSet&) = delete;
+    RuleSet& operator= (const RuleSet&) = delete;
+
+    // Compile the given rules, replacing any current rules. Empty rules are skipped.
+    void assign (const std::vector<std::wstring>& rules);
+
+    // Load rules from the given file, replacing any current rules. A rule file is mapped into
+    // memory; any other file is read as text, with one rule per line. Blank lines and lines that
+    // begin with '#' are skipped. Returns false and sets the error message if the file can't be
+    // read, or is a rule file of the wrong version.
+    bool open (const std::filesystem::path& file, std::wstring& error);
+
+    // Write the keys, rule lists and rule text of the current rules to the given rule file.
+    bool write (const std::filesystem::path& file, std::wstring& error) const;
+
+    // Read the rules of a text file (as described for open()), and append them to the given list.
+    static bool readRules (
+        const std::filesystem::path& file, std::vector<std::wstring>& rules, std::wstring& error);
+
+    // The number of rules.
+    size_t size() const { return m_ruleCount; }
+
+    // True if the given path matches any rule. Compiles the rules it tests that haven't been
+    // compiled yet.
+    bool matches (const std::wstring& path, bool isDirectory);
+
+  private:
+
+    bool attach (const uint8_t* data, size_t size);
+    bool testRule (uint32_t rule, const std::wstring& path, bool isDirectory);
+    void testKey (uint32_t key, const std::wstring& path, bool isDirectory, bool& matched);
+
+    struct RuleRecord;
+    struct KeyRecord;
+
+    MappedFile           m_file;            // Mapped rule file, if the rules were read from one
+    std::string          m_buffer;          // Compiled rules, if they were compiled in memory
+    const uint8_t*       m_data {nullptr};  // Compiled rules
+    size_t               m_size {0};
+
+    uint64_t             m_ruleCount {0};
+    const RuleRecord*    m_rules {nullptr}; // Rule table
+    uint64_t             m_keyCount {0};
+    const KeyRecord*     m_keys {nullptr};  // Key table
+    const uint32_t*      m_lists {nullptr}; // Rule lists
+    uint64_t             m_listsLength {0}; // Number of rule ordinals in the rule lists
+    const char*          m_text {nullptr};  // Rule text
+    uint64_t             m_textLength {0};
+
+    std::unordered_map<uint32_t, CompiledPattern> m_compiled;   // Rules compiled so far
+    std::vector<uint32_t> m_pathKeys;                           // Keys of the tested path
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_RULESET_H
@@ -0,0 +1,252 @@
+//==================================================================================================
+// directorycache.cpp
+//
+// Implementation of the DirectoryCache object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "directorycache.h"
+
+#include <chrono>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+
+namespace {
+
+    // Directories modified less than this long ago may be modified again within the same file time
+    // tick, without a visible change to their modification time, so they aren't cached.
+    const auto c_racyInterval = chrono::seconds(2);
+
+    // Approximate bookkeeping memory for each record, and for each name or entry it holds.
+    const size_t c_recordOverhead = 128;
+    const size_t c_nameOverhead   = 32;
+
+    //----------------------------------------------------------------------------------------------
+    bool isRacy (fs::file_time_type modified)
+    {
+        return modified > fs::file_time_type::clock::now() - c_racyInterval;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    size_t stringBytes (const wstring& str)
+    {
+        return c_nameOverhead + str.size() * sizeof(wchar_t);
+    }
+}
+
+
+namespace PathMatch {
+
+DirectoryCache::DirectoryCache (size_t byteLimit)
+  : m_byteLimit(byteLimit)
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------
+shared_ptr<const DirectoryListing> DirectoryCache::findListing (
+    const wstring& directory, fs::file_time_type modified)
+{
+    lock_guard lock (m_mutex);
+
+    auto record = find(directory, modified);
+
+    if (!record || !record->listing) {
+        ++m_stats.listingMisses;
+        return nullptr;
+    }
+
+    ++m_stats.listingHits;
+    return record->listing;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+shared_ptr<const DirectoryListing> DirectoryCache::storeListing (
+    const wstring& directory, fs::file_time_type modified, DirectoryListing&& listing)
+{
+    // The listing is returned even if it isn't kept, so that the caller has a single way to get
+    // the entries. A listing supersedes any missing names recorded for the directory.
+
+    auto result = make_shared<const DirectoryListing>(std::move(listing));
+
+    size_t bytes = c_recordOverhead + stringBytes(directory);
+    for (const auto& listed : *result) {
+        bytes += sizeof(ListedEntry) + stringBytes(listed.name)
+               + listed.entry.path().native().size() * sizeof(fs::path::value_type);
+    }
+
+    if (bytes > m_byteLimit || isRacy(modified))
+        return result;
+
+    lock_guard lock (m_mutex);
+
+    auto record = insert(directory, modified);
+    record->listing = result;
+    record->missing.clear();
+    resize(*record, bytes);
+    evict();
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryCache::Lookup DirectoryCache::findEntry (
+    const wstring& directory, fs::file_time_type modified, const wstring& name,
+    fs::directory_entry& entry)
+{
+    // An entry missing from a listing is not reported missing, since the file system may match
+    // names without regard to case. It's left to the caller to look up, and record if missing.
+
+    lock_guard lock (m_mutex);
+
+    auto record = find(directory, modified);
+
+    if (record) {
+        if (record->listing) {
+            for (const auto& listed : *record->listing) {
+                if (listed.name == name) {
+                    ++m_stats.entryHits;
+                    entry = listed.entry;
+                    return Lookup::Found;
+                }
+            }
+        }
+
+        if (record->missing.contains(name)) {
+            ++m_stats.negativeHits;
+            return Lookup::Missing;
+        }
+    }
+
+    ++m_stats.entryMisses;
+    return Lookup::Unknown;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void DirectoryCache::storeMissing (
+    const wstring& directory, fs::file_time_type modified, const wstring& name)
+{
+    if (isRacy(modified))
+        return;
+
+    lock_guard lock (m_mutex);
+
+    auto record = insert(directory, modified);
+
+    if (record->missing.insert(name).second) {
+        resize(*record, record->bytes + stringBytes(name));
+        evict();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+size_t DirectoryCache::bytes() const
+{
+    lock_guard lock (m_mutex);
+    return m_bytes;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryCacheStats DirectoryCache::stats() const
+{
+    lock_guard lock (m_mutex);
+    return m_stats;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryCache::Record* DirectoryCache::find (const wstring& directory, fs::file_time_type modified)
+{
+    // Return the record for the given directory, marked as most recently used, or null if there is
+    // none. A record for an earlier modification time is dropped.
+
+    auto found = m_index.find(directory);
+    if (found == m_index.end())
+        return nullptr;
+
+    auto record = found->second;
+
+    if (record->modified != modified) {
+        ++m_stats.invalidations;
+        m_bytes -= record->bytes;
+        m_index.erase(found);
+        m_records.erase(record);
+        return nullptr;
+    }
+
+    m_records.splice(m_records.begin(), m_records, record);
+    return &*record;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryCache::Record* DirectoryCache::insert (const wstring& directory, fs::file_time_type modified)
+{
+    // Return the record for the given directory, creating it if needed.
+
+    if (auto record = find(directory, modified))
+        return record;
+
+    m_records.emplace_front();
+    m_index[directory] = m_records.begin();
+
+    auto& record = m_records.front();
+    record.directory = directory;
+    record.modified  = modified;
+    resize(record, c_recordOverhead + stringBytes(directory));
+    return &record;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void DirectoryCache::resize (Record& record, size_t bytes)
+{
+    m_bytes += bytes - record.bytes;
+    record.bytes = bytes;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void DirectoryCache::evict()
+{
+    // Drop the least recently used records until the cache is within its limit. The most recently
+    // used record is always kept.
+
+    while (m_bytes > m_byteLimit && m_records.size() > 1) {
+        auto& record = m_records.back();
+        ++m_stats.evictions;
+        m_bytes -= record.bytes;
+        m_index.erase(record.directory);
+        m_records.pop_back();
+    }
+}
+
+
+}; // Namespace PathMatch
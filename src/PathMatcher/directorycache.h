@@ -0,0 +1,157 @@
+#ifndef _INCLUDED_DIRECTORYCACHE_H
+//==================================================================================================
+// directorycache.h
+//
+// Declarations for the DirectoryCache object, which keeps the directory listings read by
+// PathMatcher objects, so that later matches in the same process can reuse them.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_DIRECTORYCACHE_H
+
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+struct ListedEntry
+{
+    // A single entry of a cached directory listing.
+
+    std::filesystem::directory_entry entry;   // Directory entry (with an absolute path)
+    std::wstring                     name;    // Entry name
+};
+
+using DirectoryListing = std::vector<ListedEntry>;
+
+
+struct DirectoryCacheStats
+{
+    // Counters for the lookups made in a DirectoryCache.
+
+    uint64_t listingHits {0};     // Listings answered from the cache
+    uint64_t listingMisses {0};   // Listings that had to be read
+    uint64_t entryHits {0};       // Entry lookups answered from a cached listing
+    uint64_t negativeHits {0};    // Entry lookups answered by a record that the entry is missing
+    uint64_t entryMisses {0};     // Entry lookups that had to go to the file system
+    uint64_t invalidations {0};   // Records dropped because their directory had changed
+    uint64_t evictions {0};       // Records dropped to stay within the byte limit
+};
+
+
+class DirectoryCache
+{
+    //----------------------------------------------------------------------------------------------
+    // A DirectoryCache holds the listings (entry names and types) of directories read during
+    // matches, and records of entry names that were looked up in a directory but found missing.
+    // Records are keyed by absolute directory path, and are valid only while the directory's
+    // modification time is unchanged. Directories modified too recently to tell a later change
+    // apart by modification time are not cached. The least recently used records are dropped to
+    // keep the cache within its byte limit.
+    //
+    // A cache is off unless given to PathMatcher::setDirectoryCache(). It may be shared by any
+    // number of matchers, on any number of threads.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    static const size_t mc_DefaultByteLimit = size_t{64} << 20;
+
+    explicit DirectoryCache (size_t byteLimit = mc_DefaultByteLimit);
+
+    // The result of an entry lookup.
+    enum class Lookup
+    {
+        Unknown,   // The cache doesn't know; look in the file system
+        Found,     // The entry exists
+        Missing    // The entry does not exist
+    };
+
+    // Returns the cached listing of the given directory, or null if there is no current listing.
+    // The modification time is the directory's current modification time.
+    std::shared_ptr<const DirectoryListing> findListing (
+        const std::wstring& directory, std::filesystem::file_time_type modified);
+
+    // Store a listing of the given directory, read when it had the given modification time, and
+    // return it.
+    std::shared_ptr<const DirectoryListing> storeListing (
+        const std::wstring& directory, std::filesystem::file_time_type modified,
+        DirectoryListing&& listing);
+
+    // Look up the named entry of the given directory. If the entry is found, it is copied to the
+    // given entry.
+    Lookup findEntry (
+        const std::wstring& directory, std::filesystem::file_time_type modified,
+        const std::wstring& name, std::filesystem::directory_entry& entry);
+
+    // Record that the named entry of the given directory is missing.
+    void storeMissing (
+        const std::wstring& directory, std::filesystem::file_time_type modified,
+        const std::wstring& name);
+
+    // The approximate memory held by the cache, in bytes.
+    size_t bytes() const;
+
+    // The lookup counters accumulated since the cache was created.
+    DirectoryCacheStats stats() const;
+
+  private:
+
+    struct Record
+    {
+        std::wstring                            directory;   // Absolute directory path
+        std::filesystem::file_time_type         modified;    // Directory modification time
+        std::shared_ptr<const DirectoryListing> listing;     // Listing (null if not read)
+        std::unordered_set<std::wstring>        missing;     // Names known to be missing
+        size_t                                  bytes {0};   // Approximate memory held
+    };
+
+    using RecordList = std::list<Record>;
+
+    Record* find (const std::wstring& directory, std::filesystem::file_time_type modified);
+    Record* insert (const std::wstring& directory, std::filesystem::file_time_type modified);
+    void resize (Record& record, size_t bytes);
+    void evict();
+
+    mutable std::mutex  m_mutex;       // Guards all members below
+    size_t              m_byteLimit;   // Maximum memory to hold
+    size_t              m_bytes {0};   // Memory held by all records
+    RecordList          m_records;     // Records, most recently used first
+    DirectoryCacheStats m_stats;
+
+    std::unordered_map<std::wstring, RecordList::iterator> m_index;   // Records by directory
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_DIRECTORYCACHE_H
@@ -0,0 +1,156 @@
+//==================================================================================================
+// directoryprofile.cpp
+//
+// Implementation of the DirectoryProfile object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "directoryprofile.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+namespace PathMatch {
+
+DirectoryProfile::DirectoryProfile (size_t topCount)
+  : m_topCount(topCount)
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------
+double DirectoryProfile::bucketLimit (size_t bucket)
+{
+    return ldexp(1e-6, static_cast<int>(bucket));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void DirectoryProfile::record (const DirectoryTiming& timing)
+{
+    auto seconds = timing.totalSeconds();
+
+    lock_guard lock (m_mutex);
+
+    ++m_directories;
+    m_totalSeconds += seconds;
+
+    size_t bucket = 0;
+    while (bucket + 1 < mc_BucketCount && seconds >= bucketLimit(bucket))
+        ++bucket;
+
+    ++m_histogram[bucket];
+
+    keepTop (m_slowest, timing, &slower);
+    keepTop (m_largest, timing, &larger);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+uint64_t DirectoryProfile::directories() const
+{
+    lock_guard lock (m_mutex);
+    return m_directories;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+double DirectoryProfile::totalSeconds() const
+{
+    lock_guard lock (m_mutex);
+    return m_totalSeconds;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryProfile::Histogram DirectoryProfile::histogram() const
+{
+    lock_guard lock (m_mutex);
+    return m_histogram;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryProfile::slower (const DirectoryTiming& a, const DirectoryTiming& b)
+{
+    return a.totalSeconds() > b.totalSeconds();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryProfile::larger (const DirectoryTiming& a, const DirectoryTiming& b)
+{
+    return a.entries > b.entries;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void DirectoryProfile::keepTop (
+    vector<DirectoryTiming>& heap, const DirectoryTiming& timing, Order* before)
+{
+    // Keep the top entries in a heap ordered so that the front is the entry that would be dropped
+    // next. A new entry only displaces the front if it comes before it.
+
+    if (m_topCount == 0)
+        return;
+
+    if (heap.size() < m_topCount) {
+        heap.push_back(timing);
+        push_heap(heap.begin(), heap.end(), before);
+    } else if (before(timing, heap.front())) {
+        pop_heap(heap.begin(), heap.end(), before);
+        heap.back() = timing;
+        push_heap(heap.begin(), heap.end(), before);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+vector<DirectoryTiming> DirectoryProfile::sorted (vector<DirectoryTiming> heap, Order* before)
+{
+    sort(heap.begin(), heap.end(), before);
+    return heap;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+vector<DirectoryTiming> DirectoryProfile::slowest() const
+{
+    lock_guard lock (m_mutex);
+    return sorted(m_slowest, &slower);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+vector<DirectoryTiming> DirectoryProfile::largest() const
+{
+    lock_guard lock (m_mutex);
+    return sorted(m_largest, &larger);
+}
+
+
+}; // Namespace PathMatch
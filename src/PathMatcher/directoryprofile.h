@@ -0,0 +1,120 @@
+#ifndef _INCLUDED_DIRECTORYPROFILE_H
+//==================================================================================================
+// directoryprofile.h
+//
+// Declarations for the DirectoryProfile object, which collects the open and enumeration latency of
+// each directory that a PathMatcher reads.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_DIRECTORYPROFILE_H
+
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+struct DirectoryTiming
+{
+    // The latency of a single directory read.
+
+    std::wstring path;                // Directory path, as traversed
+    double       openSeconds {0};     // Time to open the directory
+    double       readSeconds {0};     // Time to read and match its entries (excluding the time
+                                      // spent in subdirectories and match callbacks)
+    uint64_t     entries {0};         // Entries read
+
+    double totalSeconds() const { return openSeconds + readSeconds; }
+};
+
+
+class DirectoryProfile
+{
+    //----------------------------------------------------------------------------------------------
+    // A DirectoryProfile collects the latency of every directory that a PathMatcher opens, into a
+    // histogram with power-of-two buckets, and tracks the slowest and the largest directories
+    // seen. Profiling is off unless a profile is given to PathMatcher::setDirectoryProfile(). A
+    // profile accumulates over any number of matches, which may run on any number of threads.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    // Histogram bucket 0 counts latencies under one microsecond, and bucket i (for i > 0) counts
+    // latencies from 2^(i-1) up to 2^i microseconds. The last bucket counts everything longer.
+    static const size_t mc_BucketCount = 26;
+
+    using Histogram = std::array<uint64_t, mc_BucketCount>;
+
+    // Track the given number of slowest and largest directories.
+    explicit DirectoryProfile (size_t topCount = 10);
+
+    // Add a directory read to the profile.
+    void record (const DirectoryTiming& timing);
+
+    // The number of directories recorded.
+    uint64_t directories() const;
+
+    // The total open plus read time of all recorded directories.
+    double totalSeconds() const;
+
+    // Counts of directory reads by total (open plus read) latency.
+    Histogram histogram() const;
+
+    // The upper latency bound of the given bucket, in seconds.
+    static double bucketLimit (size_t bucket);
+
+    // The slowest directories, slowest first.
+    std::vector<DirectoryTiming> slowest() const;
+
+    // The directories with the most entries, largest first.
+    std::vector<DirectoryTiming> largest() const;
+
+  private:
+
+    static bool slower (const DirectoryTiming& a, const DirectoryTiming& b);
+    static bool larger (const DirectoryTiming& a, const DirectoryTiming& b);
+
+    using Order = bool (const DirectoryTiming&, const DirectoryTiming&);
+    void keepTop (std::vector<DirectoryTiming>& heap, const DirectoryTiming& timing, Order* before);
+    static std::vector<DirectoryTiming> sorted (std::vector<DirectoryTiming> heap, Order* before);
+
+    mutable std::mutex m_mutex;      // Guards all members below
+    size_t    m_topCount;            // Number of slowest and largest directories to keep
+    uint64_t  m_directories {0};     // Directories recorded
+    double    m_totalSeconds {0};    // Total open plus read time
+    Histogram m_histogram {};        // Latency histogram
+
+    std::vector<DirectoryTiming> m_slowest;   // Min-heap of the slowest directories
+    std::vector<DirectoryTiming> m_largest;   // Min-heap of the largest directories
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_DIRECTORYPROFILE_H
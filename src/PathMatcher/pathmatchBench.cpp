@@ -0,0 +1,447 @@
+//==================================================================================================
+// pathmatchBench.cpp
+//
+// Microbenchmarks for the pattern matching functions: pathMatch, wildComp and pattern
+// normalization. Each function is timed over a corpus of realistic and pathological patterns and
+// paths (plus the unit test patterns), reporting the time and number of heap allocations per
+// operation, and throughput. Results may also be written as JSON so that separate runs can be
+// compared. The CompiledPattern engines are compared by compiledpatternBench.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include <pathmatcher.h>
+#include <testpatterns.h>
+#include <wildcomp.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace PathMatch;
+
+
+//==================================================================================================
+// Allocation Counting
+//==================================================================================================
+
+namespace {
+    atomic<uint64_t> allocationCount {0};
+}
+
+void* operator new (size_t size)
+{
+    // Count every heap allocation made through the global operator new (which also backs
+    // operator new[] and all standard containers).
+
+    allocationCount.fetch_add(1, memory_order_relaxed);
+
+    if (auto block = malloc(size ? size : 1))
+        return block;
+
+    throw bad_alloc();
+}
+
+void operator delete (void* block) noexcept              { free(block); }
+void operator delete (void* block, size_t) noexcept      { free(block); }
+
+
+//==================================================================================================
+// Benchmark Corpus
+//==================================================================================================
+
+static const wstring realisticPatterns[] {
+    L"*.cpp",
+    L"....obj",
+    L"...*Test.cpp",
+    L".../include/?.h",
+    L"src/.../*.h",
+    L"src/*/pathmatcher.cpp",
+    L"...cache...tmp",
+    L"...*.{cpp,h}",
+    L"[a-m]*/.../*[Tt]est.cpp",
+    L"{README,TODO}.md",
+    L"docs/README.md",
+};
+
+static const wstring pathologicalPatterns[] {
+    L"a*a*a*a*a*a*b",
+    L"...a...a...a...b",
+    L"*?*?*?*?*?*?*b",
+    L"a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?a?b*",
+};
+
+static const wstring benchPaths[] {
+    L"pathmatch.obj",
+    L"README.md",
+    L"docs/README.md",
+    L"build/Release/pathmatch.obj",
+    L"src/PathMatcher/pathmatcherTest.cpp",
+    L"src/PathMatcher/pathmatcher.cpp",
+    L"src/CompiledPattern/compiledpattern.h",
+    L"third_party/boost/libs/filesystem/include/boost/filesystem/path.h",
+    L"out/cache/objects/12/34/5678/tmp",
+    L"Users/someone/AppData/Local/Temp/cache.tmp",
+    L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaac",
+    L"a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/c",
+};
+
+
+//==================================================================================================
+// Measurement
+//==================================================================================================
+
+struct Result
+{
+    wstring  group;         // Function under test
+    wstring  pattern;       // Pattern under test
+    uint64_t ops;           // Operations timed
+    double   nsPerOp;       // Average time per operation
+    double   allocsPerOp;   // Average heap allocations per operation
+    double   bytesPerOp;    // Average input bytes per operation (path or pattern text)
+};
+
+static double minSeconds = 0.05;   // Minimum timing run for each measurement
+
+
+//--------------------------------------------------------------------------------------------------
+template <typename Operation>
+Result measure (Operation&& operation, size_t opsPerCall, double bytesPerOp)
+{
+    // Run the operation repeatedly, doubling the repeat count until a run lasts at least
+    // minSeconds, and report the per-operation averages of the final run.
+
+    Result result {};
+
+    for (uint64_t repeats = 1;  ;  repeats *= 2) {
+        auto allocationsBefore = allocationCount.load(memory_order_relaxed);
+        auto start = chrono::steady_clock::now();
+
+        for (uint64_t i = 0;  i < repeats;  ++i)
+            operation();
+
+        auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        if (elapsed >= minSeconds || repeats >= (uint64_t{1} << 40)) {
+            result.ops         = repeats * opsPerCall;
+            result.nsPerOp     = elapsed * 1e9 / result.ops;
+            result.allocsPerOp = double(allocationCount.load(memory_order_relaxed) - allocationsBefore)
+                               / result.ops;
+            result.bytesPerOp  = bytesPerOp;
+            return result;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+vector<wstring> matchPatterns()
+{
+    // All patterns used for matching: the realistic and pathological sets, plus the unit test
+    // patterns.
+
+    vector<wstring> patterns;
+    patterns.insert(patterns.end(), begin(realisticPatterns), end(realisticPatterns));
+    patterns.insert(patterns.end(), begin(pathologicalPatterns), end(pathologicalPatterns));
+
+    for (const auto& pattern : PathMatchTest::testPatterns) {
+        if (!pattern.empty())
+            patterns.push_back(pattern);
+    }
+
+    return patterns;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+double averagePathBytes()
+{
+    size_t total = 0;
+    for (const auto& path : benchPaths)
+        total += path.size() * sizeof(wchar_t);
+    return double(total) / size(benchPaths);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void benchPathMatch (vector<Result>& results)
+{
+    // Time the standalone pathMatch function. Patterns with classes or brace groups are compiled
+    // on the first call, and taken from pathMatch's per-thread cache after that.
+
+    for (const auto& pattern : matchPatterns()) {
+        auto result = measure([&] {
+            for (const auto& path : benchPaths)
+                pathMatch(pattern.c_str(), path.c_str());
+        }, size(benchPaths), averagePathBytes());
+
+        result.group   = L"pathMatch";
+        result.pattern = pattern;
+        results.push_back(result);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void benchWildComp (vector<Result>& results)
+{
+    // Time wildComp, which matches single path components, against the final component of each
+    // path. Only patterns without slashes apply.
+
+    vector<wstring> names;
+    size_t nameBytes = 0;
+
+    for (const auto& path : benchPaths) {
+        auto slash = path.find_last_of(L"/\\");
+        names.push_back((slash == wstring::npos) ? path : path.substr(slash + 1));
+        nameBytes += names.back().size() * sizeof(wchar_t);
+    }
+
+    for (const auto& pattern : matchPatterns()) {
+        if (pattern.find_first_of(L"/\\") != wstring::npos)
+            continue;
+
+        auto result = measure([&] {
+            for (const auto& name : names)
+                wildComp(pattern, name);
+        }, names.size(), double(nameBytes) / names.size());
+
+        result.group   = L"wildComp";
+        result.pattern = pattern;
+        results.push_back(result);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void benchNormalizedPattern (vector<Result>& results)
+{
+    // Time the pattern normalization that PathMatcher::match runs once per pattern.
+
+    for (const auto& pattern : matchPatterns()) {
+        auto result = measure([&] {
+            PathMatchTest::testGetNormalizedPattern(pattern);
+        }, 1, double(pattern.size() * sizeof(wchar_t)));
+
+        result.group   = L"getNormalizedPattern";
+        result.pattern = pattern;
+        results.push_back(result);
+    }
+}
+
+
+//==================================================================================================
+// Reporting
+//==================================================================================================
+
+string jsonString (const wstring& str)
+{
+    // Return the string as a quoted, escaped JSON string in UTF-8.
+
+    string result = "\"";
+
+    for (size_t i = 0;  i < str.size();  ++i) {
+        uint32_t c = static_cast<uint32_t>(str[i]);
+
+        // Combine UTF-16 surrogate pairs (on platforms with 16-bit wchar_t).
+        if (c >= 0xd800 && c < 0xdc00 && i + 1 < str.size()) {
+            uint32_t low = static_cast<uint32_t>(str[i+1]);
+            if (low >= 0xdc00 && low < 0xe000) {
+                c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                ++i;
+            }
+        }
+
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            result += escape;
+        } else if (c < 0x80) {
+            result += static_cast<char>(c);
+        } else if (c < 0x800) {
+            result += static_cast<char>(0xc0 | (c >> 6));
+            result += static_cast<char>(0x80 | (c & 0x3f));
+        } else if (c < 0x10000) {
+            result += static_cast<char>(0xe0 | (c >> 12));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            result += static_cast<char>(0x80 | (c & 0x3f));
+        } else {
+            result += static_cast<char>(0xf0 | (c >> 18));
+            result += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            result += static_cast<char>(0x80 | (c & 0x3f));
+        }
+    }
+
+    return result + '"';
+}
+
+
+//--------------------------------------------------------------------------------------------------
+struct Summary
+{
+    size_t   measurements {0};  // Number of patterns measured
+    double   logNsSum {0};      // Sum of log(ns/op), for the geometric mean
+    uint64_t ops {0};           // Total operations
+    double   allocations {0};   // Total allocations
+    double   seconds {0};       // Total time
+    double   bytes {0};         // Total input bytes
+};
+
+map<wstring,Summary> summarize (const vector<Result>& results)
+{
+    // Summarize the results for each function.
+
+    map<wstring,Summary> summaries;
+
+    for (const auto& result : results) {
+        auto& summary = summaries[result.group];
+        ++summary.measurements;
+        summary.logNsSum    += log(max(result.nsPerOp, 1e-3));
+        summary.ops         += result.ops;
+        summary.allocations += result.allocsPerOp * result.ops;
+        summary.seconds     += result.nsPerOp * result.ops * 1e-9;
+        summary.bytes       += result.bytesPerOp * result.ops;
+    }
+
+    return summaries;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void printResults (const vector<Result>& results)
+{
+    wcout << left << setw(22) << L"Function" << setw(36) << L"Pattern"
+          << right << setw(12) << L"ns/op" << setw(12) << L"allocs/op" << setw(12) << L"MB/s"
+          << L'\n';
+
+    for (const auto& result : results) {
+        wcout << left << setw(22) << result.group << setw(36) << (L'(' + result.pattern + L')')
+              << right << fixed << setprecision(1) << setw(12) << result.nsPerOp
+              << setprecision(2) << setw(12) << result.allocsPerOp
+              << setprecision(1) << setw(12) << (result.bytesPerOp * 1e3 / result.nsPerOp)
+              << L'\n';
+    }
+
+    wcout << L'\n' << left << setw(22) << L"Function" << right << setw(14) << L"geomean ns/op"
+          << setw(12) << L"allocs/op" << setw(14) << L"Mops/s" << setw(12) << L"MB/s" << L'\n';
+
+    for (const auto& [function, summary] : summarize(results)) {
+        wcout << left << setw(22) << function << right << fixed
+              << setprecision(1) << setw(14) << exp(summary.logNsSum / summary.measurements)
+              << setprecision(2) << setw(12) << (summary.allocations / summary.ops)
+              << setprecision(2) << setw(14) << (summary.ops / summary.seconds * 1e-6)
+              << setprecision(1) << setw(12) << (summary.bytes / summary.seconds * 1e-6)
+              << L'\n';
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool writeJson (const vector<Result>& results, const char* fileName)
+{
+    ofstream out (fileName);
+    if (!out)
+        return false;
+
+    out << "{\n  \"benchmark\": \"pathmatchBench\",\n  \"minSeconds\": " << minSeconds
+        << ",\n  \"results\": [";
+
+    for (size_t i = 0;  i < results.size();  ++i) {
+        const auto& result = results[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\"function\": " << jsonString(result.group)
+            << ", \"pattern\": " << jsonString(result.pattern)
+            << ", \"ops\": " << result.ops
+            << ", \"nsPerOp\": " << result.nsPerOp
+            << ", \"allocsPerOp\": " << result.allocsPerOp
+            << ", \"opsPerSec\": " << (1e9 / result.nsPerOp)
+            << ", \"bytesPerSec\": " << (result.bytesPerOp * 1e9 / result.nsPerOp) << "}";
+    }
+
+    out << "\n  ],\n  \"functions\": [";
+
+    bool first = true;
+    for (const auto& [function, summary] : summarize(results)) {
+        out << (first ? "\n" : ",\n")
+            << "    {\"function\": " << jsonString(function)
+            << ", \"measurements\": " << summary.measurements
+            << ", \"geomeanNsPerOp\": " << exp(summary.logNsSum / summary.measurements)
+            << ", \"allocsPerOp\": " << (summary.allocations / summary.ops)
+            << ", \"opsPerSec\": " << (summary.ops / summary.seconds)
+            << ", \"bytesPerSec\": " << (summary.bytes / summary.seconds) << "}";
+        first = false;
+    }
+
+    out << "\n  ]\n}\n";
+    return bool(out);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+    // Usage: pathmatchBench [--json <file>] [--minTime <milliseconds>]
+
+    const char* jsonFile = nullptr;
+
+    for (int i = 1;  i < argc;  ++i) {
+        if (0 == strcmp(argv[i], "--json") && i + 1 < argc) {
+            jsonFile = argv[++i];
+        } else if (0 == strcmp(argv[i], "--minTime") && i + 1 < argc) {
+            minSeconds = atof(argv[++i]) / 1000.0;
+        } else {
+            wcerr << L"usage: pathmatchBench [--json <file>] [--minTime <milliseconds>]\n";
+            return 1;
+        }
+    }
+
+    vector<Result> results;
+
+    benchPathMatch (results);
+    benchWildComp (results);
+    benchNormalizedPattern (results);
+
+    printResults (results);
+
+    if (jsonFile && !writeJson(results, jsonFile)) {
+        wcerr << L"pathmatchBench: Couldn't write JSON results to \"" << jsonFile << L"\".\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -27,19 +27,26 @@
 //==================================================================================================
 
 #include "pathmatcher.h"
-#include "wildcomp.h"
+#include "compiledpattern.h"
+#include "patterncache.h"
+#include "pathmatchprobes.h"
+#include "pathmatchtrace.h"
+#include "patterntokens.h"
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <filesystem>
 #include <io.h>
-#include <iostream>
 #include <locale>
 #include <memory>
+#include <mutex>
+#include <ranges>
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <windows.h>
 
@@ -49,6 +56,26 @@ using namespace std;
 namespace fs = std::filesystem;
 
 
+#if PATHMATCH_ETW_PROBES
+
+// The TraceLogging provider for the probes in pathmatchprobes.h, registered while the process runs.
+// Its GUID is the one ETW derives from the name "pathmatch".
+
+TRACELOGGING_DEFINE_PROVIDER (
+    g_pathmatchProvider, "pathmatch",
+    (0x70cb4ff1, 0x1ca7, 0x501d, 0xce, 0x34, 0x96, 0x37, 0x91, 0x6f, 0x7a, 0xb6));
+
+namespace {
+    struct ProbeProvider
+    {
+        ProbeProvider()  { TraceLoggingRegister(g_pathmatchProvider); }
+        ~ProbeProvider() { TraceLoggingUnregister(g_pathmatchProvider); }
+    } s_probeProvider;
+}
+
+#endif
+
+
 // =================================================================================================
 // Local Helper Functions
 // =================================================================================================
@@ -152,12 +179,87 @@ namespace {
         source.swap(newString);
     }
 
+    //----------------------------------------------------------------------------------------------
+    double processCpuSeconds()
+    {
+        // Return the user plus kernel CPU time consumed by this process so far.
+
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+
+        if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+            return 0;
+
+        auto ticks = [](const FILETIME& time) {   // 100ns ticks
+            return (uint64_t{time.dwHighDateTime} << 32) | time.dwLowDateTime;
+        };
+
+        return (ticks(kernelTime) + ticks(userTime)) * 1e-7;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    double wallSeconds()
+    {
+        return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
     //----------------------------------------------------------------------------------------------
     const auto c_updir       = L'\u005e';           // Caret
     const auto c_updirStr    = wstring{c_updir};    // Caret
     const auto c_ellipsis    = L'\u2026';           // U+2026 - Horizontal Ellipsis
     const auto c_ellipsisStr = wstring{c_ellipsis};
 
+    // Pattern matching ignores case, but a name looked up directly is found only as the file
+    // system matches names. Literal sets are looked up directly only where the file system ignores
+    // case; elsewhere they're matched by a directory scan, so 'lib/{a1,a2}' still finds 'lib/A1'.
+    // A single literal name is always looked up directly, so on a case-sensitive file system
+    // 'lib/a1' finds only an entry spelled exactly 'a1'.
+    #if defined(_WIN32) || defined(__APPLE__)
+        const bool c_caseInsensitiveFileSystem = true;
+    #else
+        const bool c_caseInsensitiveFileSystem = false;
+    #endif
+
+    //----------------------------------------------------------------------------------------------
+    wstring nameOnDisk (const fs::path& path)
+    {
+        // Return the name of the given existing entry as its directory spells it, which may
+        // differ in case from the name it was looked up by. Where the spelling can't be fetched,
+        // the looked-up name is returned.
+
+        #if defined(_WIN32)
+            WIN32_FIND_DATAW findData;
+            auto handle = FindFirstFileExW (
+                path.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, 0);
+
+            if (handle != INVALID_HANDLE_VALUE) {
+                FindClose(handle);
+                return findData.cFileName;
+            }
+        #endif
+
+        return path.filename().wstring();
+    }
+
+    //----------------------------------------------------------------------------------------------
+    wstring denormalizeComponent (const wstring& component)
+    {
+        // Return the given normalized pattern component in plain pattern syntax, with '...' for
+        // each ellipsis, and '..' for each parent directory.
+
+        wstring result;
+
+        for (auto c : component) {
+            if (c == c_ellipsis)
+                result += L"...";
+            else if (c == c_updir)
+                result += L"..";
+            else
+                result += c;
+        }
+
+        return result;
+    }
+
     //----------------------------------------------------------------------------------------------
     vector<wstring> getNormalizedPattern (const wstring& patternSource)
     {
@@ -189,6 +291,12 @@ namespace {
         //
         //     a/......****.../b -> 'a', ..., 'b'
         //         Sequences of adjacent multiWild patterns collapse to a single multiWild pattern.
+        //
+        //     a/[*.]x -> 'a', '[*.]x'
+        //         Character classes are copied verbatim.
+        //
+        //     a/{b/c,d}/e -> 'a', '{b/c,d}', 'e'
+        //         Brace groups stay whole, even when their alternatives contain slashes.
 
         if (patternSource.empty())
             return {};
@@ -198,7 +306,10 @@ namespace {
         wstring standardizedPattern;
 
         for (auto src = patternSource.cbegin();  src != patternSource.cend();  ++src) {
-            if (*src == L'\\') {
+            if (auto classLength = PathMatch::charClassLength(patternSource, src - patternSource.cbegin())) {
+                standardizedPattern.append(src, src + classLength);   // Copy classes verbatim.
+                src += classLength - 1;
+            } else if (*src == L'\\') {
                 standardizedPattern += L'/';
             } else if (*src == L'*' && (src+1) != patternSource.cend() && *(src+1) == L'*') {
                 standardizedPattern += c_ellipsis;
@@ -227,7 +338,8 @@ namespace {
             }
         }
 
-        wcout << L"Normal: (" << normalizedPattern << L")\n";
+        if (auto out = PathMatch::trace(PathMatch::TraceLevel::Info))
+            *out << L"Normal: (" << normalizedPattern << L")\n";
 
         // Construct the normalized sequence of sub-path patterns.
 
@@ -246,9 +358,11 @@ namespace {
 
         while (patternIt != normalizedPattern.cend()) {
             auto patternStart = patternIt;
-            while (patternIt != normalizedPattern.cend() && *patternIt != L'/')
-                ++patternIt;
-            
+            while (patternIt != normalizedPattern.cend() && *patternIt != L'/') {
+                auto groupLength = PathMatch::braceGroupLength(normalizedPattern, patternIt - normalizedPattern.cbegin());
+                patternIt += groupLength ? groupLength : 1;
+            }
+
             patterns.push_back({patternStart, patternIt});
 
             // Skip over sequences of slashes.
@@ -273,6 +387,33 @@ namespace {
 
         return patterns;
     }
+
+    //----------------------------------------------------------------------------------------------
+    const PathMatch::CompiledPattern& cachedCompiledPattern (const wchar_t* pattern)
+    {
+        // Return the compiled form of the given pattern from a small per-thread cache, compiling
+        // it on a miss. Callers of pathMatch() typically test many paths against a few patterns,
+        // so this avoids recompiling the pattern (and rebuilding its lazy DFA) on every call. The
+        // least recently used pattern is dropped once the cache is full.
+
+        const size_t c_capacity = 8;
+
+        // Compiled patterns, most recently used last.
+        thread_local vector<pair<wstring, PathMatch::CompiledPattern>> cache;
+
+        for (size_t i = cache.size();  i-- > 0;  ) {
+            if (cache[i].first == pattern) {
+                rotate(cache.begin() + i, cache.begin() + i + 1, cache.end());
+                return cache.back().second;
+            }
+        }
+
+        if (cache.size() == c_capacity)
+            cache.erase(cache.begin());
+
+        cache.emplace_back(pattern, PathMatch::CompiledPattern(pattern));
+        return cache.back().second;
+    }
 }
 
 
@@ -291,8 +432,10 @@ bool pathMatch (const wchar_t *pattern, const wchar_t *path)
     // Compares a single path against a VMS-style wildcard specification. In the pattern string, the
     // character '?' denotes any single character except '/', the character '*' denotes any number
     // of characters except '/', and the sequence '...' or '**' denotes any number of characters
-    // including '/'. All other characters in the pattern are interpreted literally, though without
-    // regard to case. For example, 'a' matches 'A'.
+    // including '/'. A bracketed class such as '[a-z_]' or '[!.]' denotes any single character
+    // (except '/') in or not in the class, and a brace group such as '{src,include/*}' matches any
+    // one of its comma-separated alternatives. All other characters in the pattern are interpreted
+    // literally, though without regard to case. For example, 'a' matches 'A'.
     //
     // Note that this routine also interprets a backslash ('\') as a euphemism for a forward slash.
     //
@@ -315,6 +458,14 @@ bool pathMatch (const wchar_t *pattern, const wchar_t *path)
 
     if (!pattern || !path) return false;
 
+    // Classes and brace groups are only understood by the compiled pattern engines. Compiling
+    // costs far more than a match, so recently used patterns are kept compiled per thread.
+
+    if (wcspbrk(pattern, L"[{")) {
+        PrefilterCounters counters;
+        return cachedCompiledPattern(pattern).matches(path, wcslen(path), counters);
+    }
+
     // Scan through the pattern and path until we hit an asterisk or an ellipsis. Handle the special
     // cases of "/.../" and "/*/", tested against null subdirectories (where both are also
     // equivalent to "/").
@@ -338,9 +489,12 @@ bool pathMatch (const wchar_t *pattern, const wchar_t *path)
         }
 
         // Test for a single character match. In order to support case-sensitive path matching,
-        // you'd only need to change the tolower comparison below.
+        // you'd only need to change the tolower comparison below. Slashes of either type have
+        // already been matched above.
 
-        if (*pattern != L'?') {
+        if (isSlash(*pattern)) {
+            // Matched.
+        } else if (*pattern != L'?') {
             if (tolower(*pattern) != tolower(*path))
                 return false;
         } else if (isSlash(*path)) {       // '?' matches all but slash.
@@ -424,337 +578,1160 @@ bool pathMatch (const wchar_t *pattern, const wchar_t *path)
 
 
 //==================================================================================================
-// PathMatcher Class Implementation
+// MatchStats
 //==================================================================================================
 
-size_t PathMatcher::pathSpaceLeft (const wchar_t *pathend) const
+MatchStats& MatchStats::operator+= (const MatchStats& other)
 {
-    // Returns the number of characters that can be appended to the m_path
-    // string, while allowing room for a terminating character.
+    directoriesOpened   += other.directoriesOpened;
+    entriesRead         += other.entriesRead;
+    statCalls           += other.statCalls;
+    matchesReported     += other.matchesReported;
+    peakDepth            = max(peakDepth, other.peakDepth);
+    prefilter           += other.prefilter;
+    compileWallSeconds  += other.compileWallSeconds;
+    compileCpuSeconds   += other.compileCpuSeconds;
+    traverseWallSeconds += other.traverseWallSeconds;
+    traverseCpuSeconds  += other.traverseCpuSeconds;
+    return *this;
+}
 
-    return (mc_MaxPathLength + 1) - (pathend - m_path) - 1;
+
+//==================================================================================================
+// MatchPlan
+//==================================================================================================
+
+MatchPlan::MatchPlan (const wstring& pattern)
+{
+    // Normalize the pattern and compile its components, up to and including the span component.
+    // The span pattern is compiled here too, so that it's compiled once for the whole match rather
+    // than for each directory that reaches it.
+
+    if (pattern.empty())
+        return;
+
+    m_dirsOnly = isSlash(pattern.back());
+
+    auto normalized = getNormalizedPattern(pattern);
+
+    m_spanIndex = normalized.size();
+
+    for (size_t index = 0;  index < normalized.size();  ++index) {
+        const auto& component = normalized[index];
+
+        if (component == L"/") {
+            m_components.push_back({L"/", Kind::Root, {}});
+        } else if (component == c_updirStr) {
+            m_components.push_back({L"..", Kind::Parent, {}});
+        } else if (m_spanIndex < index) {
+            m_components.push_back({denormalizeComponent(component), Kind::Name, {}});
+        } else {
+            auto text = denormalizeComponent(component);
+            m_components.push_back({text, Kind::Name, CompiledPattern(text)});
+
+            // A component such as "a*" followed by a slash also matches the start of the next
+            // component's entry name ("a*/b" matches "ab"), which only the span pattern handles.
+
+            auto joinsNext = component.size() > 1 && component.back() == L'*'
+                          && index + 1 < normalized.size();
+
+            if (m_components.back().compiled.spansDirectories() || joinsNext)
+                m_spanIndex = index;
+        }
+    }
+
+    // A run of lone '*' components directly ahead of the span joins the span, since the levels
+    // they match (if any) are already among the subpaths that the span pattern is matched against.
+
+    while (m_spanIndex > 0 && m_spanIndex < m_components.size()
+           && m_components[m_spanIndex - 1].text == L"*") {
+        --m_spanIndex;
+    }
+
+    // Mark the remaining lone '*' components ahead of the span as optional. A path can match in
+    // more than one way if there's more than one run of them, or a run and a span.
+
+    size_t optionalRuns = 0;
+
+    for (size_t index = 0;  index < m_spanIndex && index + 1 < m_components.size();  ++index) {
+        auto& component = m_components[index];
+        if (component.kind != Kind::Name || component.text != L"*")
+            continue;
+        component.optional = true;
+        if (index == 0 || !m_components[index - 1].optional)
+            ++optionalRuns;
+    }
+
+    m_ambiguous = optionalRuns > 1 || (optionalRuns > 0 && m_spanIndex < m_components.size());
+
+    if (m_spanIndex == m_components.size())
+        return;
+
+    // The span prefix is the part of the span component before its first ellipsis or brace group.
+
+    const auto& spanComponent = normalized[m_spanIndex];
+    size_t prefixLength = 0;
+
+    while (prefixLength < spanComponent.size()
+           && spanComponent[prefixLength] != c_ellipsis && spanComponent[prefixLength] != L'{') {
+        prefixLength += max<size_t>(1, charClassLength(spanComponent, prefixLength));
+    }
+
+    if (prefixLength == 0 && spanComponent.size() == 1 && m_spanIndex + 1 == m_components.size()) {
+        m_spanMatchesAll = true;    // ...<end>
+        return;
+    }
+
+    wstring spanPattern;
+
+    for (auto index = m_spanIndex;  index < m_components.size();  ++index) {
+        if (index > m_spanIndex)
+            spanPattern += L'/';
+        spanPattern += m_components[index].text;
+    }
+
+    m_spanPattern = CompiledPattern(spanPattern);
+
+    // A prefix of asterisks alone matches any name, so it isn't worth testing.
+
+    if (spanComponent.find_first_not_of(L'*') < prefixLength) {
+        m_spanPrefix = CompiledPattern(denormalizeComponent(spanComponent.substr(0, prefixLength)) + L'*');
+        m_hasSpanPrefix = true;
+    }
+}
+
+
+//==================================================================================================
+// PathMatcher::DirectoryScan
+//==================================================================================================
+
+class PathMatcher::DirectoryScan
+{
+    //----------------------------------------------------------------------------------------------
+    // A DirectoryScan opens a directory of the current path for enumeration, and counts it and its
+    // entries in the match stats. If the matcher has a directory cache, a current cached listing
+    // is used instead, and a directory that must be read is read whole and stored in the cache. If
+    // directory profiling is on, the scan also times the directory open and the reading of its
+    // entries, and records the result in the profile when the scan ends. Time spent in nested
+    // scans (of subdirectories) and by the consumer of the matches is excluded, so that each
+    // directory is charged only for its own latency.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    DirectoryScan (Traversal& traversal, const fs::path& path, const wchar_t* pathend);
+    ~DirectoryScan();
+
+    // True if the directory was opened (or its listing was found in the cache).
+    bool isOpen() const { return m_open; }
+
+    // Advance to the next entry of the directory, and return its directory entry and name. Returns
+    // false when there are no more entries.
+    bool next (const fs::directory_entry*& entry, const wstring*& name);
+
+  private:
+
+    void read (fs::directory_iterator& iterator, const CachedDirectory& cached);
+
+    Traversal&             m_traversal;
+    fs::path               m_path;          // Directory path (empty for the current directory)
+    fs::directory_iterator m_iterator;
+    wstring                m_name;          // Name of the iterator's current entry
+    bool                   m_started {false};  // True once the iterator has been advanced
+    bool                   m_open {false};
+    bool                   m_read {false};  // True if the directory was read (not cached)
+    uint64_t               m_entries {0};   // Entries read
+
+    shared_ptr<const DirectoryListing> m_listing;   // Cached listing, if there is one
+    size_t                 m_position {0};  // Position of the next listing entry
+
+    bool   m_profiling {false};             // True if the matcher has a directory profile
+    double m_start {0};                     // Wall time at the start of the scan
+    double m_openSeconds {0};               // Time to open the directory
+    double m_outerNestedSeconds {0};        // Enclosing scan's nested time at the start
+};
+
+
+//==================================================================================================
+// PathMatcher::Traversal
+//==================================================================================================
+
+class PathMatcher::Traversal
+{
+    //----------------------------------------------------------------------------------------------
+    // A Traversal walks the directory tree for one match, and produces the matching entries one at
+    // a time. Rather than recursing through the tree, it keeps an explicit stack of frames, one for
+    // each directory whose entries are being matched, each holding its own position. This lets the
+    // traversal stop after any match and resume later from the same point. Both the callback form
+    // of PathMatcher::match() and match ranges are driven by a Traversal.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    Traversal (const PathMatcher& matcher, const MatchPlan& plan, const MatchStats& compileStats);
+    ~Traversal();
+
+    // Advance to the next matching entry. Returns false when the traversal is complete.
+    bool next();
+
+    // The current matching entry, valid until the next call to next().
+    const MatchResult& current() const { return m_current; }
+
+    // The stats of the traversal so far.
+    MatchStats stats() const;
+
+  private:
+
+    friend class PathMatcher::DirectoryScan;
+
+    enum class FrameKind
+    {
+        Probe,   // Look up each name of a small literal set in the directory
+        Scan,    // Match each entry of the directory against a name component
+        Span     // Match each subpath below the directory against the span pattern
+    };
+
+    struct Frame
+    {
+        FrameKind kind;
+        wchar_t*  pathEnd;                    // End of the directory's path (one past last char)
+        size_t    index {0};                  // Pattern component matched (Probe and Scan)
+        fs::path  directory;                  // Directory path (empty for the current directory)
+        CachedDirectory cached;               // Probe: the directory's cache record
+        size_t    position {0};               // Probe: index of the next name to look up
+        unique_ptr<DirectoryScan> scan;       // Scan and Span: the directory being read
+        bool      matchPrefix {false};        // Span: entries must match the span prefix
+        wchar_t*  descendEnd {nullptr};       // Span: path end of a subdirectory to descend into
+    };
+
+    bool enter (wchar_t* pathEnd, size_t index);
+    bool enterEntry (
+        wchar_t* pathEnd, size_t index, const fs::directory_entry& dirEntry, const wstring& entryName);
+    void enterSpan (wchar_t* pathEnd, bool matchPrefix);
+
+    bool stepProbe (Frame& frame);
+    bool stepScan (Frame& frame);
+    bool stepSpan (Frame& frame);
+
+    bool produce (fs::path path, const fs::directory_entry& dirEntry);
+    void finish();
+
+    wchar_t* appendPath (wchar_t* pathEnd, const wchar_t* str);
+    size_t pathSpaceLeft (const wchar_t* pathEnd) const;
+
+    void noteDirectory (const fs::path& directory);
+    CachedDirectory cachedDirectory (const fs::path& directory) const;
+    bool lookupEntry (
+        const CachedDirectory& cached, const fs::path& directory, const wstring& name,
+        fs::directory_entry& dirEntry);
+
+    const PathMatcher& m_matcher;
+    const MatchPlan&   m_plan;
+    MatchStats         m_stats;           // Counters for this traversal
+
+    wchar_t        m_path [mc_MaxPathLength + 1];   // Current path
+    wchar_t*       m_ellipsisPath {nullptr};  // Path part to match against the span pattern
+    fs::path       m_cacheBase;           // Absolute current directory, for cache keys
+
+    vector<Frame>       m_frames;         // Directories being matched, innermost last
+    fs::directory_entry m_lookup;         // Entry found by the latest direct lookup
+    MatchResult         m_current;        // The current matching entry
+
+    unordered_set<fs::path::string_type> m_produced;   // Entries produced (ambiguous plans only)
+
+    bool   m_started {false};             // True once the traversal has begun
+    bool   m_done {false};                // True once the traversal is complete
+    double m_startWall {0};               // Wall and CPU time at the start of the traversal
+    double m_startCpu {0};
+
+    bool   m_profiling {false};           // True if the matcher has a directory profile
+    double m_profileNestedSeconds {0};    // Time spent in nested directory reads and consumers
+    double m_yieldWall {0};               // Wall time when the current match was produced
+};
+
+
+//--------------------------------------------------------------------------------------------------
+PathMatcher::DirectoryScan::DirectoryScan (
+    Traversal& traversal, const fs::path& path, const wchar_t* pathend)
+  : m_traversal(traversal),
+    m_path(path),
+    m_profiling(traversal.m_profiling)
+{
+    auto dirPath = path.empty() ? fs::path(L".") : path;
+    error_code errorCode;
+
+    if (m_profiling) {
+        m_start = wallSeconds();
+        m_outerNestedSeconds = exchange(traversal.m_profileNestedSeconds, 0.0);
+    }
+
+    // With a directory cache, use the cached listing if it's current, or else read the directory
+    // whole (by its absolute path, so that the entries remain valid if the current directory
+    // changes) and cache the listing. A directory without a cache record (because there's no
+    // cache, or its modification time couldn't be read) is read directly.
+
+    auto cached = traversal.cachedDirectory(path);
+    auto cache  = traversal.m_matcher.m_cache;
+
+    if (cached.valid) {
+        m_listing = cache->findListing(cached.key, cached.modified);
+        if (!m_listing) {
+            fs::directory_iterator iterator (cached.key, errorCode);
+            if (!errorCode) {
+                m_read = true;
+                read(iterator, cached);
+            }
+        }
+    } else {
+        m_iterator = fs::directory_iterator(dirPath, errorCode);
+        m_read = !errorCode;
+    }
+
+    if (m_profiling)
+        m_openSeconds = wallSeconds() - m_start;
+
+    m_open = m_read || m_listing;
+
+    if (m_open)
+        traversal.noteDirectory(dirPath);
+
+    if (auto out = trace(TraceLevel::Detail)) {
+        *out << L"Reading directory: " << dirPath.wstring()
+             << (!m_open ? L" (failed)\n" : m_read ? L"\n" : L" (cached)\n");
+    }
+
+    if (m_read || !m_open)
+        PATHMATCH_PROBE_DIR_OPEN(path.c_str(), path.native().size(), m_open ? 1 : 0);
+
+    if (!m_open)
+        return;
+
+    // Count the directory if it was read, and track the deepest directory path opened.
+
+    auto& stats = traversal.m_stats;
+
+    if (m_read)
+        ++stats.directoriesOpened;
+
+    size_t depth = 0;
+    for (auto ptr = traversal.m_path;  ptr < pathend;  ++ptr) {
+        if (!isSlash(*ptr) && (ptr == traversal.m_path || isSlash(ptr[-1])))
+            ++depth;
+    }
+
+    stats.peakDepth = max(stats.peakDepth, depth);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PathMatcher::DirectoryScan::read (fs::directory_iterator& iterator, const CachedDirectory& cached)
+{
+    // Read all entries of the directory into a listing, and store it in the cache.
+
+    DirectoryListing listing;
+    error_code errorCode;
+
+    for (;  iterator != fs::directory_iterator();  iterator.increment(errorCode)) {
+        if (errorCode)
+            break;
+        listing.push_back({*iterator, iterator->path().filename().wstring()});
+    }
+
+    m_entries = listing.size();
+    m_traversal.m_stats.entriesRead += m_entries;
+
+    m_listing = m_traversal.m_matcher.m_cache->storeListing(
+        cached.key, cached.modified, std::move(listing));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::DirectoryScan::next (const fs::directory_entry*& entry, const wstring*& name)
+{
+    if (m_listing) {
+        if (m_position >= m_listing->size())
+            return false;
+        const auto& listed = (*m_listing)[m_position++];
+        entry = &listed.entry;
+        name  = &listed.name;
+        return true;
+    }
+
+    if (!m_open)
+        return false;
+
+    error_code errorCode;
+
+    if (m_started)
+        m_iterator.increment(errorCode);
+
+    m_started = true;
+
+    if (errorCode || m_iterator == fs::directory_iterator())
+        return false;
+
+    ++m_entries;
+    ++m_traversal.m_stats.entriesRead;
+
+    m_name = m_iterator->path().filename().wstring();
+    entry  = &*m_iterator;
+    name   = &m_name;
+    return true;
 }
 
 
 //--------------------------------------------------------------------------------------------------
-PathMatcher::PathMatcher()
+PathMatcher::DirectoryScan::~DirectoryScan()
+{
+    // Record the directory's own latency (including failed opens, but not cached listings), and
+    // charge the whole scan to the enclosing scan's nested time.
+
+    if (m_read)
+        PATHMATCH_PROBE_DIR_CLOSE(m_path.c_str(), m_path.native().size(), m_entries);
+
+    if (!m_profiling)
+        return;
+
+    auto elapsed = wallSeconds() - m_start;
+
+    if (m_read || !m_open) {
+        DirectoryTiming timing;
+        timing.path        = m_path.empty() ? wstring(L".") : m_path.wstring();
+        timing.openSeconds = m_openSeconds;
+        timing.readSeconds = max(0.0, elapsed - m_openSeconds - m_traversal.m_profileNestedSeconds);
+        timing.entries     = m_entries;
+
+        m_traversal.m_matcher.m_profile->record(timing);
+    }
+
+    m_traversal.m_profileNestedSeconds = m_outerNestedSeconds + elapsed;
+}
+
+
+//==================================================================================================
+// PathMatcher::Traversal Implementation
+//==================================================================================================
+
+PathMatcher::Traversal::Traversal (
+    const PathMatcher& matcher, const MatchPlan& plan, const MatchStats& compileStats)
+  : m_matcher(matcher),
+    m_plan(plan),
+    m_stats(compileStats),
+    m_profiling(matcher.m_profile != nullptr)
 {
-    // PathMatcher Default Constructor
-    size_t pathSize = mc_MaxPathLength + 1;    // Temporary Windows max path length.
-    m_path = new wchar_t [pathSize];
     m_path[0] = 0;
+
+    if (m_matcher.m_cache) {
+        error_code errorCode;
+        m_cacheBase = fs::current_path(errorCode);
+    }
+
+    if (auto out = trace(TraceLevel::Info)) {
+        *out << L"Directories only: " << (m_plan.dirsOnly() ? L"true" : L"false") << L"\n";
+        *out << L"Normalized pattern components: ";
+        for (size_t index = 0;  index < m_plan.size();  ++index) {
+            *out << L"(" << m_plan.text(index) << L")";
+        }
+        *out << L"\n";
+    }
 }
 
-PathMatcher::~PathMatcher ()
+
+//--------------------------------------------------------------------------------------------------
+PathMatcher::Traversal::~Traversal()
 {
-    // PathMatcher Destructor
-    delete[] m_path;
-    delete[] m_patternBuff;
+    // Close the open directories innermost first, so that each directory's profiled latency
+    // excludes the directories nested inside it.
+
+    while (!m_frames.empty())
+        m_frames.pop_back();
+
+    // Publish the stats as those of the matcher's most recently completed match.
+
+    auto stats = this->stats();
+    lock_guard<mutex> lock (m_matcher.m_statsMutex);
+    m_matcher.m_stats = stats;
 }
 
 
 //--------------------------------------------------------------------------------------------------
-wchar_t* PathMatcher::appendPath (wchar_t *pathend, const wchar_t *str)
+MatchStats PathMatcher::Traversal::stats() const
 {
-    // This procedure appends the current path with the specified string.
-    //
-    // Parameter 'pathend' is the end of the current path (one past the last character). Parameter
-    // 'str' is the string to append.
+    // Return the stats of the traversal. The traversal time of an unfinished traversal is the
+    // time since it started.
+
+    if (!m_started || m_done)
+        return m_stats;
+
+    auto stats = m_stats;
+    stats.traverseWallSeconds = wallSeconds() - m_startWall;
+    stats.traverseCpuSeconds  = processCpuSeconds() - m_startCpu;
+    return stats;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::Traversal::next()
+{
+    // Run the traversal up to the next matching entry. Each pass of the loop advances the
+    // innermost frame by one entry (or one name lookup), which may push a frame for a directory
+    // to descend into, pop the frame if its directory is exhausted, or produce a match.
+
+    if (m_done)
+        return false;
+
+    if (m_profiling && m_started)
+        m_profileNestedSeconds += wallSeconds() - m_yieldWall;
+
+    bool produced = false;
+
+    if (!m_started) {
+        m_started   = true;
+        m_startWall = wallSeconds();
+        m_startCpu  = processCpuSeconds();
+        produced    = enter(m_path, 0);
+    }
+
+    while (!produced && !m_frames.empty()) {
+        auto& frame = m_frames.back();
+
+        switch (frame.kind) {
+            case FrameKind::Probe:
+                produced = stepProbe(frame);
+                break;
+
+            case FrameKind::Scan:
+                produced = stepScan(frame);
+                break;
+
+            case FrameKind::Span:
+                if (frame.descendEnd)
+                    enterSpan(exchange(frame.descendEnd, nullptr), false);
+                else
+                    produced = stepSpan(frame);
+                break;
+        }
+    }
+
+    if (!produced) {
+        finish();
+        return false;
+    }
+
+    if (m_profiling)
+        m_yieldWall = wallSeconds();
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::Traversal::enter (wchar_t* pathEnd, size_t index)
+{
+    // Begin matching the pattern component at 'index' against the directory of the current path,
+    // whose end is 'pathEnd'. Components that are resolved by looking up names directly are
+    // followed immediately; directories that must be read get a new frame.
     //
-    // This function  returns the new path end pointer, or null if the path buffer is not large
-    // enough to append the new entry name.
+    // This function returns true if it produced a match.
     //--------
 
-    auto strlength = wcslen (str);
+    bool skipped = false;   // True once an optional component has been skipped
 
-    // Return null if there's not enough space to append the string.
+    while (index < m_plan.size()) {
 
-    if (pathSpaceLeft(pathend) < (strlength + 1))
-        return nullptr;
+        // Root and parent directory components just extend the current path.
 
-    while (*str)
-        *pathend++ = *str++;
+        if (m_plan.isRoot(index) || m_plan.isParent(index)) {
+            auto pathEndNew = appendPath (pathEnd, m_plan.isRoot(index) ? L"/" : L"../");
+            if (!pathEndNew) return false;
 
-    *pathend = 0;
+            if (index + 1 == m_plan.size()) {
+                auto fsPath = fs::path(m_path);
+                ++m_stats.statCalls;
+                m_lookup = fs::directory_entry(fsPath);
+                return produce (fsPath, m_lookup);
+            }
 
-    return pathend;
+            pathEnd = pathEndNew;
+            ++index;
+            continue;
+        }
+
+        // If the current pattern component contains an ellipsis (or a brace group with a slash),
+        // then the remainder of the pattern is matched against every subpath of the tree below.
+
+        if (index == m_plan.spanIndex()) {
+            m_ellipsisPath = pathEnd;
+            enterSpan (pathEnd, m_plan.spanPrefix() != nullptr);
+            return false;
+        }
+
+        const auto& component = m_plan.text(index);
+        const auto& compiled  = m_plan.compiled(index);
+
+        auto fsPath = fs::path(m_path);
+
+        // If we have a literal subdirectory name (or filename), then just look up that entry
+        // directly. The directory cache may already know whether the entry exists.
+
+        if (compiled.isLiteral()) {
+            noteDirectory(fsPath);
+            if (!lookupEntry (cachedDirectory(fsPath), fsPath, component, m_lookup))
+                return false;
+            return enterEntry (pathEnd, index, m_lookup, m_lookup.path().filename().wstring());
+        }
+
+        Frame frame;
+        frame.pathEnd   = pathEnd;
+        frame.index     = index;
+        frame.directory = fsPath;
+
+        // If the component is a small set of literal alternatives, then look up each alternative
+        // directly, rather than reading every entry of a possibly large directory. Direct lookups
+        // are only exact on case-insensitive file systems; elsewhere, the set is matched by a scan
+        // so that it finds the same entries as a wildcard would.
+
+        auto alternatives = compiled.literalAlternatives();
+
+        if (c_caseInsensitiveFileSystem
+            && alternatives && alternatives->size() <= mc_MaxProbeCount) {
+            noteDirectory(fsPath);
+            frame.kind   = FrameKind::Probe;
+            frame.cached = cachedDirectory(fsPath);
+            m_frames.push_back(std::move(frame));
+            return false;
+        }
+
+        // If there's a wildcard subdirectory or file name (or a large literal set), then enumerate
+        // all directory entries and filter the results.
+
+        frame.kind = FrameKind::Scan;
+        frame.scan = make_unique<DirectoryScan>(*this, fsPath, pathEnd);
+
+        if (frame.scan->isOpen())
+            m_frames.push_back(std::move(frame));
+
+        // An optional component may also match no directory level, so the components that follow
+        // are matched in this directory as well. Of a run of optional components, only leading
+        // ones are skipped (one that follows a matched one must match too), so that the run matches
+        // each path only one way.
+
+        if (!m_plan.isOptional(index) || (index > 0 && m_plan.isOptional(index - 1) && !skipped))
+            return false;
+
+        skipped = true;
+        ++index;
+    }
+
+    return false;
 }
 
 
 //--------------------------------------------------------------------------------------------------
-bool PathMatcher::match (
-    const wstring  path_pattern,
-    MatchCallback* callback_func,
-    void*          userdata)
+bool PathMatcher::Traversal::enterEntry (
+    wchar_t*                   pathEnd,
+    size_t                     index,
+    const fs::directory_entry& dirEntry,
+    const wstring&             entryName)
 {
-    // This function walks a directory tree according to the given wildcard pattern, and calls the
-    // specified callback function for each matching entry.
+    // Handle a directory entry that matched pattern component 'index'. If more pattern components
+    // remain, then descend into the entry if it's a directory. Otherwise produce the entry as a
+    // match, unless it's a file and the original pattern specified directories only.
     //
-    // 'path_pattern' is the pattern to match against tree entries.
-    // 'callback_func' is the callback function for each matching entry.
-    // 'userdata' is the user data to be passed along to callback function.
-    //
-    // This function returns true if the function successfully completes the search, otherwise
-    // false.
+    // This function returns true if it produced a match.
     //--------
 
-    if (!callback_func)      // Bail out if the user didn't provide a
-        return false;        // callback function.
+    error_code errorCode;
+    auto isDirectory = dirEntry.is_directory(errorCode);
 
-    m_callback = callback_func;
-    m_callbackData = userdata;
-    m_dirsOnly = isSlash(path_pattern.back());
+    if (index + 1 < m_plan.size()) {
+        if (!isDirectory)
+            return false;
 
-    // Groom the full pattern and split it into sub-directory patterns.
+        auto pathEndNew = appendPath (pathEnd, entryName.c_str());
+        if (!pathEndNew || pathSpaceLeft(pathEndNew) < 1)
+            return false;
 
-    auto patternVec = getNormalizedPattern(path_pattern);
-    if (patternVec.empty())
-        return false;
+        *pathEndNew++ = L'/';
+        *pathEndNew   = 0;
 
-    wcout << L"Directories only: " << (m_dirsOnly ? L"true" : L"false") << L"\n";
-    wcout << L"Normalized pattern components: ";
-    for (auto component : patternVec) {
-        wcout << L"(" << component << L")";
+        return enter (pathEndNew, index + 1);
     }
-    wcout << L"\n";
 
-    if (patternVec.empty())
+    if (m_plan.dirsOnly() && !isDirectory)
         return false;
 
-    matchDir (patternVec);
+    *pathEnd = 0;
+    auto fsPath = fs::path(m_path);
 
-    return true;
+    if (!appendPath (pathEnd, entryName.c_str()))
+        return false;
+
+    return produce (fsPath / entryName, dirEntry);
 }
 
 
 //--------------------------------------------------------------------------------------------------
-void PathMatcher::matchDir (vector<wstring>& patternVec)
+void PathMatcher::Traversal::enterSpan (wchar_t* pathEnd, bool matchPrefix)
 {
-    // This procedure matches a substring pattern against a given root directory. Each matching
-    // entry in the tree will yield a call back to the specified function, along with given user
-    // data. Note that the path string buffer will be used to pass back matching entries to the
-    // callback function.
+    // Push a frame that fetches all entries of the directory of the current path, and all
+    // entries below, matching each subpath against the span pattern.
     //
-    // 'pathend' is the end of the current path (one past the last character)
-    // 'pattern is the pattern against which to match directory entries.
+    // 'matchPrefix' is true if entries must first match the span prefix pattern (the pattern that
+    // prefixes the ellipsis, followed by an asterisk) before subsequent span pattern matching.
+    //
+    // Directories that cannot be read are silently skipped.
     //--------
 
-    wchar_t  patternBuff[] = L"dummy";  // Dummy
-    wchar_t* pattern = patternBuff;  // Dummy
-    wchar_t* pathend = pattern;   // Dummy
+    // Append slash if needed.
 
-    // If the pattern is null, then just return.
+    if ((pathEnd > m_path) && !isSlash(pathEnd[-1])) {
+        pathEnd = appendPath (pathEnd, L"/");
+        if (!pathEnd) return;     // Bail out if the append failed.
+    }
 
-    if (!pattern || !*pattern) return;
+    // Bail out if we've run out of path length.
 
-    // Characterize the type of pattern matching we'll be doing in the current directory. Scan
-    // forward to find the first of the end of the pattern, a slash, an ellipsis, or a double asterisk.
+    if (pathSpaceLeft(pathEnd) < 1) return;
 
-    int  ipatt { 0 };
-    auto fliteral = true;
+    *pathEnd = 0;
 
-    while (pattern[ipatt] && !isSlash(pattern[ipatt])
-       && !(isEllipsis(pattern + ipatt) || isDoubleAsterisk(pattern + ipatt)))
-    {
-        if ((pattern[ipatt] == L'?') || (pattern[ipatt] == L'*'))
-            fliteral = false;
+    Frame frame;
+    frame.kind        = FrameKind::Span;
+    frame.pathEnd     = pathEnd;
+    frame.directory   = fs::path(m_path);
+    frame.matchPrefix = matchPrefix;
+    frame.scan        = make_unique<DirectoryScan>(*this, frame.directory, pathEnd);
 
-        ++ ipatt;
+    if (frame.scan->isOpen())
+        m_frames.push_back(std::move(frame));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::Traversal::stepProbe (Frame& frame)
+{
+    // Look up the next name of a literal set frame, popping the frame once all names have been
+    // looked up. Returns true if a match was produced.
+
+    const auto& alternatives = *m_plan.compiled(frame.index).literalAlternatives();
+
+    while (frame.position < alternatives.size()) {
+        const auto& name = alternatives[frame.position++];
+        if (name.empty())
+            continue;
+        if (lookupEntry (frame.cached, frame.directory, name, m_lookup))
+            return enterEntry (
+                frame.pathEnd, frame.index, m_lookup, m_lookup.path().filename().wstring());
     }
 
-    // If the current pattern subdirectory contains an ellipsis, then handle the remainder of the
-    // pattern and return.
+    m_frames.pop_back();
+    return false;
+}
 
-    if (isEllipsis(pattern + ipatt) || isDoubleAsterisk(pattern + ipatt)) {
-        handleEllipsisSubpath (pathend, pattern, ipatt);
-        return;
+
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::Traversal::stepScan (Frame& frame)
+{
+    // Match the next entry of a directory frame against its name component, popping the frame at
+    // the end of the directory. The compiled component runs its literal prefilter first, and only
+    // survivors are tested against the full wildcard pattern. Returns true if a match was
+    // produced.
+
+    const fs::directory_entry* entry;
+    const wstring* name;
+
+    if (!frame.scan->next(entry, name)) {
+        m_frames.pop_back();
+        return false;
     }
 
-    assert (!pattern[ipatt] || isSlash(pattern[ipatt]));
+    const auto& dirEntry  = *entry;
+    const auto& entryName = *name;
 
-    auto fdirmatch = isSlash(pattern[ipatt]);
-    auto fdescend  = fdirmatch && (pattern[ipatt+1] != 0);
+    if (isDotsDir(entryName.c_str()))   // Ignore "." and ".." entries.
+        return false;
+
+    if (!m_plan.compiled(frame.index).matches(entryName.c_str(), entryName.size(), m_stats.prefilter)) {
+        PATHMATCH_PROBE_ENTRY_REJECT(dirEntry.path().c_str(), dirEntry.path().native().size(), frame.index);
+        return false;
+    }
 
-    // (simple) (end)
+    PATHMATCH_PROBE_ENTRY_MATCH(dirEntry.path().c_str(), dirEntry.path().native().size(), frame.index);
 
-    auto subPattern = new wchar_t [ipatt+1];
+    return enterEntry (frame.pathEnd, frame.index, dirEntry, entryName);
+}
 
-    if (!subPattern) return;   // Bail out if out of memory.
 
-    if (FAILED(wcsncpy_s (subPattern, ipatt+1, pattern, ipatt))) {
-        delete[] subPattern;
-        return;
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::Traversal::stepSpan (Frame& frame)
+{
+    // Match the subpath of the next entry of a span frame against the span pattern, popping the
+    // frame at the end of the directory. A subdirectory is descended into on the following step,
+    // after the subdirectory itself has been produced (if it matched). Returns true if a match was
+    // produced.
+
+    const fs::directory_entry* entry;
+    const wstring* name;
+
+    if (!frame.scan->next(entry, name)) {
+        m_frames.pop_back();
+        return false;
     }
 
-    // TODO: lowercase subPattern here.
+    const auto& dirEntry  = *entry;
+    const auto& entryName = *name;
 
-    // If we have a literal subdirectory name (or filename), then just provide that name to the
-    // find-file functions.
+    // Skip file entries if we're only looking for directories.
 
-    errno_t retval { S_OK };    // General Return Value
+    error_code errorCode;
+    auto isDirectory = dirEntry.is_directory(errorCode);
+    if (m_plan.dirsOnly() && !isDirectory)
+        return false;
 
-    if (fliteral)
-        retval = wcsncpy_s (pathend, pathSpaceLeft(pathend), pattern, ipatt);
+    // If there's an ellipsis prefix, then ensure first that we match against it before descending
+    // further.
+
+    if (frame.matchPrefix && !m_plan.spanPrefix()->matches(entryName)) {
+        PATHMATCH_PROBE_ENTRY_REJECT(dirEntry.path().c_str(), dirEntry.path().native().size(), -1);
+        return false;
+    }
 
-    // If there's a wildcard subdirectory or file name, then enumerate all directory entries and
-    // filter the results.
+    auto pathEndNew = appendPath (frame.pathEnd, entryName.c_str());
 
-    if (!fliteral || FAILED(retval)) {
-        pathend[0] = L'*';
-        pathend[1] = 0;
+    if (!pathEndNew) {
+        m_frames.pop_back();
+        return false;
     }
 
-    auto fsPath = fs::path(m_path);
+    if (isDirectory)
+        frame.descendEnd = pathEndNew;
 
-    for (const auto& dirEntry : fs::directory_iterator(fsPath)) {
-        // Ignore "." and ".." entries.
+    // The compiled span pattern runs its literal prefilter before the full path match.
 
-        auto entryName = dirEntry.path().filename();
+    if (m_plan.spanMatchesAll()
+        || m_plan.spanPattern().matches(m_ellipsisPath, pathEndNew - m_ellipsisPath, m_stats.prefilter)) {
+        PATHMATCH_PROBE_ENTRY_MATCH(dirEntry.path().c_str(), dirEntry.path().native().size(), -1);
+        return produce (frame.directory / entryName, dirEntry);
+    }
 
-        if (isDotsDir(entryName.c_str())) continue;
+    PATHMATCH_PROBE_ENTRY_REJECT(dirEntry.path().c_str(), dirEntry.path().native().size(), -1);
+    return false;
+}
 
-        // TODO: Create lowercase of entryName here, use for wildcomp call.
 
-        if (!fliteral) {
-            auto subPatternString = make_unique<wstring> (subPattern);
-            if (!wildComp (*subPatternString, entryName)) continue;
-        }
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::Traversal::produce (fs::path path, const fs::directory_entry& dirEntry)
+{
+    // Make the given entry the current match. Returns false (producing nothing) if the plan can
+    // match a path more than one way, and the entry has already been produced.
 
-        // Skip files if the pattern ended in a slash or if the original pattern specified
-        // directories only.
+    if (m_plan.isAmbiguous() && !m_produced.insert(path.native()).second)
+        return false;
 
-        auto isDirectory = fs::is_directory(dirEntry.status());
-        if ((m_dirsOnly || fdirmatch) && !isDirectory) {
-            // Do nothing.
-        } else if (fdescend) {
-            auto pathend_new = appendPath (pathend, entryName.c_str());
+    m_current.path  = std::move(path);
+    m_current.entry = &dirEntry;
 
-            if (!pathend_new) continue;
+    ++m_stats.matchesReported;
+    PATHMATCH_PROBE_CALLBACK(m_current.path.c_str(), m_current.path.native().size(), m_stats.matchesReported);
+    return true;
+}
 
-            *pathend_new++ = L'/';
-            *pathend_new   = 0;
 
-            //matchDir (pathend_new, pattern + ipatt + 1);
-        } else {
-            // Construct full relative entry path.
+//--------------------------------------------------------------------------------------------------
+void PathMatcher::Traversal::finish()
+{
+    // Mark the traversal complete, and record its duration in the match stats.
 
-            if (appendPath(pathend, entryName.c_str())) {
-                if (!m_callback (fsPath / entryName, dirEntry, m_callbackData))
-                    break;
-            }
-        }
-    }
+    m_done = true;
+    m_stats.traverseWallSeconds = wallSeconds() - m_startWall;
+    m_stats.traverseCpuSeconds  = processCpuSeconds() - m_startCpu;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+size_t PathMatcher::Traversal::pathSpaceLeft (const wchar_t *pathend) const
+{
+    // Returns the number of characters that can be appended to the m_path
+    // string, while allowing room for a terminating character.
 
-    delete[] subPattern;
-    return;
+    return (mc_MaxPathLength + 1) - (pathend - m_path) - 1;
 }
 
 
 //--------------------------------------------------------------------------------------------------
-void PathMatcher::handleEllipsisSubpath (
-    wchar_t       *pathend,    // One past the last character
-    const wchar_t *pattern,    // Pointer to the beginning of the current subdir of the full pattern
-    int            ipatt)      // Offset from the pattern to the beginning of the ellipsis
+wchar_t* PathMatcher::Traversal::appendPath (wchar_t *pathend, const wchar_t *str)
 {
-    // This function handles subdirectories that contain ellipses (or double asterisks).
+    // This procedure appends the current path with the specified string.
+    //
+    // Parameter 'pathend' is the end of the current path (one past the last character). Parameter
+    // 'str' is the string to append.
+    //
+    // This function  returns the new path end pointer, or null if the path buffer is not large
+    // enough to append the new entry name.
+    //--------
 
-    wchar_t* ellipsis_prefix { nullptr };    // Pattern Filter for Prefixed Ellipses
+    auto strlength = wcslen (str);
 
-    auto ellipsisEnd = isEllipsis(pattern + ipatt) ? (ipatt + 3) : (ipatt + 2);
+    // Return null if there's not enough space to append the string.
 
-    if ((ipatt == 0) && !pattern[ellipsisEnd]) {
-        // ...<end> - Just do a simple recursive fetch of the tree.
+    if (pathSpaceLeft(pathend) < (strlength + 1))
+        return nullptr;
 
-        m_ellipsisPattern = nullptr;
+    while (*str)
+        *pathend++ = *str++;
 
-    } else {
+    *pathend = 0;
 
-        m_ellipsisPattern = pattern;
-        m_ellipsisPath    = pathend;
+    return pathend;
+}
 
-        // If the ellipsis is prefixed with a pattern, then we want to save the pattern for
-        // filtering of candidate directory entries by the FetchAll routine.
 
-        if (ipatt <= 0) {
-            ellipsis_prefix = nullptr;
-        } else {
-            ellipsis_prefix = new wchar_t [ipatt+2];
+//--------------------------------------------------------------------------------------------------
+void PathMatcher::Traversal::noteDirectory (const fs::path& directory)
+{
+    // Pass a directory the match depends on to the directory callback, if there is one.
 
-            if (!ellipsis_prefix || FAILED(wcsncpy_s (ellipsis_prefix, ipatt+2, pattern, ipatt))) {
-                return;
-            }
+    if (m_matcher.m_directoryCallback) {
+        m_matcher.m_directoryCallback (
+            directory.empty() ? fs::path(L".") : directory, m_matcher.m_directoryCallbackData);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PathMatcher::CachedDirectory PathMatcher::Traversal::cachedDirectory (const fs::path& directory) const
+{
+    // Get the cache key and the current modification time of the given directory of the current
+    // path. The result is invalid if there's no directory cache. The key is the absolute path as
+    // traversed; it isn't normalized, since 'link/..' need not be the directory holding 'link'.
+
+    CachedDirectory cached;
+
+    if (!m_matcher.m_cache)
+        return cached;
+
+    auto key = m_cacheBase / directory;
+    while (!key.has_filename() && key.has_relative_path())
+        key = key.parent_path();
+
+    error_code errorCode;
+    cached.modified = fs::last_write_time(key, errorCode);
+    cached.key      = key.wstring();
+    cached.valid    = !errorCode;
+
+    return cached;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::Traversal::lookupEntry (
+    const CachedDirectory& cached,
+    const fs::path&        directory,
+    const wstring&         name,
+    fs::directory_entry&   dirEntry)
+{
+    // Look up the named entry of the given directory, first in the directory cache (if the
+    // directory has a current record there), and then in the file system. A name missing from the
+    // file system is recorded in the cache. Returns true if the entry exists, with the entry's
+    // path ending in its name as spelled on disk.
 
-            ellipsis_prefix[ipatt]   = L'*';
-            ellipsis_prefix[ipatt+1] = 0;
+    auto cache = m_matcher.m_cache;
+
+    if (cached.valid) {
+        auto lookup = cache->findEntry(cached.key, cached.modified, name, dirEntry);
+        if (lookup != DirectoryCache::Lookup::Unknown)
+            return lookup == DirectoryCache::Lookup::Found;
+    }
+
+    ++m_stats.statCalls;
+
+    error_code errorCode;
+    dirEntry = fs::directory_entry(directory / name, errorCode);
+    if (!errorCode && dirEntry.exists(errorCode)) {
+        if (c_caseInsensitiveFileSystem) {
+            auto diskName = nameOnDisk(dirEntry.path());
+            if (diskName != name)
+                dirEntry.replace_filename(diskName, errorCode);
         }
+        return true;
     }
 
-    // TODO: lowercase ellipsis_prefix here.
+    if (cached.valid)
+        cache->storeMissing(cached.key, cached.modified, name);
 
-    fetchAll (pathend, ellipsis_prefix);
-    return;
+    return false;
 }
 
 
+//==================================================================================================
+// PathMatcher::MatchRange
+//==================================================================================================
+
+static_assert(std::ranges::input_range<PathMatcher::MatchRange>);
+
+
 //--------------------------------------------------------------------------------------------------
-void PathMatcher::fetchAll (wchar_t* pathend, const wchar_t* ellipsis_prefix)
+PathMatcher::MatchRange::MatchRange (
+    unique_ptr<Traversal> traversal, shared_ptr<const MatchPlan> plan)
+  : m_plan(std::move(plan)),
+    m_traversal(std::move(traversal))
 {
-    // This procedure is called when an ellipsis is encountered, and recursively fetches all tree
-    // entries and optionally matches against a pattern.
-    //
-    // 'pathend' is the end of the current path (one past last character)
+}
+
+PathMatcher::MatchRange::MatchRange (MatchRange&&) noexcept = default;
+PathMatcher::MatchRange& PathMatcher::MatchRange::operator= (MatchRange&&) noexcept = default;
+PathMatcher::MatchRange::~MatchRange() = default;
+
+
+//--------------------------------------------------------------------------------------------------
+PathMatcher::MatchRange::iterator PathMatcher::MatchRange::begin()
+{
+    // The traversal starts with the first call to begin(). Later calls return an iterator at the
+    // traversal's current position.
+
+    if (!m_begun) {
+        m_begun = true;
+        m_result = (m_traversal && m_traversal->next()) ? &m_traversal->current() : nullptr;
+    }
+
+    return iterator (this);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+MatchStats PathMatcher::MatchRange::stats() const
+{
+    return m_traversal ? m_traversal->stats() : MatchStats{};
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PathMatcher::MatchRange::iterator& PathMatcher::MatchRange::iterator::operator++()
+{
+    m_range->m_result = m_range->m_traversal->next() ? &m_range->m_traversal->current() : nullptr;
+    return *this;
+}
+
+
+//==================================================================================================
+// PathMatcher Class Implementation
+//==================================================================================================
+
+MatchStats PathMatcher::stats() const
+{
+    lock_guard<mutex> lock (m_statsMutex);
+    return m_stats;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+shared_ptr<const MatchPlan> PathMatcher::compile (const wstring& pattern, MatchStats& stats) const
+{
+    // Groom the full pattern, split it into sub-directory patterns, and compile them, unless the
+    // pattern cache already holds the compiled pattern. The compile time is recorded in the given
+    // stats.
+
+    auto startWall = wallSeconds();
+    auto startCpu  = processCpuSeconds();
+
+    auto plan = m_patternCache ? m_patternCache->plan(pattern) : make_shared<const MatchPlan>(pattern);
+
+    stats.compileWallSeconds = wallSeconds() - startWall;
+    stats.compileCpuSeconds  = processCpuSeconds() - startCpu;
+
+    return plan;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::match (
+    const wstring  path_pattern,
+    MatchCallback* callback_func,
+    void*          userdata) const
+{
+    // This function walks a directory tree according to the given wildcard pattern, and calls the
+    // specified callback function for each matching entry.
     //
-    // 'ellipsis_prefix' is the pattern that prefixes the ellipsis, followed by an asterisk. It will
-    // be used to filter directory entries for subsequent ellipsis pattern matching.
+    // 'path_pattern' is the pattern to match against tree entries.
+    // 'callback_func' is the callback function for each matching entry.
+    // 'userdata' is the user data to be passed along to callback function.
     //
-    // This function silently returns on error.
+    // This function returns true if the function successfully completes the search, otherwise
+    // false.
     //--------
 
-    static const wchar_t c_slashstr[] { L'/', 0 };
+    if (!callback_func)     // Bail out if the user didn't provide a callback function.
+        return false;
 
-    // Append slash if needed.
+    auto range = matches (path_pattern);
+    return run (range, callback_func, userdata);
+}
 
-    if ((pathend > m_path) && !isSlash(pathend[-1])) {
-        pathend = appendPath (pathend, c_slashstr);
-        if (!pathend) return;          // Bail out if the append failed.
-    }
 
-    // Bail out if we've run out of path length.
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::match (
+    const MatchPlan& plan, MatchCallback* callback_func, void* userdata) const
+{
+    // This function walks a directory tree according to an already compiled pattern, and calls the
+    // callback function for each match until the traversal ends or the callback returns false. The
+    // plan must outlive the match.
 
-    if (pathSpaceLeft(pathend) < 1) return;
+    if (!callback_func)
+        return false;
 
-    auto fsPath = fs::path(m_path);
+    auto range = matches (plan);
+    return run (range, callback_func, userdata);
+}
 
-    for (const auto& dirEntry : fs::directory_iterator(fsPath)) {
 
-        auto entryName = dirEntry.path().filename();
+//--------------------------------------------------------------------------------------------------
+bool PathMatcher::run (MatchRange& range, MatchCallback* callback, void* userData)
+{
+    // Pull each match from the range and pass it to the callback, until the range ends or the
+    // callback returns false. Returns false if the range has no traversal (the plan is empty).
 
-        // Skip file entries if we're only looking for directories.
+    if (!range.m_traversal)
+        return false;
 
-        auto isDirectory = fs::is_directory(dirEntry.status());
-        if (m_dirsOnly && !isDirectory)
-            continue;
+    for (const auto& result : range) {
+        if (!callback (result.path, *result.entry, userData))
+            break;
+    }
 
-        // If there's an ellipsis prefix, then ensure first that we match against it before
-        // descending further.
+    return true;
+}
 
-        // TODO: Create lowercase of entryName here, use in wildcomp call.
 
-        if (ellipsis_prefix && !wildComp (ellipsis_prefix, entryName))
-            continue;
+//--------------------------------------------------------------------------------------------------
+PathMatcher::MatchRange PathMatcher::matches (const wstring& pattern) const
+{
+    // Return a lazy range of the entries that match the given pattern.
 
-        auto pathEndNew = appendPath (pathend, entryName.c_str());
+    if (pattern.empty())
+        return MatchRange (nullptr, nullptr);
 
-        if (!pathEndNew) break;
+    MatchStats compileStats;
+    auto plan = compile (pattern, compileStats);
 
-        if (!m_ellipsisPattern || pathMatch(m_ellipsisPattern, m_ellipsisPath)) {
-            if (!m_callback (fsPath / entryName, dirEntry, m_callbackData))
-                return;
-        }
+    if (plan->empty())
+        return MatchRange (nullptr, nullptr);
 
-        if (isDirectory)
-            fetchAll (pathEndNew, nullptr);
-    }
+    auto traversal = make_unique<Traversal>(*this, *plan, compileStats);
+    return MatchRange (std::move(traversal), std::move(plan));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PathMatcher::MatchRange PathMatcher::matches (const MatchPlan& plan) const
+{
+    // Return a lazy range of the entries that match an already compiled pattern. The plan must
+    // outlive the range.
+
+    if (plan.empty())
+        return MatchRange (nullptr, nullptr);
+
+    return MatchRange (make_unique<Traversal>(*this, plan, MatchStats{}), nullptr);
 }
 
 
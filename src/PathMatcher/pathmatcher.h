@@ -31,30 +31,166 @@
 #define _INCLUDED_PATHMATCHER_H
 
 
+#include "compiledpattern.h"
+#include "directorycache.h"
+#include "directoryprofile.h"
+
 #include <filesystem>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 
 namespace PathMatch
 {
 
 // Path matching test, with ellipses or double asterisk (directory-spanning path portion), asterisk
-// (substring of directory or file name), and question mark (matches any single character).
+// (substring of directory or file name), question mark (matches any single character), bracketed
+// character classes, and brace alternations.
 bool pathMatch (const wchar_t *pattern, const wchar_t *path);
 
 
+struct MatchStats
+{
+    // Counters and phase timings collected by a PathMatcher during a match.
+
+    uint64_t directoriesOpened {0};  // Directories enumerated
+    uint64_t entriesRead {0};        // Directory entries read
+    uint64_t statCalls {0};          // Direct entry lookups (literal components and root paths)
+    uint64_t matchesReported {0};    // Entries passed to the match callback
+    size_t   peakDepth {0};          // Most components in the path of an enumerated directory
+
+    PrefilterCounters prefilter;     // Prefilter and full match counters
+
+    double compileWallSeconds {0};   // Pattern normalization and compilation
+    double compileCpuSeconds {0};
+    double traverseWallSeconds {0};  // Directory traversal, matching and callbacks
+    double traverseCpuSeconds {0};
+
+    // Accumulate the stats of another match. Counters and times add; the peak depth is the larger.
+    MatchStats& operator+= (const MatchStats& other);
+};
+
+
+class MatchPlan
+{
+    //----------------------------------------------------------------------------------------------
+    // A MatchPlan is a path pattern prepared for matching one directory level at a time. The
+    // pattern is normalized and split into components, and each component is compiled for matching
+    // directory entry names. At the first component that can span directories (the span
+    // component), level-by-level matching stops: that component and all that follow are compiled
+    // together as one pattern, to be matched against each subpath below the directory reached so
+    // far.
+    //
+    // Since "*/" also matches the empty string, a lone '*' component followed by others may match
+    // no directory level at all; it is optional. Any other component that ends in '*' and is
+    // followed by others can join its text to the next component's, so it begins the span.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    MatchPlan() = default;
+    explicit MatchPlan (const std::wstring& pattern);
+
+    // True if the pattern is empty (and so matches nothing).
+    bool empty() const { return m_components.empty(); }
+
+    // The number of pattern components.
+    size_t size() const { return m_components.size(); }
+
+    // True if the pattern ends in a slash, and so matches directories only.
+    bool dirsOnly() const { return m_dirsOnly; }
+
+    // The text of a component, in plain pattern syntax.
+    const std::wstring& text (size_t index) const { return m_components[index].text; }
+
+    // True if the component is the leading slash of an absolute pattern.
+    bool isRoot (size_t index) const { return m_components[index].kind == Kind::Root; }
+
+    // True if the component is a parent directory ("..").
+    bool isParent (size_t index) const { return m_components[index].kind == Kind::Parent; }
+
+    // True if the component is a lone '*' ahead of the span that may also match no directory level.
+    bool isOptional (size_t index) const { return m_components[index].optional; }
+
+    // True if an entry's path can match the components in more than one way (past optional
+    // components), so that a traversal must take care to report each entry only once.
+    bool isAmbiguous() const { return m_ambiguous; }
+
+    // The compiled form of a name component, for matching a single entry name. Components that
+    // follow the span component are only matched as part of the span pattern, and aren't compiled
+    // on their own.
+    const CompiledPattern& compiled (size_t index) const { return m_components[index].compiled; }
+
+    // The index of the span component, or size() if no component spans directories.
+    size_t spanIndex() const { return m_spanIndex; }
+
+    // True if the span component is a lone trailing ellipsis, so that every entry below matches.
+    bool spanMatchesAll() const { return m_spanMatchesAll; }
+
+    // The pattern that the first subpath component below the span directory must match (the part
+    // of the span component before its first ellipsis or brace group, followed by '*'), or null if
+    // there is no such prefix.
+    const CompiledPattern* spanPrefix() const { return m_hasSpanPrefix ? &m_spanPrefix : nullptr; }
+
+    // The compiled span pattern: the span component and all that follow, joined with slashes.
+    const CompiledPattern& spanPattern() const { return m_spanPattern; }
+
+  private:
+
+    enum class Kind { Name, Root, Parent };
+
+    struct Component
+    {
+        std::wstring    text;       // Plain pattern text
+        Kind            kind;       // Name pattern, root slash, or parent directory
+        CompiledPattern compiled;   // Compiled name pattern
+        bool            optional {false};   // May match no directory level
+    };
+
+    std::vector<Component> m_components;
+    bool            m_dirsOnly {false};
+    bool            m_ambiguous {false};
+    size_t          m_spanIndex {0};
+    bool            m_spanMatchesAll {false};
+    bool            m_hasSpanPrefix {false};
+    CompiledPattern m_spanPrefix;
+    CompiledPattern m_spanPattern;
+};
+
+
+class PatternCache;
+
+
+struct MatchResult
+{
+    // A matching entry produced by a match range. The directory entry is held by the traversal,
+    // and is valid only until the range advances.
+
+    std::filesystem::path                   path;              // Entry path, as for MatchCallback
+    const std::filesystem::directory_entry* entry {nullptr};   // Directory entry of the match
+};
+
+
 class PathMatcher
 {
     //---------------------------------------------------------------------------------------------
     // The PathMatcher class traverses the file system and reports all entries in a directory tree
     // tree that match a specified pattern. This pattern may contain the special match operators
     // '?', '*', '**', and '...'.
+    //
+    // The match functions are const: all the state of a match lives in its own traversal, and the
+    // compiled MatchPlan it walks is immutable. Once configured, one matcher may run any number of
+    // matches at the same time, on any number of threads. The caches and profile given to it are
+    // thread-safe; a directory callback may be called from several threads at once. The setters
+    // must not be called while matches are running.
     //---------------------------------------------------------------------------------------------
 
   public:
 
-    PathMatcher();
-    ~PathMatcher();
+    PathMatcher() = default;
 
     // The callback function signature that PathMatcher uses to report back all matching entries.
     using MatchCallback = bool (
@@ -63,40 +199,159 @@ class PathMatcher
         void* userData);
 
     // The main match procedure.
-    bool match (const std::wstring pattern, MatchCallback* callback, void* userData);
+    bool match (const std::wstring pattern, MatchCallback* callback, void* userData) const;
+
+    // Match an already compiled pattern, so that a pattern used many times is compiled only once.
+    // The plan must outlive the match.
+    bool match (const MatchPlan& plan, MatchCallback* callback, void* userData) const;
+
+    class MatchRange;
+
+    // Match a pattern lazily. The returned range walks the tree only as far as needed to produce
+    // each next match, so a consumer may stop early or interleave several ranges, without threads
+    // or buffering. The matcher must outlive the range.
+    MatchRange matches (const std::wstring& pattern) const;
+
+    // Match an already compiled pattern lazily. The plan must outlive the range.
+    MatchRange matches (const MatchPlan& plan) const;
+
+    // Prefilter hit-rate counters for the most recently completed match.
+    PrefilterCounters prefilterCounters() const { return stats().prefilter; }
+
+    // Counters and timings for the most recently completed match (a match range completes when it
+    // is destroyed). When matches run concurrently, use the stats of each match or range instead.
+    MatchStats stats() const;
+
+    // Record the latency of each directory read into the given profile, or turn directory
+    // profiling off if the profile is null. The profile must outlive any matches that use it.
+    // When profiling is off, the traversal does no timing work at all.
+    void setDirectoryProfile (DirectoryProfile* profile) { m_profile = profile; }
+
+    // Take compiled patterns from the given cache, so that a pattern matched again (by this or any
+    // other matcher sharing the cache) is compiled only once. A null cache turns this off. The
+    // cache must outlive any matches that use it.
+    void setPatternCache (PatternCache* cache) { m_patternCache = cache; }
+
+    // Keep the directory listings read by matches in the given cache, and answer later directory
+    // reads and entry lookups from it where the cached records are still current. A null cache
+    // turns caching off. The cache must outlive any matches that use it.
+    void setDirectoryCache (DirectoryCache* cache) { m_cache = cache; }
+
+    // The callback function signature used to report the directories a match depends on.
+    using DirectoryCallback = void (const std::filesystem::path& directory, void* userData);
+
+    // Report each directory whose contents a match depends on: those it enumerates, and those it
+    // looks up literal names in. The current directory is reported as ".". A null callback turns
+    // this off.
+    void setDirectoryCallback (DirectoryCallback* callback, void* userData) {
+        m_directoryCallback = callback;
+        m_directoryCallbackData = userData;
+    }
 
     // Temporarily define a maximum path length. This is the Windows max path length, but it appears
     // that std::filesystem has no maximum path length (or it's not exposed).
     static const auto mc_MaxPathLength = 260;
 
-  private:   // Private Member Variables
+    // On case-insensitive file systems, components that expand to at most this many literal names
+    // are resolved by looking up each name directly. Larger sets (and all sets on case-sensitive
+    // file systems, where a direct lookup would miss names that differ only in case) are matched
+    // by hash lookup against each directory entry.
+    static const size_t mc_MaxProbeCount = 64;
 
-    MatchCallback* m_callback = nullptr;     // Match Callback Function
-    void*          m_callbackData = nullptr; // Callback Function Data
+  private:   // Private Member Variables
 
-    wchar_t* m_path;              // Current path
-    bool     m_dirsOnly = false;  // If true, report directories only
+    mutable std::mutex m_statsMutex;      // Guards m_stats
+    mutable MatchStats m_stats;           // Counters for the most recently completed match
 
-    std::wstring m_pattern;
-    wchar_t*     m_patternBuff = nullptr;        // Wildcarded portion of the given pattern
-    size_t       m_patternBufferSize = 0;        // Size of the pattern buffer.
+    PatternCache*     m_patternCache = nullptr;   // Compiled pattern cache (null: none)
+    DirectoryProfile* m_profile = nullptr;        // Directory latency profile (null: profiling off)
+    DirectoryCache*   m_cache = nullptr;          // Directory listing cache (null: caching off)
 
-    const wchar_t* m_ellipsisPattern = nullptr;  // Ellipsis Pattern
-    wchar_t*       m_ellipsisPath = nullptr;     // Path part to match against ellipsis pattern
+    DirectoryCallback* m_directoryCallback = nullptr;   // Directory dependency callback and data
+    void*              m_directoryCallbackData = nullptr;
 
 
   private:   // Private Methods
 
-    void handleEllipsisSubpath (wchar_t *pathEnd, const wchar_t *pattern, int iPattern);
+    class DirectoryScan;
+    class Traversal;
+
+    struct CachedDirectory
+    {
+        // The cache key and current modification time of a directory.
+
+        bool                            valid {false};   // False if there's no cache, or the
+                                                         // directory couldn't be examined
+        std::wstring                    key;             // Absolute directory path
+        std::filesystem::file_time_type modified;
+    };
+
+    std::shared_ptr<const MatchPlan> compile (const std::wstring& pattern, MatchStats& stats) const;
+
+    static bool run (MatchRange& range, MatchCallback* callback, void* userData);
+};
+
+
+class PathMatcher::MatchRange
+{
+    //----------------------------------------------------------------------------------------------
+    // A MatchRange is a C++20 input range over the entries that match a pattern, produced on
+    // demand by an explicit traversal state machine. Only one pass is possible: begin() starts the
+    // traversal, and each increment resumes it up to the next match.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    class iterator
+    {
+      public:
+
+        using iterator_category = std::input_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = MatchResult;
+
+        iterator() = default;
+
+        const MatchResult& operator*  () const { return *m_range->m_result; }
+        const MatchResult* operator-> () const { return m_range->m_result; }
+
+        iterator& operator++ ();
+        void operator++ (int) { ++*this; }
 
-    void matchDir (std::vector<std::wstring>& patternVec);
-    void fetchAll (wchar_t* pathend, const wchar_t* ellipsisPrefix);
+        friend bool operator== (const iterator& it, std::default_sentinel_t) { return it.atEnd(); }
 
-    wchar_t* appendPath (wchar_t *pathEnd, const wchar_t *str);
+      private:
 
-    size_t pathSpaceLeft (const wchar_t *pathEnd) const;
+        friend class MatchRange;
+        explicit iterator (MatchRange* range) : m_range(range) {}
+
+        bool atEnd() const { return !m_range || !m_range->m_result; }
+
+        MatchRange* m_range = nullptr;
+    };
+
+    MatchRange (MatchRange&&) noexcept;
+    MatchRange& operator= (MatchRange&&) noexcept;
+    ~MatchRange();
+
+    iterator begin();
+    std::default_sentinel_t end() const { return {}; }
+
+    // Counters and timings for this match so far.
+    MatchStats stats() const;
+
+  private:
+
+    friend class PathMatcher;
+    MatchRange (std::unique_ptr<Traversal> traversal, std::shared_ptr<const MatchPlan> plan);
+
+    std::shared_ptr<const MatchPlan> m_plan;       // The plan, if compiled for this range
+    std::unique_ptr<Traversal>       m_traversal;  // Traversal state (null: no matches)
+    const MatchResult*               m_result = nullptr;   // Current match (null: at the end)
+    bool                             m_begun = false;      // True once begin() has been called
 };
 
+
 }; // Namespace PathMatch
 
 
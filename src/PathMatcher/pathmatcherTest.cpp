@@ -1,8 +1,18 @@
+#include <directorycache.h>
+#include <pathindex.h>
 #include <pathmatcher.h>
+#include <patterncache.h>
+#include <testpatterns.h>
 
+#include <chrono>
 #include <fcntl.h>
+#include <filesystem>
+#include <fstream>
 #include <io.h>
 #include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -20,54 +30,635 @@ void testNormalizedPattern (const wstring& pattern) {
 
 }
 
-static const wstring testPatterns[] {
-    L"",
-    L"/",
-    L"\\",
-    L"\\\\////\\\\\\",
-    L"a",
-    L"a\\",
-    L"a/",
-    L"a////",
-    L"/a",
-    L"/\\///\\\\\\a",
-    L"/a/",
-    L"/\\///\\\\\\a\\//\\\\",
-    L"\\a",
-    L"\\a\\",
-    L"a/b/c",
-    L"a/b/c/",
-    L"a/b\\c/d\\e\\f",
-    L"a/b\\c/d\\e\\f\\",
-    L"a//\\\\/b//c",
-    L"a//\\\\/b//c/",
-    L"a/b/c/../x/y/z",
-    L"a/b/c/../../x/y/z",
-    L"a/b/c/../../x/y/z/",
-    L"../../x/y/z",
-    L"a/b/../../../../x/y/z",
-    L"a/./b",
-    L"a/./b/./././c",
-    L"a/**/b/.../c/**",
-    L"a/**/b/.../c/**/",
-    L"a/**......****/b",
-    L"a/**......****/b/",
-    L"a.../b",
-    L"...b/c",
-    L"a...b",
-    L"a...b...c",
-    L"a...b...c/",
-    L"a/b*.../c",
-    L"a/b?.../c",
-    L"a/...b/c",
-    L"a/...*b/c",
-    L"a/...?b/c",
+void testLiteralFilter (const wstring& pattern) {
+    auto filter = PathMatch::extractLiteralFilter(pattern);
+    auto compiled = PathMatch::CompiledPattern(pattern);
+
+    wcout << L"\nPattern: (" << pattern << L")\n";
+    wcout << L"    prefix (" << filter.prefix << L")  suffix (" << filter.suffix << L")  literals ";
+    for (auto& literal : filter.literals) {
+        wcout << L"(" << literal << L") ";
+    }
+    wcout << L"\n    length [" << filter.minLength << L", ";
+    if (filter.maxLength == SIZE_MAX)
+        wcout << L"unbounded]\n";
+    else
+        wcout << filter.maxLength << L"]\n";
+    wcout << L"    engine " << PathMatch::engineName(compiled.engine()) << L"\n";
+}
+
+static const wstring testFilterPatterns[] {
+    L"abc",
+    L"a?c",
+    L"*.cpp",
+    L"...cache...tmp",
+    L"src/.../*Test.cpp",
+    L"src/*/foo",
+    L"Foo*Bar*Baz",
+    L"....obj",
+    L"...*Test.cpp",
+    L".../foo/?.h",
+    L"...foo...bar",
+    L"a?b?c?d?e?f?g?h?i?j?k?l?m?n?o?p?q?r?s?t?u?v?w?x?y?z?0?1?2?3?4?5*",
+    L"[a-c]x[!.]y.txt",
+    L"...[Tt]est.cpp",
+    L"*.{cpp,h}",
+    L"src/{PathMatcher,WildComp}/*.cpp",
+    L"shard-{a1,a2,A2,b{1,2,3}}",
 };
 
+set<wstring> matchNames (const PathMatch::PathMatcher& matcher, const wstring& pattern) {
+    set<wstring> names;
+    for (auto& result : matcher.matches(pattern))
+        names.insert(result.path.filename().wstring());
+    return names;
+}
+
+bool testLiteralSetCase () {
+    // A small set of literal names must find the same entries as an equivalent wildcard, even
+    // where the names differ in case from the directory entries.
+
+    auto directory = filesystem::temp_directory_path() / L"pathmatcherTest-literal-set";
+    filesystem::remove_all(directory);
+    filesystem::create_directories(directory);
+    for (auto name : { L"A1", L"a2", L"B3", L"c1" })
+        ofstream(directory / name);
+
+    PathMatch::PathMatcher matcher;
+    auto base = directory.wstring() + L"/";
+    auto literalSet = matchNames(matcher, base + L"{a1,a2,b3}");
+    auto wildcard   = matchNames(matcher, base + L"[ab][0-9]");
+
+    filesystem::remove_all(directory);
+
+    wcout << L"\nLiteral set ({a1,a2,b3}): ";
+    for (auto& name : literalSet)
+        wcout << L"(" << name << L") ";
+    wcout << L"\nWildcard    ([ab][0-9]):  ";
+    for (auto& name : wildcard)
+        wcout << L"(" << name << L") ";
+    wcout << L"\n";
+
+    if (literalSet != wildcard) {
+        wcout << L"FAIL: The literal set and wildcard matches differ.\n";
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Traversal Agreement
+
+static const wstring traversalPatterns[] {
+    L"*",
+    L"*/b",
+    L"*/*",
+    L"*/*/*",
+    L"*/*/*/*",
+    L"a*/b",
+    L"*/a/*/a",
+    L"*/a/*/*",
+    L"x/*/b",
+    L"*/.../b",
+    L"a/.../*",
+    L"...",
+    L".../b",
+    L"...b",
+    L"*b*/*",
+    L"?/*",
+    L"?/*/b",
+    L"{a,x}/*",
+    L"*.txt",
+    L".../*.txt",
+    L"*/*.txt",
+    L"a*/.../b",
+    L"[ax]/*/[ab]",
+    L"*/",
+    L"*/*/",
+    L"x/*/",
+    L"?*/b",
+    L"*a*/*",
+    L"*/x/*/*/b",
+    L"{a,x}*/b",
+    L"*/{a,x}/b",
+};
+
+void makeTestTree (const filesystem::path& root) {
+    // Build a small tree whose directory and file names repeat at several levels, so that the
+    // traversal patterns can match the same names in more than one way.
+
+    filesystem::remove_all(root);
+
+    for (auto directory : { L"a/a", L"ab/b", L"x/y/z" })
+        filesystem::create_directories(root / directory);
+
+    for (auto file : { L"a/b", L"a/a/a", L"a/a/b.txt", L"b", L"ab/b/b", L"x/b", L"x/y/b", L"x/y/z/b.txt", L"c.txt" })
+        ofstream(root / file);
+}
+
+set<wstring> treePaths (const filesystem::path& root) {
+    // Return the relative path (with forward slashes) of every entry in the tree.
+
+    set<wstring> paths;
+    for (auto& entry : filesystem::recursive_directory_iterator(root))
+        paths.insert(entry.path().lexically_relative(root).generic_wstring());
+    return paths;
+}
+
+bool testTraversalMatches () {
+    // A traversal must report exactly the entries whose relative paths pathMatch() accepts, and
+    // each of them once. The patterns are matched from within the tree, so that reported paths are
+    // relative to its root.
+
+    auto root = filesystem::temp_directory_path() / L"pathmatcherTest-traversal";
+    makeTestTree(root);
+
+    auto paths = treePaths(root);
+    auto savedDirectory = filesystem::current_path();
+    filesystem::current_path(root);
+
+    PathMatch::PathMatcher matcher;
+    bool passed = true;
+
+    for (auto& pattern : traversalPatterns) {
+        auto dirsOnly = pattern.back() == L'/';
+
+        // A pattern that ends in a slash matches the directories that the rest of it matches.
+
+        auto pathPattern = dirsOnly ? pattern.substr(0, pattern.size() - 1) : pattern;
+
+        set<wstring> expected;
+        for (auto& path : paths) {
+            if (PathMatch::pathMatch(pathPattern.c_str(), path.c_str())
+                && (!dirsOnly || filesystem::is_directory(path)))
+                expected.insert(path);
+        }
+
+        set<wstring> reported;
+        size_t reports = 0;
+        for (auto& result : matcher.matches(pattern)) {
+            reported.insert(result.path.generic_wstring());
+            ++reports;
+        }
+
+        if (reported != expected || reports != reported.size()) {
+            wcout << L"FAIL: Traversal of (" << pattern << L") reported " << reports
+                  << L" entries; pathMatch expects " << expected.size() << L":";
+            for (auto& path : expected)
+                wcout << L" (" << path << L")";
+            wcout << L"\n";
+            passed = false;
+        }
+    }
+
+    filesystem::current_path(savedDirectory);
+    filesystem::remove_all(root);
+
+    wcout << L"\nTraversal agreement with pathMatch: " << (passed ? L"pass" : L"FAIL") << L"\n";
+    return passed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Caches, Match Ranges and Concurrency
+
+set<wstring> matchPaths (const PathMatch::PathMatcher& matcher, const wstring& pattern) {
+    set<wstring> paths;
+    for (auto& result : matcher.matches(pattern))
+        paths.insert(result.path.generic_wstring());
+    return paths;
+}
+
+void backdateDirectories (const filesystem::path& root) {
+    // Set the modification time of every directory in the tree an hour back, so that caches and
+    // index refreshes can trust that they haven't changed since they were read.
+
+    auto past = filesystem::file_time_type::clock::now() - chrono::hours(1);
+    filesystem::last_write_time(root, past);
+    for (auto& entry : filesystem::recursive_directory_iterator(root)) {
+        if (entry.is_directory())
+            filesystem::last_write_time(entry.path(), past);
+    }
+}
+
+bool testCachedMatches () {
+    // Matches through the directory and pattern caches must report the same entries as uncached
+    // matches, both when answered from the caches and after a cached directory changes.
+
+    auto root = filesystem::temp_directory_path() / L"pathmatcherTest-cache";
+    makeTestTree(root);
+    backdateDirectories(root);
+
+    auto savedDirectory = filesystem::current_path();
+    filesystem::current_path(root);
+
+    PathMatch::PathMatcher    matcher;
+    PathMatch::PathMatcher    cachedMatcher;
+    PathMatch::DirectoryCache directoryCache;
+    PathMatch::PatternCache   patternCache;
+
+    cachedMatcher.setDirectoryCache(&directoryCache);
+    cachedMatcher.setPatternCache(&patternCache);
+
+    bool passed = true;
+
+    // Each pattern is matched twice, so that the second match is answered from the caches.
+
+    for (auto pass = 0;  pass < 2;  ++pass) {
+        for (auto& pattern : traversalPatterns) {
+            if (matchPaths(cachedMatcher, pattern) != matchPaths(matcher, pattern)) {
+                wcout << L"FAIL: Cached match of (" << pattern << L") differs from uncached.\n";
+                passed = false;
+            }
+        }
+    }
+
+    auto cacheStats = directoryCache.stats();
+    if (cacheStats.listingHits == 0 || patternCache.stats().hits == 0) {
+        wcout << L"FAIL: Repeated matches weren't answered from the caches.\n";
+        passed = false;
+    }
+
+    // Adding a file changes its directory, so the cached listing must be dropped and the new file
+    // reported.
+
+    ofstream(root / L"a/new.txt");
+
+    auto paths = matchPaths(cachedMatcher, L"a/*");
+    if (paths != matchPaths(matcher, L"a/*") || !paths.contains(L"a/new.txt")) {
+        wcout << L"FAIL: Cached match of (a/*) doesn't report a newly added file.\n";
+        passed = false;
+    }
+
+    if (directoryCache.stats().invalidations <= cacheStats.invalidations) {
+        wcout << L"FAIL: The stale listing of (a) wasn't invalidated.\n";
+        passed = false;
+    }
+
+    filesystem::current_path(savedDirectory);
+    filesystem::remove_all(root);
+
+    wcout << L"\nCached matches agree with uncached: " << (passed ? L"pass" : L"FAIL") << L"\n";
+    return passed;
+}
+
+bool testMatchRangeBreak () {
+    // Leaving a match range early must stop its traversal where it is: the range's counters show
+    // only the work done to produce the first match, and later matches are unaffected.
+
+    auto root = filesystem::temp_directory_path() / L"pathmatcherTest-range";
+    makeTestTree(root);
+
+    auto savedDirectory = filesystem::current_path();
+    filesystem::current_path(root);
+
+    PathMatch::PathMatcher matcher;
+    bool passed = true;
+
+    PathMatch::MatchStats fullStats;
+    {
+        auto range = matcher.matches(L"...");
+        for ([[maybe_unused]] auto& result : range)
+            ;
+        fullStats = range.stats();
+    }
+
+    PathMatch::MatchStats partialStats;
+    size_t results = 0;
+    {
+        auto range = matcher.matches(L"...");
+        for ([[maybe_unused]] auto& result : range) {
+            ++results;
+            break;
+        }
+        partialStats = range.stats();
+    }
+
+    if (results != 1 || partialStats.matchesReported != 1
+        || partialStats.directoriesOpened >= fullStats.directoriesOpened) {
+        wcout << L"FAIL: Breaking out of a match range didn't stop its traversal ("
+              << partialStats.directoriesOpened << L" of " << fullStats.directoriesOpened
+              << L" directories opened).\n";
+        passed = false;
+    }
+
+    if (matchPaths(matcher, L"...") != treePaths(root)) {
+        wcout << L"FAIL: A match after an abandoned range reports different entries.\n";
+        passed = false;
+    }
+
+    filesystem::current_path(savedDirectory);
+    filesystem::remove_all(root);
+
+    wcout << L"\nMatch range early exit: " << (passed ? L"pass" : L"FAIL") << L"\n";
+    return passed;
+}
+
+bool testConcurrentMatches () {
+    // Several threads matching through one const matcher (sharing its caches) must each get the
+    // same results as a single-threaded match.
+
+    const int threadCount = 8;
+
+    auto root = filesystem::temp_directory_path() / L"pathmatcherTest-threads";
+    makeTestTree(root);
+    backdateDirectories(root);
+
+    auto savedDirectory = filesystem::current_path();
+    filesystem::current_path(root);
+
+    PathMatch::PathMatcher    matcher;
+    PathMatch::DirectoryCache directoryCache;
+    PathMatch::PatternCache   patternCache;
+
+    vector<set<wstring>> expected;
+    for (auto& pattern : traversalPatterns)
+        expected.push_back(matchPaths(matcher, pattern));
+
+    matcher.setDirectoryCache(&directoryCache);
+    matcher.setPatternCache(&patternCache);
+
+    const PathMatch::PathMatcher& sharedMatcher = matcher;
+    vector<int> failures (threadCount, 0);
+    vector<thread> threads;
+
+    for (int threadIndex = 0;  threadIndex < threadCount;  ++threadIndex) {
+        threads.emplace_back([&, threadIndex] {
+            for (auto repeat = 0;  repeat < 4;  ++repeat) {
+                for (size_t i = 0;  i < expected.size();  ++i) {
+                    // Each thread starts at a different pattern, so that different matches overlap.
+
+                    auto index = (i + threadIndex) % expected.size();
+                    if (matchPaths(sharedMatcher, traversalPatterns[index]) != expected[index])
+                        ++failures[threadIndex];
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    bool passed = true;
+    for (int threadIndex = 0;  threadIndex < threadCount;  ++threadIndex) {
+        if (failures[threadIndex]) {
+            wcout << L"FAIL: Thread " << threadIndex << L" got " << failures[threadIndex]
+                  << L" differing result sets.\n";
+            passed = false;
+        }
+    }
+
+    filesystem::current_path(savedDirectory);
+    filesystem::remove_all(root);
+
+    wcout << L"\nConcurrent matches agree: " << (passed ? L"pass" : L"FAIL") << L"\n";
+    return passed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Index Agreement
+
+static const wstring indexPatterns[] {
+    L"...b.txt",
+    L"...y/b",
+    L".../a/b",
+    L"*/*/b*",
+    L"...new...",
+};
+
+struct IndexResults {
+    set<wstring> paths;     // Reported paths
+    size_t       reports;   // Number of reports, including any duplicates
+};
+
+bool indexCallback (const wstring& path, bool, void* userData) {
+    auto results = static_cast<IndexResults*>(userData);
+    results->paths.insert(path);
+    ++results->reports;
+    return true;
+}
+
+bool compareIndex (
+    const PathMatch::PathIndex&   index,
+    const PathMatch::PathMatcher& matcher,
+    const wstring&                pattern)
+{
+    // An index query must report the same entries as a traversal of the tree, each of them once.
+
+    set<wstring> expected;
+    for (auto& result : matcher.matches(pattern))
+        expected.insert(result.path.generic_wstring());
+
+    IndexResults results {{}, 0};
+    index.match(pattern, &indexCallback, &results);
+
+    if (results.paths == expected && results.reports == results.paths.size())
+        return true;
+
+    wcout << L"FAIL: Index" << (index.hasTrigrams() ? L" (trigrams)" : L"") << L" query ("
+          << pattern << L") reported " << results.reports << L" entries; the traversal reports "
+          << expected.size() << L":";
+    for (auto& path : expected)
+        wcout << L" (" << path << L")";
+    wcout << L"\n";
+    return false;
+}
+
+bool compareIndexes (const filesystem::path& indexDirectory, const PathMatch::PathMatcher& matcher) {
+    // Compare queries on the plain and trigram indexes with traversals, for every traversal and
+    // index pattern.
+
+    bool passed = true;
+
+    for (auto trigrams : { false, true }) {
+        PathMatch::PathIndex index;
+        wstring error;
+        auto file = indexDirectory / (trigrams ? L"trigrams.pmi" : L"plain.pmi");
+
+        if (!index.open(file, error)) {
+            wcout << L"FAIL: " << error << L"\n";
+            return false;
+        }
+
+        for (auto& pattern : traversalPatterns)
+            passed = compareIndex(index, matcher, pattern) && passed;
+        for (auto& pattern : indexPatterns)
+            passed = compareIndex(index, matcher, pattern) && passed;
+    }
+
+    return passed;
+}
+
+bool testIndexMatches () {
+    // Index queries must agree with traversals, with and without trigrams, both for a freshly built
+    // index and for one refreshed after the tree changes. The tree's directories are backdated, so
+    // that the refresh can trust (and reuse) those that haven't changed.
+
+    auto root = filesystem::temp_directory_path() / L"pathmatcherTest-index";
+    auto indexDirectory = filesystem::temp_directory_path() / L"pathmatcherTest-index-files";
+
+    makeTestTree(root);
+    filesystem::remove_all(indexDirectory);
+    filesystem::create_directories(indexDirectory);
+
+    backdateDirectories(root);
+
+    auto savedDirectory = filesystem::current_path();
+    filesystem::current_path(root);
+
+    PathMatch::PathMatcher matcher;
+    bool passed = true;
+    wstring error;
+
+    for (auto trigrams : { false, true }) {
+        auto file = indexDirectory / (trigrams ? L"trigrams.pmi" : L"plain.pmi");
+        if (!PathMatch::PathIndex::build(L".", file, trigrams, error)) {
+            wcout << L"FAIL: " << error << L"\n";
+            passed = false;
+        }
+    }
+
+    passed = passed && compareIndexes(indexDirectory, matcher);
+
+    // Add and remove entries, then refresh both indexes. The changed directories must be read
+    // again, and the rest reused.
+
+    ofstream(root / L"a/new.txt");
+    filesystem::create_directories(root / L"x/y/new");
+    filesystem::remove(root / L"ab/b/b");
+
+    for (auto trigrams : { false, true }) {
+        PathMatch::IndexBuildStats stats;
+        auto file = indexDirectory / (trigrams ? L"trigrams.pmi" : L"plain.pmi");
+
+        if (!PathMatch::PathIndex::refresh(file, error, &stats)) {
+            wcout << L"FAIL: " << error << L"\n";
+            passed = false;
+        } else if (stats.directoriesReused == 0 || stats.directoriesListed == 0) {
+            wcout << L"FAIL: Index refresh listed " << stats.directoriesListed << L" and reused "
+                  << stats.directoriesReused << L" directories.\n";
+            passed = false;
+        }
+    }
+
+    passed = passed && compareIndexes(indexDirectory, matcher);
+
+    if (passed) {
+        PathMatch::PathIndex index;
+        IndexResults added {{}, 0};
+        IndexResults removed {{}, 0};
+
+        if (index.open(indexDirectory / L"plain.pmi", error)) {
+            index.match(L"...new...", &indexCallback, &added);
+            index.match(L"ab/b/b", &indexCallback, &removed);
+        }
+
+        if (added.paths != set<wstring>{ L"a/new.txt", L"x/y/new" } || !removed.paths.empty()) {
+            wcout << L"FAIL: The refreshed index doesn't hold the tree's changes.\n";
+            passed = false;
+        }
+    }
+
+    filesystem::current_path(savedDirectory);
+    filesystem::remove_all(root);
+    filesystem::remove_all(indexDirectory);
+
+    wcout << L"\nIndex agreement with traversal: " << (passed ? L"pass" : L"FAIL") << L"\n";
+    return passed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Engine Agreement
+
+vector<wstring> corpusPaths () {
+    // Return every path of one to four components drawn from a small set of names. The names
+    // repeat the literals and special characters of the test patterns, in both cases.
+
+    static const wstring names[] {
+        L"a", L"B", L"c", L"d", L"e", L"x", L"y", L"z", L"ab", L".x", L"*x", L"b.cpp", L"A2",
+    };
+
+    vector<wstring> paths { L"" };
+    size_t levelStart = 0;
+
+    for (auto depth = 1;  depth <= 4;  ++depth) {
+        auto levelEnd = paths.size();
+        for (auto i = levelStart;  i < levelEnd;  ++i) {
+            for (auto& name : names)
+                paths.push_back(paths[i].empty() ? name : paths[i] + L'/' + name);
+        }
+        levelStart = levelEnd;
+    }
+
+    paths.erase(paths.begin());
+    return paths;
+}
+
+bool testEngineAgreement () {
+    // Every engine, when forced, must match exactly the corpus paths that pathMatch() matches. An
+    // engine that can't handle a pattern falls back to another, so those cases pass trivially.
+
+    static const PathMatch::MatchEngine engines[] {
+        PathMatch::MatchEngine::Recursive,
+        PathMatch::MatchEngine::Reverse,
+        PathMatch::MatchEngine::ShiftAnd,
+        PathMatch::MatchEngine::LazyDfa,
+        PathMatch::MatchEngine::LiteralSet,
+    };
+
+    auto paths = corpusPaths();
+
+    vector<wstring> patterns (begin(PathMatchTest::testPatterns), end(PathMatchTest::testPatterns));
+    patterns.insert(patterns.end(), begin(testFilterPatterns), end(testFilterPatterns));
+
+    bool passed = true;
+
+    for (auto& pattern : patterns) {
+        for (auto engine : engines) {
+            PathMatch::CompiledPattern compiled (pattern, engine);
+            size_t disagreements = 0;
+            const wstring* example = nullptr;
+
+            for (auto& path : paths) {
+                if (compiled.matches(path) != PathMatch::pathMatch(pattern.c_str(), path.c_str())) {
+                    ++disagreements;
+                    if (!example)
+                        example = &path;
+                }
+            }
+
+            if (disagreements) {
+                wcout << L"FAIL: Engine " << PathMatch::engineName(engine) << L" (running "
+                      << PathMatch::engineName(compiled.engine()) << L") disagrees with pathMatch"
+                      << L" on " << disagreements << L" paths for (" << pattern << L"), such as ("
+                      << *example << L").\n";
+                passed = false;
+            }
+        }
+    }
+
+    wcout << L"\nForced engines agree with pathMatch: " << (passed ? L"pass" : L"FAIL") << L"\n";
+    return passed;
+}
+
 int main() {
     _setmode(_fileno(stdout), _O_U8TEXT);
 
-    for (auto pattern : testPatterns) {
+    for (auto pattern : PathMatchTest::testPatterns) {
         testNormalizedPattern(pattern);
     } 
+
+    for (auto pattern : testFilterPatterns) {
+        testLiteralFilter(pattern);
+    }
+
+    bool passed = testLiteralSetCase();
+    passed = testEngineAgreement() && passed;
+    passed = testTraversalMatches() && passed;
+    passed = testCachedMatches() && passed;
+    passed = testMatchRangeBreak() && passed;
+    passed = testConcurrentMatches() && passed;
+    passed = testIndexMatches() && passed;
+
+    return passed ? 0 : 1;
 }
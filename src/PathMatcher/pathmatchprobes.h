@@ -0,0 +1,119 @@
+#ifndef _INCLUDED_PATHMATCHPROBES_H
+//==================================================================================================
+// pathmatchprobes.h
+//
+// Static tracepoints (USDT probes) in the PathMatcher traversal and match paths.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATHMATCHPROBES_H
+
+//--------------------------------------------------------------------------------------------------
+// Where <sys/sdt.h> is available (SystemTap headers on Linux), each probe compiles to a single
+// no-op instruction plus a note in the binary's .note.stapsdt section. An unattached probe costs
+// nothing beyond that instruction, and tools such as bpftrace, perf and SystemTap can attach to the
+// probes of a running process without a rebuild. For example:
+//
+//     bpftrace -e 'usdt:./pathmatch:pathmatch:dir__close { @entries[str(arg0)] = sum(arg2); }'
+//
+// On Windows, the probes are TraceLogging (ETW) events of provider "pathmatch", whose GUID
+// {70cb4ff1-1ca7-501d-ce34-9637916f7ab6} is derived from its name, so tools that accept
+// "*pathmatch" for a provider find it too. Without a listening session, each probe costs a test of
+// the provider's enabled flag. For example:
+//
+//     logman start pm -p {70cb4ff1-1ca7-501d-ce34-9637916f7ab6} -o pm.etl -ets
+//     pathmatch ...
+//     logman stop pm -ets
+//
+// Elsewhere, or if PATHMATCH_NO_PROBES is defined, the probes expand to nothing.
+//
+// Provider "pathmatch" probes and their arguments:
+//
+//     dir__open      path, pathLength, opened     Directory opened for reading (opened: 0 or 1)
+//     dir__close     path, pathLength, entries    Directory read finished, with entries read
+//     entry__match   path, pathLength, component  Directory entry matched a pattern component
+//     entry__reject  path, pathLength, component  Directory entry failed a pattern component
+//     callback       path, pathLength, matches    Match callback about to be called, with the
+//                                                 number of matches reported so far
+//
+// Paths are null-terminated strings in the native std::filesystem encoding (UTF-8 char strings on
+// Linux, UTF-16 on Windows), with lengths in code units. ETW events carry the path and the last
+// argument, as fields named "path" and after the argument. An empty directory path is the current
+// directory. For the entry probes, 'component' is the index of the pattern component tested, or
+// -1 for the pattern that follows an ellipsis. Only entries read from a directory fire entry
+// probes; names looked up directly (plain and small alternation components) don't.
+//--------------------------------------------------------------------------------------------------
+
+#if !defined(PATHMATCH_NO_PROBES) && defined(_WIN32)
+    #include <windows.h>
+    #include <TraceLoggingProvider.h>
+    #define PATHMATCH_HAS_PROBES 1
+    #define PATHMATCH_ETW_PROBES 1
+
+    // Defined, and registered for the life of the process, in pathmatcher.cpp.
+    TRACELOGGING_DECLARE_PROVIDER(g_pathmatchProvider);
+
+#elif !defined(PATHMATCH_NO_PROBES) && defined(__has_include)
+    #if __has_include(<sys/sdt.h>)
+        #include <sys/sdt.h>
+        #define PATHMATCH_HAS_PROBES 1
+    #endif
+#endif
+
+#ifndef PATHMATCH_HAS_PROBES
+    #define PATHMATCH_HAS_PROBES 0
+#endif
+
+#ifndef PATHMATCH_ETW_PROBES
+    #define PATHMATCH_ETW_PROBES 0
+#endif
+
+#if PATHMATCH_ETW_PROBES
+    #define PATHMATCH_PROBE(name, field, a, b, c)                                  \
+        TraceLoggingWrite (g_pathmatchProvider, #name,                             \
+            TraceLoggingCountedWideString (                                        \
+                a, static_cast<USHORT>((b) < 0xFFFF ? (b) : 0xFFFF), "path"),      \
+            TraceLoggingInt64 (static_cast<INT64>(c), field))
+#elif PATHMATCH_HAS_PROBES
+    #define PATHMATCH_PROBE(name, field, a, b, c)  STAP_PROBE3(pathmatch, name, a, b, c)
+#else
+    #define PATHMATCH_PROBE(name, field, a, b, c)  ((void)0)
+#endif
+
+#define PATHMATCH_PROBE_DIR_OPEN(path, length, opened)  \
+    PATHMATCH_PROBE(dir__open, "opened", path, length, opened)
+
+#define PATHMATCH_PROBE_DIR_CLOSE(path, length, entries)  \
+    PATHMATCH_PROBE(dir__close, "entries", path, length, entries)
+
+#define PATHMATCH_PROBE_ENTRY_MATCH(name, length, component)  \
+    PATHMATCH_PROBE(entry__match, "component", name, length, component)
+
+#define PATHMATCH_PROBE_ENTRY_REJECT(name, length, component)  \
+    PATHMATCH_PROBE(entry__reject, "component", name, length, component)
+
+#define PATHMATCH_PROBE_CALLBACK(path, length, matches)  \
+    PATHMATCH_PROBE(callback, "matches", path, length, matches)
+
+
+#endif  // _INCLUDED_PATHMATCHPROBES_H
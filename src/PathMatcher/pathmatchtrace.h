@@ -0,0 +1,87 @@
+#ifndef _INCLUDED_PATHMATCHTRACE_H
+//==================================================================================================
+// pathmatchtrace.h
+//
+// Leveled diagnostic tracing for the PathMatcher library. Tracing is off by default, so library
+// calls have no I/O side effects unless a caller routes trace output to a stream.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATHMATCHTRACE_H
+
+
+#include <ostream>
+
+
+// The most detailed trace level compiled in (0 = Off, 1 = Info, 2 = Detail). Trace statements
+// above this level are discarded at compile time.
+#ifndef PATHMATCH_MAX_TRACE_LEVEL
+    #define PATHMATCH_MAX_TRACE_LEVEL 2
+#endif
+
+
+namespace PathMatch
+{
+
+enum class TraceLevel
+{
+    Off,      // No tracing
+    Info,     // Once per match: pattern normalization and compilation
+    Detail    // Once per directory read
+};
+
+
+namespace TraceState {
+    inline std::wostream* stream = nullptr;          // Trace destination (null: tracing off)
+    inline TraceLevel     level  = TraceLevel::Off;  // Most detailed level written
+}
+
+
+// Send trace output up to the given level to the given stream, or turn tracing off if the stream
+// is null or the level is Off. This is process-wide, and should be set before matching starts.
+inline void setTrace (std::wostream* stream, TraceLevel level = TraceLevel::Info)
+{
+    TraceState::level  = stream ? level : TraceLevel::Off;
+    TraceState::stream = (TraceState::level == TraceLevel::Off) ? nullptr : stream;
+}
+
+
+// Returns the trace stream if tracing is on at the given level, otherwise null. Trace statements
+// take the form
+//
+//     if (auto out = trace(TraceLevel::Info))
+//         *out << L"Something happened\n";
+//
+// so that when tracing is off, no trace message is ever formatted.
+inline std::wostream* trace (TraceLevel level)
+{
+    if (static_cast<int>(level) > PATHMATCH_MAX_TRACE_LEVEL)
+        return nullptr;
+
+    return (level <= TraceState::level) ? TraceState::stream : nullptr;
+}
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_PATHMATCHTRACE_H
@@ -0,0 +1,97 @@
+//==================================================================================================
+// patterncache.cpp
+//
+// Implementation of the PatternCache object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "patterncache.h"
+
+using namespace std;
+
+
+namespace PathMatch {
+
+PatternCache::PatternCache (size_t capacity)
+  : m_capacity(max<size_t>(capacity, 1))
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------
+shared_ptr<const MatchPlan> PatternCache::plan (const wstring& pattern)
+{
+    // Patterns are compiled outside the lock, so that one slow compile doesn't hold up lookups of
+    // other patterns. If two threads compile the same pattern at once, the first plan stored wins.
+
+    {
+        lock_guard lock (m_mutex);
+
+        auto found = m_index.find(pattern);
+        if (found != m_index.end()) {
+            ++m_stats.hits;
+            m_entries.splice(m_entries.begin(), m_entries, found->second);
+            return found->second->second;
+        }
+
+        ++m_stats.misses;
+    }
+
+    auto compiled = make_shared<const MatchPlan>(pattern);
+
+    lock_guard lock (m_mutex);
+
+    auto [found, inserted] = m_index.try_emplace(pattern);
+    if (!inserted)
+        return found->second->second;
+
+    m_entries.emplace_front(pattern, compiled);
+    found->second = m_entries.begin();
+
+    while (m_entries.size() > m_capacity) {
+        ++m_stats.evictions;
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+
+    return compiled;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+size_t PatternCache::size() const
+{
+    lock_guard lock (m_mutex);
+    return m_entries.size();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PatternCacheStats PatternCache::stats() const
+{
+    lock_guard lock (m_mutex);
+    return m_stats;
+}
+
+
+}; // Namespace PathMatch
@@ -0,0 +1,95 @@
+#ifndef _INCLUDED_PATTERNCACHE_H
+//==================================================================================================
+// patterncache.h
+//
+// Declarations for the PatternCache object, which keeps compiled match plans by pattern text, so
+// that patterns used again and again are compiled only once.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATTERNCACHE_H
+
+
+#include "pathmatcher.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace PathMatch
+{
+
+struct PatternCacheStats
+{
+    // Counters for the lookups made in a PatternCache.
+
+    uint64_t hits {0};        // Plans found in the cache
+    uint64_t misses {0};      // Plans that had to be compiled
+    uint64_t evictions {0};   // Plans dropped to stay within the capacity
+};
+
+
+class PatternCache
+{
+    //----------------------------------------------------------------------------------------------
+    // A PatternCache holds the MatchPlans compiled for recently used patterns, keyed by pattern
+    // text, and hands out shared references to them. The least recently used plans are dropped to
+    // keep the cache within its capacity; a dropped plan lives on while any match still uses it.
+    // A cache may be shared by any number of matchers and indexes, on any number of threads.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    static const size_t mc_DefaultCapacity = 256;
+
+    explicit PatternCache (size_t capacity = mc_DefaultCapacity);
+
+    // Returns the compiled plan for the given pattern, compiling it if it isn't cached.
+    std::shared_ptr<const MatchPlan> plan (const std::wstring& pattern);
+
+    // The number of plans held.
+    size_t size() const;
+
+    // The lookup counters accumulated since the cache was created.
+    PatternCacheStats stats() const;
+
+  private:
+
+    using Entry     = std::pair<std::wstring, std::shared_ptr<const MatchPlan>>;
+    using EntryList = std::list<Entry>;
+
+    mutable std::mutex m_mutex;        // Guards all members below
+    size_t             m_capacity;     // Maximum number of plans to hold
+    EntryList          m_entries;      // Plans, most recently used first
+    PatternCacheStats  m_stats;
+
+    std::unordered_map<std::wstring, EntryList::iterator> m_index;   // Entries by pattern
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_PATTERNCACHE_H
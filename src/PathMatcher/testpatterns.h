@@ -0,0 +1,90 @@
+#ifndef _INCLUDED_TESTPATTERNS_H
+//==================================================================================================
+// testpatterns.h
+//
+// The list of sample patterns shared by the PathMatcher unit tests and the pathmatch benchmarks.
+// Covers slash handling, parent and current directory collapsing, ellipsis forms, character
+// classes and brace groups.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_TESTPATTERNS_H
+
+
+#include <string>
+
+
+namespace PathMatchTest
+{
+    inline const std::wstring testPatterns[] {
+        L"",
+        L"/",
+        L"\\",
+        L"\\\\////\\\\\\",
+        L"a",
+        L"a\\",
+        L"a/",
+        L"a////",
+        L"/a",
+        L"/\\///\\\\\\a",
+        L"/a/",
+        L"/\\///\\\\\\a\\//\\\\",
+        L"\\a",
+        L"\\a\\",
+        L"a/b/c",
+        L"a/b/c/",
+        L"a/b\\c/d\\e\\f",
+        L"a/b\\c/d\\e\\f\\",
+        L"a//\\\\/b//c",
+        L"a//\\\\/b//c/",
+        L"a/b/c/../x/y/z",
+        L"a/b/c/../../x/y/z",
+        L"a/b/c/../../x/y/z/",
+        L"../../x/y/z",
+        L"a/b/../../../../x/y/z",
+        L"a/./b",
+        L"a/./b/./././c",
+        L"a/**/b/.../c/**",
+        L"a/**/b/.../c/**/",
+        L"a/**......****/b",
+        L"a/**......****/b/",
+        L"a.../b",
+        L"...b/c",
+        L"a...b",
+        L"a...b...c",
+        L"a...b...c/",
+        L"a/b*.../c",
+        L"a/b?.../c",
+        L"a/...b/c",
+        L"a/...*b/c",
+        L"a/...?b/c",
+        L"a/[*.]x/b",
+        L"a/[\\]/b",
+        L"a/{b/c,d}/e",
+        L"a/{b/../c,...}/e",
+        L"{a,b}/{c}/d",
+    };
+}
+
+
+#endif  // _INCLUDED_TESTPATTERNS_H
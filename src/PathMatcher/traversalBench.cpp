@@ -0,0 +1,237 @@
+//==================================================================================================
+// traversalBench.cpp
+//
+// End-to-end traversal benchmarks for PathMatcher::match. A synthetic tree is generated from a seed
+// (see treegen.h), and a fixed suite of patterns is run against it, reporting the latency to the
+// first result, the total scan time, and the number of I/O operations for each pattern.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include <pathmatcher.h>
+#include <treegen.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <windows.h>
+
+using namespace std;
+using namespace PathMatch;
+using namespace PathMatchTest;
+
+namespace fs = std::filesystem;
+
+
+// The pattern suite, relative to the tree root.
+static const wstring suitePatterns[] {
+    L"*",
+    L"*/*/*.h",
+    L".../*.cpp",
+    L".../[a-f]*.txt",
+    L"...*.{obj,md}",
+    L".../*x*/*.h",
+    L".../",
+    L"...",
+};
+
+
+struct RunState
+{
+    chrono::steady_clock::time_point start;        // Start of the match call
+    chrono::steady_clock::time_point firstResult;  // Time of the first callback
+    size_t                           results {0};  // Number of callbacks
+};
+
+
+struct RunResult
+{
+    double   firstResultMs;  // Latency to first result (the total time if there were no results)
+    double   totalMs;        // Total scan time
+    size_t   results;        // Number of matching entries
+    uint64_t ioOperations;   // I/O operations performed by the scan
+};
+
+
+//--------------------------------------------------------------------------------------------------
+uint64_t ioOperations()
+{
+    // Returns the number of I/O operations (reads, writes, and others, which include directory
+    // enumeration and attribute queries) performed by this process so far.
+
+    IO_COUNTERS counters;
+    if (!GetProcessIoCounters(GetCurrentProcess(), &counters))
+        return 0;
+
+    return counters.ReadOperationCount + counters.WriteOperationCount + counters.OtherOperationCount;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool countResult (const fs::path&, const fs::directory_entry&, void* userData)
+{
+    auto& state = *static_cast<RunState*>(userData);
+
+    if (state.results++ == 0)
+        state.firstResult = chrono::steady_clock::now();
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+RunResult runPattern (const wstring& pattern)
+{
+    PathMatcher matcher;
+    RunState state;
+
+    auto ioBefore = ioOperations();
+    state.start = chrono::steady_clock::now();
+
+    matcher.match(pattern, countResult, &state);
+
+    auto end = chrono::steady_clock::now();
+    auto ioAfter = ioOperations();
+
+    auto milliseconds = [&](chrono::steady_clock::time_point time) {
+        return chrono::duration<double, milli>(time - state.start).count();
+    };
+
+    return {
+        milliseconds(state.results ? state.firstResult : end),
+        milliseconds(end),
+        state.results,
+        ioAfter - ioBefore
+    };
+}
+
+
+//--------------------------------------------------------------------------------------------------
+template <typename Value>
+Value median (vector<RunResult>& runs, Value RunResult::* member)
+{
+    sort(runs.begin(), runs.end(), [member](const RunResult& a, const RunResult& b) {
+        return a.*member < b.*member;
+    });
+    return runs[runs.size() / 2].*member;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+    // Usage: traversalBench [--root <dir>] [--runs <n>] [--keep] [--seed <n>] [--depth <n>]
+    //                       [--fanout <n>] [--largeDirs <n>] [--largeDirSize <n>]
+    //
+    // If the root directory already exists, it's scanned as is (for example, a tree created earlier
+    // by treegen). Otherwise a tree is generated there, and removed afterward unless --keep is
+    // given.
+
+    TreeOptions options;
+    fs::path root;
+    int  runs = 5;
+    bool keep = false;
+
+    for (int i = 1;  i < argc;  ++i) {
+        auto option = argv[i];
+        auto value  = (i + 1 < argc) ? argv[i+1] : "";
+
+        if (0 == strcmp(option, "--keep")) {
+            keep = true;
+            continue;
+        }
+
+        ++i;
+
+        if (0 == strcmp(option, "--root"))
+            root = value;
+        else if (0 == strcmp(option, "--runs"))
+            runs = max(1, atoi(value));
+        else if (0 == strcmp(option, "--seed"))
+            options.seed = strtoull(value, nullptr, 10);
+        else if (0 == strcmp(option, "--depth"))
+            options.depth = atoi(value);
+        else if (0 == strcmp(option, "--fanout"))
+            options.fanout = atoi(value);
+        else if (0 == strcmp(option, "--largeDirs"))
+            options.largeDirs = atoi(value);
+        else if (0 == strcmp(option, "--largeDirSize"))
+            options.largeDirSize = atoi(value);
+        else {
+            cerr << "usage: traversalBench [--root <dir>] [--runs <n>] [--keep] [--seed <n>]"
+                    " [--depth <n>] [--fanout <n>] [--largeDirs <n>] [--largeDirSize <n>]\n";
+            return 1;
+        }
+    }
+
+    if (root.empty())
+        root = fs::temp_directory_path() / ("pathmatch-traversal-" + to_string(options.seed));
+
+    bool generated = false;
+
+    if (!fs::exists(root)) {
+        try {
+            auto stats = generateTree(root, options);
+            wcout << L"Generated " << stats.directories << L" directories and " << stats.files
+                  << L" files (" << describeTree(options) << L")\n";
+            generated = true;
+        } catch (const fs::filesystem_error& error) {
+            cerr << "traversalBench: " << error.what() << '\n';
+            return 1;
+        }
+    }
+
+    wcout << L"Tree: " << root.wstring() << L"\n\n";
+
+    wcout << left << setw(20) << L"Pattern" << right << setw(10) << L"results" << setw(14)
+          << L"first (ms)" << setw(14) << L"total (ms)" << setw(12) << L"I/O ops" << L'\n';
+
+    for (const auto& suffix : suitePatterns) {
+        auto pattern = root.generic_wstring() + L'/' + suffix;
+
+        vector<RunResult> results;
+        for (int run = 0;  run < runs;  ++run)
+            results.push_back(runPattern(pattern));
+
+        auto resultCount = results.front().results;
+
+        wcout << left << setw(20) << suffix << right << setw(10) << resultCount << fixed
+              << setprecision(3) << setw(14) << median(results, &RunResult::firstResultMs)
+              << setw(14) << median(results, &RunResult::totalMs)
+              << setw(12) << median(results, &RunResult::ioOperations) << L'\n';
+    }
+
+    if (generated && !keep) {
+        error_code errorCode;
+        fs::remove_all(root, errorCode);
+    }
+
+    return 0;
+}
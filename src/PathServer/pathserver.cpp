@@ -0,0 +1,702 @@
+//==================================================================================================
+// pathserver.cpp
+//
+// Implementation of the PathServer object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "pathserver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <afunix.h>
+    #include <windows.h>
+#else
+    #include <cstdlib>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+
+namespace PathMatch {
+
+namespace {
+
+    using Clock = chrono::steady_clock;
+
+    // Responses are sent in chunks of about this size.
+    const size_t c_sendBufferSize = 64 * 1024;
+
+    // Requests larger than this are refused, so that a client can't make the server hold an
+    // unbounded buffer.
+    const size_t c_maxRequestSize = 1024 * 1024;
+
+    // A client has this long to send its complete request, and each part of the response must be
+    // taken by the client within this long, or the connection is dropped. This keeps one stalled
+    // client from holding up the server.
+    const auto c_clientTimeout = chrono::seconds(5);
+
+    // The server checks for a stop request at least this often while waiting for connections.
+    const auto c_stopCheckInterval = chrono::milliseconds(250);
+
+    // When accepting a connection fails for lack of resources (such as file descriptors), the
+    // server waits before trying again, doubling the wait up to this limit.
+    const auto c_maxAcceptBackoff = chrono::milliseconds(1000);
+
+    // Set by the signal (or console control) handler when the server is asked to shut down.
+    volatile sig_atomic_t s_stopRequested = 0;
+
+    #ifdef _WIN32
+
+        using Socket = SOCKET;
+        const Socket c_noSocket = INVALID_SOCKET;
+
+        static_assert(is_same_v<SOCKET, uintptr_t>);
+
+        const int c_sendFlags = 0;
+        const int c_shutdownSend = SD_SEND;
+
+        int  socketError()                 { return WSAGetLastError(); }
+        bool isInterrupted (int error)     { return error == WSAEINTR; }
+        bool isWouldBlock (int error)      { return error == WSAEWOULDBLOCK; }
+        bool isConnectionLost (int error)  { return error == WSAECONNRESET; }
+        bool isOutOfResources (int error)  { return error == WSAEMFILE || error == WSAENOBUFS; }
+
+        void closeSocket (Socket socket)   { closesocket(socket); }
+
+        int pollSocket (pollfd* entry, int milliseconds)
+        {
+            return WSAPoll(entry, 1, milliseconds);
+        }
+
+        BOOL WINAPI requestStop (DWORD event)
+        {
+            if (event != CTRL_C_EVENT && event != CTRL_BREAK_EVENT)
+                return FALSE;
+            s_stopRequested = 1;
+            return TRUE;
+        }
+
+    #else
+
+        using Socket = int;
+        const Socket c_noSocket = -1;
+
+        const int c_sendFlags = MSG_NOSIGNAL;
+        const int c_shutdownSend = SHUT_WR;
+
+        int  socketError()                 { return errno; }
+        bool isInterrupted (int error)     { return error == EINTR; }
+        bool isWouldBlock (int error)      { return error == EAGAIN || error == EWOULDBLOCK; }
+        bool isConnectionLost (int error)  { return error == ECONNABORTED; }
+        bool isOutOfResources (int error)
+        {
+            return error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+        }
+
+        void closeSocket (Socket socket)   { ::close(socket); }
+
+        int pollSocket (pollfd* entry, int milliseconds)
+        {
+            return poll(entry, 1, milliseconds);
+        }
+
+        void requestStop (int)
+        {
+            s_stopRequested = 1;
+        }
+
+    #endif
+
+    class SocketLibrary
+    {
+        // Holds the socket library open for the lifetime of the object. Only Windows needs this.
+
+      public:
+
+        #ifdef _WIN32
+            SocketLibrary()  { WSADATA data;  m_ready = (WSAStartup(MAKEWORD(2, 2), &data) == 0); }
+            ~SocketLibrary() { if (m_ready) WSACleanup(); }
+        #else
+            SocketLibrary()  = default;
+        #endif
+
+        SocketLibrary (const SocketLibrary&) = delete;
+        SocketLibrary& operator= (const SocketLibrary&) = delete;
+
+        bool ready() const { return m_ready; }
+
+      private:
+
+        bool m_ready {true};
+    };
+
+    struct Connection
+    {
+        // The state of a query connection, for the match callback.
+
+        Socket socket {c_noSocket};
+        string buffer;          // Response text not yet sent
+        bool   failed {false};  // True once a send fails (the client went away)
+    };
+
+    //----------------------------------------------------------------------------------------------
+    Socket openSocket()
+    {
+        // Open a new stream socket in the Unix domain, not inherited by child processes.
+
+        #ifdef _WIN32
+            auto result = WSASocketW(AF_UNIX, SOCK_STREAM, 0, nullptr, 0, WSA_FLAG_NO_HANDLE_INHERIT);
+        #else
+            auto result = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        #endif
+
+        return result;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    Socket acceptSocket (Socket listener)
+    {
+        // Accept a connection on the listener, not inherited by child processes.
+
+        #ifdef _WIN32
+            auto result = accept(listener, nullptr, nullptr);
+            if (result != c_noSocket)
+                SetHandleInformation(reinterpret_cast<HANDLE>(result), HANDLE_FLAG_INHERIT, 0);
+        #else
+            auto result = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        #endif
+
+        return result;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool setNonBlocking (Socket socket)
+    {
+        // Make send and receive on the socket return at once rather than wait.
+
+        #ifdef _WIN32
+            u_long enable = 1;
+            return ioctlsocket(socket, FIONBIO, &enable) == 0;
+        #else
+            auto flags = fcntl(socket, F_GETFL);
+            return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+        #endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool waitFor (Socket socket, short events, Clock::time_point deadline)
+    {
+        // Wait until the socket is ready for the given poll events. Returns false if the deadline
+        // passes first, or the wait fails.
+
+        pollfd entry {};
+        entry.fd     = socket;
+        entry.events = events;
+
+        for (;;) {
+            auto remaining = chrono::ceil<chrono::milliseconds>(deadline - Clock::now()).count();
+            if (remaining <= 0)
+                return false;
+
+            auto result = pollSocket(&entry, static_cast<int>(remaining));
+            if (result > 0)
+                return true;
+            if (result == 0 || !isInterrupted(socketError()))
+                return false;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool sendAll (Socket socket, string_view data, bool timed = false)
+    {
+        // Send all of the data. Returns false if the connection fails. If timed (which requires a
+        // non-blocking socket), also fails if the peer takes no data for longer than
+        // c_clientTimeout.
+
+        while (!data.empty()) {
+            auto size = static_cast<int>(min<size_t>(data.size(), INT_MAX));
+            auto sent = send(socket, data.data(), size, c_sendFlags);
+
+            if (sent < 0 && timed && isWouldBlock(socketError())) {
+                if (!waitFor(socket, POLLOUT, Clock::now() + c_clientTimeout))
+                    return false;
+                continue;
+            }
+
+            if (sent <= 0)
+                return false;
+            data.remove_prefix(static_cast<size_t>(sent));
+        }
+
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool socketAddress (const fs::path& socketPath, sockaddr_un& address, wstring& error)
+    {
+        // Fill in the socket address for the given path. Returns false if the path is too long, or
+        // can't be represented in the narrow character set.
+
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+
+        string native;
+        try {
+            native = socketPath.string();
+        } catch (const exception&) {
+            error = L"Socket path '" + socketPath.wstring() + L"' has unsupported characters";
+            return false;
+        }
+
+        if (native.empty() || native.size() >= sizeof(address.sun_path)) {
+            error = L"Socket path '" + socketPath.wstring() + L"' is empty or too long";
+            return false;
+        }
+
+        memcpy(address.sun_path, native.c_str(), native.size());
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool isSocketFile (const fs::path& path)
+    {
+        // True if the path names a Unix domain socket in the file system. On Windows, a socket is
+        // a reparse point with its own tag, which the standard library doesn't report.
+
+        #ifdef _WIN32
+            WIN32_FIND_DATAW findData;
+            auto handle = FindFirstFileW(path.c_str(), &findData);
+            if (handle == INVALID_HANDLE_VALUE)
+                return false;
+            FindClose(handle);
+
+            return (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+                && findData.dwReserved0 == IO_REPARSE_TAG_AF_UNIX;
+        #else
+            error_code errorCode;
+            return fs::is_socket(path, errorCode);
+        #endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    bool makePrivateDirectory (fs::path& directory)
+    {
+        // Create a new, uniquely named temporary directory that only this user can reach, so that
+        // no other process can predict, replace or read its contents. Returns false on failure.
+
+        error_code errorCode;
+        auto temp = fs::temp_directory_path(errorCode);
+        if (errorCode)
+            return false;
+
+        #ifdef _WIN32
+            // The temporary directory is under the user's profile, which other (non-administrator)
+            // users can't reach, so a new directory with an unpredictable name is private.
+
+            random_device random;
+
+            for (int attempt = 0;  attempt < 100;  ++attempt) {
+                auto name = L"pathserver-" + to_wstring(random()) + L"-" + to_wstring(random());
+                if (fs::create_directory(temp / name, errorCode)) {
+                    directory = temp / name;
+                    return true;
+                }
+            }
+
+            return false;
+        #else
+            auto name = (temp / "pathserver-XXXXXX").string();
+            if (!mkdtemp(name.data()))
+                return false;
+
+            directory = name;
+            return true;
+        #endif
+    }
+
+    //----------------------------------------------------------------------------------------------
+    void handleStopRequests()
+    {
+        // Stop serving on an interrupt or termination request, so that the socket and snapshot are
+        // cleaned up.
+
+        #ifdef _WIN32
+            SetConsoleCtrlHandler(requestStop, TRUE);
+        #else
+            // The handler doesn't restart system calls, so a waiting poll() returns at once.
+
+            struct sigaction action {};
+            action.sa_handler = requestStop;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGINT,  &action, nullptr);
+            sigaction(SIGTERM, &action, nullptr);
+            sigaction(SIGHUP,  &action, nullptr);
+        #endif
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PathServer::PathServer (const fs::path& socketPath)
+  : m_socketPath(socketPath),
+    m_listener(c_noSocket)
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------
+PathServer::~PathServer()
+{
+    stopListening();
+
+    error_code errorCode;
+
+    if (!m_snapshotDirectory.empty())
+        fs::remove_all(m_snapshotDirectory, errorCode);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathServer::run (wstring& error)
+{
+    SocketLibrary library;
+
+    if (!library.ready()) {
+        error = L"Unable to start the socket library";
+        return false;
+    }
+
+    // The snapshot is kept out of the served tree, so that refreshing it doesn't count as a change
+    // to the tree.
+
+    if (!makePrivateDirectory(m_snapshotDirectory)) {
+        error = L"Unable to create a private directory for the tree snapshot";
+        return false;
+    }
+
+    m_indexFile = m_snapshotDirectory / "tree.pmi";
+
+    if (!PathIndex::build(L"", m_indexFile, false, error) || !loadSnapshot(error))
+        return false;
+
+    sockaddr_un address;
+    if (!socketAddress(m_socketPath, address, error))
+        return false;
+
+    // Remove a socket left behind by a server that didn't shut down cleanly.
+
+    error_code errorCode;
+
+    if (isSocketFile(m_socketPath))
+        fs::remove(m_socketPath, errorCode);
+
+    m_listener = openSocket();
+
+    if (m_listener == c_noSocket
+        || bind(m_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || listen(m_listener, SOMAXCONN) != 0) {
+        error = L"Unable to listen on socket '" + m_socketPath.wstring() + L"'";
+        if (m_listener != c_noSocket) {
+            closeSocket(m_listener);
+            m_listener = c_noSocket;
+        }
+        return false;
+    }
+
+    handleStopRequests();
+
+    auto backoff = chrono::milliseconds(0);
+
+    while (!s_stopRequested) {
+        if (!waitFor(m_listener, POLLIN, Clock::now() + c_stopCheckInterval))
+            continue;
+
+        auto client = acceptSocket(m_listener);
+
+        if (client == c_noSocket) {
+            // A connection that went away before it was accepted, or an interrupted wait, is
+            // skipped. Running out of resources is waited out, backing off so as not to spin.
+            // Anything else means the listener itself has failed.
+
+            auto acceptError = socketError();
+
+            if (isInterrupted(acceptError) || isConnectionLost(acceptError) || isWouldBlock(acceptError))
+                continue;
+
+            if (!isOutOfResources(acceptError)) {
+                error = L"Unable to accept connections on socket '" + m_socketPath.wstring() + L"'";
+                stopListening();
+                return false;
+            }
+
+            backoff = clamp(backoff * 2, chrono::milliseconds(10), c_maxAcceptBackoff);
+            this_thread::sleep_for(backoff);
+            continue;
+        }
+
+        backoff = chrono::milliseconds(0);
+
+        if (!setNonBlocking(client)) {
+            closeSocket(client);
+            continue;
+        }
+
+        // Bring the snapshot up to date before answering, if anything has changed.
+
+        if (m_watcher.wait(0)) {
+            wstring refreshError;
+            if (!PathIndex::refresh(m_indexFile, refreshError) || !loadSnapshot(refreshError)) {
+                sendAll(client, "E " + toUtf8(refreshError) + "\n", true);
+                closeSocket(client);
+                continue;
+            }
+        }
+
+        answer(client);
+        closeSocket(client);
+    }
+
+    stopListening();
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PathServer::stopListening()
+{
+    // Close the listening socket and remove it from the file system. This is done before the
+    // socket library is released at the end of run().
+
+    if (m_listener == c_noSocket)
+        return;
+
+    closeSocket(m_listener);
+    m_listener = c_noSocket;
+
+    error_code errorCode;
+    fs::remove(m_socketPath, errorCode);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathServer::loadSnapshot (wstring& error)
+{
+    // Open the snapshot index, and watch every directory in it.
+
+    if (!m_index.open(m_indexFile, error))
+        return false;
+
+    set<fs::path> directories { fs::path(L".") };
+    m_index.match(L".../", &collectDirectory, &directories);
+    m_watcher.setDirectories(directories);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PathServer::answer (SocketHandle client)
+{
+    // Read the request patterns, then send the matches for each. The whole request must arrive
+    // within c_clientTimeout, and be no larger than c_maxRequestSize.
+
+    string request;
+    char   buffer [4096];
+    auto   deadline = Clock::now() + c_clientTimeout;
+
+    for (;;) {
+        if (!waitFor(client, POLLIN, deadline)) {
+            sendAll(client, "E Timed out waiting for the query\n", true);
+            return;
+        }
+
+        auto received = recv(client, buffer, static_cast<int>(sizeof(buffer)), 0);
+        if (received < 0 && (isWouldBlock(socketError()) || isInterrupted(socketError())))
+            continue;
+        if (received < 0)
+            return;
+        if (received == 0)
+            break;
+
+        if (request.size() + static_cast<size_t>(received) > c_maxRequestSize) {
+            sendAll(client, "E Query is too large\n", true);
+            return;
+        }
+
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    Connection connection;
+    connection.socket = client;
+
+    for (size_t start = 0;  start < request.size() && !connection.failed;  ) {
+        auto end = request.find('\n', start);
+        if (end == string::npos)
+            end = request.size();
+
+        auto line = string_view(request).substr(start, end - start);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        start = end + 1;
+
+        wstring pattern;
+        appendUtf8(pattern, line);
+
+        if (!pattern.empty())
+            m_index.match(*m_patterns.plan(pattern), &sendMatch, &connection);
+    }
+
+    if (!connection.failed)
+        sendAll(client, connection.buffer, true);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathServer::collectDirectory (const wstring& path, bool isDirectory, void* userData)
+{
+    if (isDirectory)
+        static_cast<set<fs::path>*>(userData)->insert(path);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathServer::sendMatch (const wstring& path, bool isDirectory, void* userData)
+{
+    auto& connection = *static_cast<Connection*>(userData);
+
+    connection.buffer += isDirectory ? "D " : "F ";
+    connection.buffer += toUtf8(path);
+    connection.buffer += '\n';
+
+    if (connection.buffer.size() >= c_sendBufferSize) {
+        connection.failed = !sendAll(connection.socket, connection.buffer, true);
+        connection.buffer.clear();
+    }
+
+    return !connection.failed;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathServer::query (
+    const fs::path&           socketPath,
+    const vector<wstring>&    patterns,
+    PathIndex::MatchCallback* callback,
+    void*                     userData,
+    wstring&                  error)
+{
+    SocketLibrary library;
+
+    if (!library.ready()) {
+        error = L"Unable to start the socket library";
+        return false;
+    }
+
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address, error))
+        return false;
+
+    auto server = openSocket();
+
+    if (server == c_noSocket
+        || connect(server, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        error = L"Unable to connect to server at '" + socketPath.wstring() + L"'";
+        if (server != c_noSocket)
+            closeSocket(server);
+        return false;
+    }
+
+    string request;
+    for (const auto& pattern : patterns)
+        request += toUtf8(pattern) + '\n';
+
+    if (!sendAll(server, request) || shutdown(server, c_shutdownSend) != 0) {
+        error = L"Unable to send query to server at '" + socketPath.wstring() + L"'";
+        closeSocket(server);
+        return false;
+    }
+
+    // Report each complete response line as it arrives.
+
+    string  response;
+    wstring path;
+    char    buffer [64 * 1024];
+    bool    halted = false;
+
+    while (!halted) {
+        auto received = recv(server, buffer, static_cast<int>(sizeof(buffer)), 0);
+        if (received <= 0)
+            break;
+
+        response.append(buffer, static_cast<size_t>(received));
+
+        size_t start = 0;
+        for (size_t end;  !halted && (end = response.find('\n', start)) != string::npos;  start = end + 1) {
+            auto line = string_view(response).substr(start, end - start);
+
+            if (line.size() < 2)
+                continue;
+
+            path.clear();
+            appendUtf8(path, line.substr(2));
+
+            if (line[0] == 'E') {
+                error = path;
+                closeSocket(server);
+                return false;
+            }
+
+            halted = !callback(path, line[0] == 'D', userData);
+        }
+
+        response.erase(0, start);
+    }
+
+    closeSocket(server);
+    return true;
+}
+
+
+}; // Namespace PathMatch
@@ -0,0 +1,120 @@
+#ifndef _INCLUDED_PATHSERVER_H
+//==================================================================================================
+// pathserver.h
+//
+// Declarations for the PathServer object, a long-running process that answers pattern queries
+// over a local socket from an in-memory snapshot of a directory tree.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATHSERVER_H
+
+
+#include "directorywatcher.h"
+#include "pathindex.h"
+#include "patterncache.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+class PathServer
+{
+    //----------------------------------------------------------------------------------------------
+    // A PathServer answers pattern queries for the tree under the current directory, so that
+    // clients get the results pathmatch would report from that directory without walking the file
+    // system themselves. The server's snapshot of the tree is a PathIndex, memory mapped and kept
+    // fresh: every directory in it is watched, and if any has changed when a query arrives, the
+    // index is refreshed first (re-reading only the changed directories).
+    //
+    // Clients connect to a Unix domain socket (AF_UNIX, which Windows supports from Windows 10
+    // version 1803). A request is a list of patterns in UTF-8, one per
+    // line, ended by the client shutting down its side of the connection. The response has one
+    // line per match, "D <path>" for directories and "F <path>" for other entries, or a single
+    // "E <message>" line if the query failed. The server closes the connection when it's done.
+    //
+    // Connections are answered one at a time, so each has a deadline: a client that doesn't finish
+    // sending its request within a few seconds, or stops taking the response for that long, is
+    // dropped. Requests larger than a fixed limit are refused.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    // Prepare to serve on the given socket path.
+    explicit PathServer (const std::filesystem::path& socketPath);
+    ~PathServer();
+
+    PathServer (const PathServer&) = delete;
+    PathServer& operator= (const PathServer&) = delete;
+
+    // Build the snapshot, and serve queries one connection at a time, each under a deadline.
+    // Returns false (with a description in 'error') if the snapshot can't be built or the socket
+    // can't be opened, or if accepting connections fails for a reason other than running short of
+    // resources; otherwise runs until interrupted (SIGINT, SIGTERM or SIGHUP, or Ctrl+C or
+    // Ctrl+Break on Windows), and returns true. The snapshot is kept in a private temporary directory, removed when the server is
+    // destroyed.
+    bool run (std::wstring& error);
+
+    // Send the patterns to the server listening on the given socket, and report each match to the
+    // callback. Returns false (with a description in 'error') if the server can't be reached or
+    // reports an error.
+    static bool query (
+        const std::filesystem::path&     socketPath,
+        const std::vector<std::wstring>& patterns,
+        PathIndex::MatchCallback*        callback,
+        void*                            userData,
+        std::wstring&                    error);
+
+  private:
+
+    #ifdef _WIN32
+        using SocketHandle = std::uintptr_t;   // SOCKET
+    #else
+        using SocketHandle = int;
+    #endif
+
+    bool loadSnapshot (std::wstring& error);
+    void stopListening();
+    void answer (SocketHandle client);
+
+    static bool collectDirectory (const std::wstring& path, bool isDirectory, void* userData);
+    static bool sendMatch (const std::wstring& path, bool isDirectory, void* userData);
+
+    std::filesystem::path m_socketPath;        // Listening socket
+    std::filesystem::path m_snapshotDirectory; // Private directory holding the tree snapshot
+    std::filesystem::path m_indexFile;         // Tree snapshot
+    PathIndex             m_index;             // Opened tree snapshot
+    DirectoryWatcher      m_watcher;           // Watches every directory in the snapshot
+    PatternCache          m_patterns;          // Compiled query patterns
+    SocketHandle          m_listener;          // Listening socket (invalid if not listening)
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_PATHSERVER_H
@@ -0,0 +1,440 @@
+//==================================================================================================
+// directorywatcher.cpp
+//
+// Implementation of the DirectoryWatcher object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "directorywatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#elif defined(_WIN32)
+    #include <windows.h>
+#endif
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+
+namespace PathMatch {
+
+namespace {
+
+    // Polled directories are checked this often.
+    const auto c_pollInterval = chrono::milliseconds(250);
+
+    #ifdef __linux__
+        // Events that can add or remove directory entries, or the directory itself.
+        const uint32_t c_watchEvents = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                     | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    #elif defined(_WIN32)
+        // Changes that can add or remove directory entries.
+        const DWORD c_notifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
+    #endif
+}
+
+
+#ifdef _WIN32
+
+struct DirectoryWatcher::Watch
+{
+    // The outstanding change read of a watched directory. The change records themselves aren't
+    // needed, so the buffer is small; a burst that overflows it still completes the read.
+
+    HANDLE         directory {INVALID_HANDLE_VALUE};
+    OVERLAPPED     overlapped {};
+    std::uintptr_t key {0};                 // Completion key
+    bool           pending {false};         // True while a read is outstanding
+    alignas(DWORD) char buffer [1024];
+
+    bool read()
+    {
+        pending = ReadDirectoryChangesW (
+            directory, buffer, sizeof(buffer), FALSE, c_notifyFilter, nullptr, &overlapped, nullptr);
+        return pending;
+    }
+};
+
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryWatcher::DirectoryWatcher()
+{
+    #ifdef __linux__
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    #elif defined(_WIN32)
+        m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryWatcher::~DirectoryWatcher()
+{
+    #ifdef __linux__
+        if (m_fd >= 0)
+            ::close(m_fd);
+    #elif defined(_WIN32)
+        for (auto watch = m_watches.begin();  watch != m_watches.end();  )
+            watch = unwatch(watch);
+
+        if (m_port)
+            CloseHandle(m_port);
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+size_t DirectoryWatcher::setDirectories (const set<fs::path>& directories)
+{
+    #if defined(__linux__) || defined(_WIN32)
+        for (auto watch = m_watches.begin();  watch != m_watches.end();  ) {
+            if (directories.count(watch->first))
+                ++watch;
+            else
+                watch = unwatch(watch);
+        }
+    #endif
+
+    for (auto entry = m_times.begin();  entry != m_times.end();  ) {
+        if (directories.count(entry->first))
+            ++entry;
+        else
+            entry = m_times.erase(entry);
+    }
+
+    error_code errorCode;
+    size_t     added = 0;
+
+    for (const auto& directory : directories) {
+        if (m_times.count(directory))
+            continue;
+
+        #if defined(__linux__) || defined(_WIN32)
+            // Use notification where possible. If the directory can't be watched (for example,
+            // when the per-user inotify watch limit has been reached), fall back to polling it.
+
+            if (m_watches.count(directory))
+                continue;
+
+            if (watch(directory)) {
+                ++added;
+                continue;
+            }
+        #endif
+
+        auto time = fs::last_write_time(directory, errorCode);
+        if (!errorCode) {
+            m_times[directory] = time;
+            ++added;
+        }
+    }
+
+    return added;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+size_t DirectoryWatcher::size() const
+{
+    #if defined(__linux__) || defined(_WIN32)
+        return m_watches.size() + m_times.size();
+    #else
+        return m_times.size();
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+size_t DirectoryWatcher::polled() const
+{
+    return m_times.size();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryWatcher::wait (int timeoutMilliseconds)
+{
+    // Wait until a notified directory has a change, or a polled directory's modification time
+    // changes, or the time runs out. A polled directory that can no longer be read counts as
+    // changed. Which directory changed doesn't matter to the caller, so notifications are used
+    // only to keep track of which directories are still watched.
+
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMilliseconds);
+
+    for (;;) {
+        bool changed = false;
+
+        #if defined(__linux__) || defined(_WIN32)
+            changed = takeNotifications(0);
+        #endif
+
+        error_code errorCode;
+
+        for (auto& entry : m_times) {
+            auto time = fs::last_write_time(entry.first, errorCode);
+            if (errorCode || time != entry.second) {
+                entry.second = errorCode ? fs::file_time_type::min() : time;
+                changed = true;
+            }
+        }
+
+        if (changed)
+            return true;
+
+        auto now = chrono::steady_clock::now();
+        if (timeoutMilliseconds >= 0 && now >= deadline)
+            return false;
+
+        // Sleep until the next poll of the polled directories, or until the deadline if there are
+        // none. Notified directories wake the wait early.
+
+        auto pause = chrono::steady_clock::duration(c_pollInterval);
+        if (timeoutMilliseconds >= 0)
+            pause = min(pause, deadline - now);
+
+        #if defined(__linux__) || defined(_WIN32)
+            #ifdef __linux__
+                bool notified = m_fd >= 0;
+            #else
+                bool notified = m_port != nullptr;
+            #endif
+
+            if (notified) {
+                auto milliseconds = chrono::ceil<chrono::milliseconds>(pause).count();
+                if (m_times.empty() && timeoutMilliseconds < 0)
+                    milliseconds = -1;
+
+                if (takeNotifications(static_cast<int>(milliseconds)))
+                    return true;
+                continue;
+            }
+        #endif
+
+        this_thread::sleep_for(pause);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryWatcher::isNotified()
+{
+    #if defined(__linux__) || defined(_WIN32)
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+
+#ifdef __linux__
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryWatcher::watch (const fs::path& directory)
+{
+    // Start watching the directory with inotify. Returns false if it can't be watched.
+
+    if (m_fd < 0)
+        return false;
+
+    auto descriptor = inotify_add_watch(m_fd, directory.c_str(), c_watchEvents);
+    if (descriptor < 0)
+        return false;
+
+    m_watches[directory] = descriptor;
+    m_paths[descriptor]  = directory;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryWatcher::WatchMap::iterator DirectoryWatcher::unwatch (WatchMap::iterator watch)
+{
+    // Stop watching a directory. Returns the next watch.
+
+    inotify_rm_watch(m_fd, watch->second);
+    m_paths.erase(watch->second);
+    return m_watches.erase(watch);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryWatcher::takeNotifications (int timeoutMilliseconds)
+{
+    // Wait up to the given time (indefinitely if negative) for inotify events, then consume all
+    // pending events. Returns true if there were any.
+    //
+    // A watch that inotify has dropped (because its directory was deleted, or is on a file system
+    // that was unmounted) is forgotten. A directory moved away is no longer at its watched path,
+    // so its watch is removed. Either way, a directory later created at the path gets watched by
+    // the next call to setDirectories().
+
+    if (m_fd < 0)
+        return false;
+
+    if (timeoutMilliseconds != 0) {
+        pollfd request { m_fd, POLLIN, 0 };
+        if (poll(&request, 1, timeoutMilliseconds) <= 0)
+            return false;
+    }
+
+    alignas(inotify_event) char buffer [16 * 1024];
+    bool changed = false;
+    ssize_t size;
+
+    while ((size = read(m_fd, buffer, sizeof(buffer))) > 0) {
+        changed = true;
+
+        for (auto next = buffer;  next < buffer + size;  ) {
+            auto event = reinterpret_cast<const inotify_event*>(next);
+            next += sizeof(inotify_event) + event->len;
+
+            if (!(event->mask & (IN_IGNORED | IN_MOVE_SELF)))
+                continue;
+
+            auto path = m_paths.find(event->wd);
+            if (path == m_paths.end())
+                continue;
+
+            auto watch = m_watches.find(path->second);
+
+            if (event->mask & IN_IGNORED) {
+                m_watches.erase(watch);
+                m_paths.erase(path);
+            } else {
+                unwatch(watch);
+            }
+        }
+    }
+
+    return changed;
+}
+
+#elif defined(_WIN32)
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryWatcher::watch (const fs::path& directory)
+{
+    // Start watching the directory with a change read completing to the watcher's port. The
+    // directory is opened with full sharing, so that watching it doesn't keep it from being
+    // deleted or renamed. Returns false if it can't be watched.
+
+    if (!m_port)
+        return false;
+
+    auto handle = CreateFileW (
+        directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    auto watch = make_unique<Watch>();
+    watch->directory = handle;
+    watch->key       = m_nextKey++;
+
+    if (!CreateIoCompletionPort(handle, m_port, watch->key, 0) || !watch->read()) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    m_paths[watch->key] = directory;
+    m_watches[directory] = std::move(watch);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+DirectoryWatcher::WatchMap::iterator DirectoryWatcher::unwatch (WatchMap::iterator watch)
+{
+    // Stop watching a directory. Returns the next watch. An outstanding read is cancelled, and
+    // waited for so that its buffer can be released. Its completion is still queued to the port,
+    // but the key is no longer known, so it's ignored.
+
+    auto& state = *watch->second;
+
+    if (state.pending) {
+        DWORD bytes;
+        CancelIoEx(state.directory, &state.overlapped);
+        GetOverlappedResult(state.directory, &state.overlapped, &bytes, TRUE);
+    }
+
+    CloseHandle(state.directory);
+    m_paths.erase(state.key);
+    return m_watches.erase(watch);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool DirectoryWatcher::takeNotifications (int timeoutMilliseconds)
+{
+    // Wait up to the given time (indefinitely if negative) for a change read to complete, then
+    // consume all completed reads, starting a new read for each. Returns true if there were any.
+    //
+    // A read that fails, or that can't be restarted (as when the directory has been deleted), ends
+    // the directory's watch, so that a directory later created at the path gets watched by the
+    // next call to setDirectories().
+
+    if (!m_port)
+        return false;
+
+    bool  changed = false;
+    DWORD timeout = timeoutMilliseconds < 0 ? INFINITE : static_cast<DWORD>(timeoutMilliseconds);
+
+    for (;;  timeout = 0) {
+        DWORD       bytes;
+        ULONG_PTR   key;
+        OVERLAPPED* overlapped = nullptr;
+
+        auto succeeded = GetQueuedCompletionStatus(m_port, &bytes, &key, &overlapped, timeout);
+        if (!overlapped)
+            return changed;     // Nothing more has completed.
+
+        auto path = m_paths.find(key);
+        if (path == m_paths.end())
+            continue;           // A cancelled read
+
+        changed = true;
+
+        auto watch = m_watches.find(path->second);
+        watch->second->pending = false;
+
+        if (!succeeded || !watch->second->read())
+            unwatch(watch);
+    }
+}
+
+#endif
+
+
+}; // Namespace PathMatch
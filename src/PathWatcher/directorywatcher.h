@@ -0,0 +1,114 @@
+#ifndef _INCLUDED_DIRECTORYWATCHER_H
+//==================================================================================================
+// directorywatcher.h
+//
+// Declarations for the DirectoryWatcher object, which waits for entries to be added to or removed
+// from a set of directories.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_DIRECTORYWATCHER_H
+
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+
+
+namespace PathMatch
+{
+
+class DirectoryWatcher
+{
+    //----------------------------------------------------------------------------------------------
+    // A DirectoryWatcher watches a set of directories for entries being created, deleted or renamed.
+    // On Linux, changes are delivered by inotify, and on Windows by ReadDirectoryChangesW. Elsewhere,
+    // the watcher polls the modification time of each watched directory, which changes whenever an
+    // entry is added or removed. Directories that can't be watched by notification (such as when
+    // the Linux per-user watch limit is reached) are polled in the same way.
+    //
+    // A directory that is deleted or moved away stops being watched, so that if it's recreated,
+    // the next call to setDirectories() watches the new directory.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    DirectoryWatcher();
+    ~DirectoryWatcher();
+
+    DirectoryWatcher (const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator= (const DirectoryWatcher&) = delete;
+
+    // Watch exactly the given directories: start watching new ones, and stop watching those no
+    // longer in the set. Directories that can't be watched (such as those that no longer exist)
+    // are skipped. Returns the number of directories newly watched.
+    size_t setDirectories (const std::set<std::filesystem::path>& directories);
+
+    // The number of directories being watched.
+    size_t size() const;
+
+    // The number of watched directories whose changes are found by polling.
+    size_t polled() const;
+
+    // Wait up to the given time for a change to any watched directory. Returns true if there was
+    // a change. A negative time waits indefinitely. All pending changes are consumed, so that one
+    // call covers a burst of changes.
+    bool wait (int timeoutMilliseconds);
+
+    // True if changes are normally delivered by the operating system, rather than found by polling.
+    static bool isNotified();
+
+  private:
+
+    #ifdef __linux__
+        using WatchMap = std::map<std::filesystem::path, int>;
+
+        int      m_fd {-1};                               // inotify instance
+        WatchMap m_watches;                               // Watch descriptor of each directory
+        std::map<int, std::filesystem::path> m_paths;     // Directory of each watch descriptor
+    #elif defined(_WIN32)
+        struct Watch;
+        using WatchMap = std::map<std::filesystem::path, std::unique_ptr<Watch>>;
+
+        void*     m_port {nullptr};                       // I/O completion port for all watches
+        WatchMap  m_watches;                              // Change read of each directory
+        std::map<std::uintptr_t, std::filesystem::path> m_paths;   // Directory of each watch key
+        std::uintptr_t m_nextKey {1};                     // Completion key of the next watch
+    #endif
+
+    #if defined(__linux__) || defined(_WIN32)
+        bool watch (const std::filesystem::path& directory);
+        WatchMap::iterator unwatch (WatchMap::iterator watch);
+        bool takeNotifications (int timeoutMilliseconds);
+    #endif
+
+    std::map<std::filesystem::path, std::filesystem::file_time_type> m_times;
+                                                          // Last seen time of each polled directory
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_DIRECTORYWATCHER_H
@@ -0,0 +1,124 @@
+//==================================================================================================
+// pathwatcher.cpp
+//
+// Implementation of the PathWatcher object.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "pathwatcher.h"
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+
+namespace PathMatch {
+
+PathWatcher::PathWatcher (const vector<wstring>& patterns)
+  : m_patterns(patterns)
+{
+    m_matcher.setDirectoryCache(&m_cache);
+    m_matcher.setDirectoryCallback(&directoryCallback, this);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathWatcher::start (ChangeCallback* callback, void* userData)
+{
+    m_matches.clear();
+    return rematch(callback, userData, false);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathWatcher::update (int timeoutMilliseconds, ChangeCallback* callback, void* userData)
+{
+    if (!m_watcher.wait(timeoutMilliseconds))
+        return true;
+
+    // Let a burst of changes settle (within reason) before matching again.
+
+    for (int settle = 0;  settle < 20 && m_watcher.wait(mc_SettleMilliseconds);  ++settle)
+        continue;
+
+    return rematch(callback, userData, true);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathWatcher::rematch (ChangeCallback* callback, void* userData, bool recheck)
+{
+    // Match every pattern, report the differences from the previous matches, and watch the
+    // directories the new matches depend on. If 'recheck' is true, then entries may have been
+    // created in newly reached directories before they were watched, so if any were added, match
+    // once more.
+
+    for (int pass = 0;  pass < 2;  ++pass, recheck = false) {
+        m_newMatches.clear();
+        m_directories.clear();
+
+        for (const auto& pattern : m_patterns) {
+            m_matcher.match(pattern, &matchCallback, this);
+            m_stats += m_matcher.stats();
+        }
+
+        for (const auto& match : m_matches) {
+            if (!m_newMatches.count(match.first) && !callback(match.first, match.second, false, userData))
+                return false;
+        }
+
+        for (const auto& match : m_newMatches) {
+            if (!m_matches.count(match.first) && !callback(match.first, match.second, true, userData))
+                return false;
+        }
+
+        m_matches.swap(m_newMatches);
+
+        if (m_watcher.setDirectories(m_directories) == 0 || !recheck)
+            break;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool PathWatcher::matchCallback (const fs::path& path, const fs::directory_entry& dirEntry, void* userData)
+{
+    auto& watcher = *static_cast<PathWatcher*>(userData);
+
+    error_code errorCode;
+    watcher.m_newMatches[path.wstring()] = dirEntry.is_directory(errorCode);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void PathWatcher::directoryCallback (const fs::path& directory, void* userData)
+{
+    static_cast<PathWatcher*>(userData)->m_directories.insert(directory);
+}
+
+
+}; // Namespace PathMatch
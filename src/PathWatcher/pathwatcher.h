@@ -0,0 +1,109 @@
+#ifndef _INCLUDED_PATHWATCHER_H
+//==================================================================================================
+// pathwatcher.h
+//
+// Declarations for the PathWatcher object, which keeps the set of entries matching a set of
+// patterns up to date as the file system changes.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_PATHWATCHER_H
+
+
+#include "directorywatcher.h"
+#include "pathmatcher.h"
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace PathMatch
+{
+
+class PathWatcher
+{
+    //----------------------------------------------------------------------------------------------
+    // A PathWatcher matches a set of patterns, and then watches only the directories that the
+    // matches depend on: those that PathMatcher enumerated or looked up names in. When any of them
+    // changes, the patterns are matched again, and the entries that were added to or removed from
+    // the set of matches are reported. The watched directories are updated to follow each match.
+    //
+    // Matches read directories through a DirectoryCache owned by the watcher, so matching again
+    // re-reads only the directories that have changed since they were last read.
+    //----------------------------------------------------------------------------------------------
+
+  public:
+
+    // The callback function signature used to report changes to the set of matching entries.
+    // The callback returns false to stop watching.
+    using ChangeCallback = bool (const std::wstring& path, bool isDirectory, bool added, void* userData);
+
+    explicit PathWatcher (const std::vector<std::wstring>& patterns);
+
+    // Match the patterns, and report every matching entry as added. Returns false if the callback
+    // stopped watching.
+    bool start (ChangeCallback* callback, void* userData);
+
+    // Wait up to the given time (indefinitely if negative) for a watched directory to change. If
+    // one does, match the patterns again and report the differences. Returns false if the
+    // callback stopped watching.
+    bool update (int timeoutMilliseconds, ChangeCallback* callback, void* userData);
+
+    // The current matches, with whether each is a directory.
+    const std::map<std::wstring, bool>& matches() const { return m_matches; }
+
+    // The number of directories being watched.
+    size_t watchedDirectories() const { return m_watcher.size(); }
+
+    // Counters accumulated over every match so far.
+    const MatchStats& stats() const { return m_stats; }
+
+    // After a change, further changes arriving within this time are folded into the same update,
+    // so that a burst of changes is matched once.
+    static const int mc_SettleMilliseconds = 50;
+
+  private:
+
+    bool rematch (ChangeCallback* callback, void* userData, bool recheck);
+
+    static bool matchCallback (
+        const std::filesystem::path& path, const std::filesystem::directory_entry& dirEntry, void* userData);
+    static void directoryCallback (const std::filesystem::path& directory, void* userData);
+
+    std::vector<std::wstring>        m_patterns;
+    DirectoryCache                   m_cache;         // Listings of directories already read
+    PathMatcher                      m_matcher;
+    DirectoryWatcher                 m_watcher;
+    std::map<std::wstring, bool>     m_matches;       // Current matches, and whether directories
+    std::map<std::wstring, bool>     m_newMatches;    // Matches found by the match in progress
+    std::set<std::filesystem::path>  m_directories;   // Directories the match in progress reached
+    MatchStats                       m_stats;
+};
+
+}; // Namespace PathMatch
+
+
+#endif  // _INCLUDED_PATHWATCHER_H
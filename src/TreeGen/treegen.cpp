@@ -0,0 +1,229 @@
+//==================================================================================================
+// treegen.cpp
+//
+// Implementation of the synthetic directory tree generator.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include "treegen.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+
+// =================================================================================================
+// Local Helper Functions
+// =================================================================================================
+
+namespace {
+
+    class SplitMix64
+    {
+        // A small, fully specified random number generator. The standard library distributions
+        // differ between implementations, so they're avoided here to keep trees identical across
+        // platforms.
+
+      public:
+
+        explicit SplitMix64 (uint64_t seed) : m_state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (m_state += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            return z ^ (z >> 31);
+        }
+
+        // Returns a value in the range [low, high].
+        int range (int low, int high) {
+            return low + static_cast<int>(next() % static_cast<uint64_t>(high - low + 1));
+        }
+
+        // Returns true with the given probability.
+        bool chance (double probability) {
+            return (next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+        }
+
+      private:
+
+        uint64_t m_state;
+    };
+
+    const wchar_t c_nameChars[] = L"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+    const wchar_t* const c_extensions[] { L".cpp", L".h", L".txt", L".obj", L".md", L"" };
+
+    // Random names that collide this many times in a row are made unique with a numeric suffix,
+    // since the name lengths allowed may not give enough distinct names for a directory.
+    const int c_maxNameAttempts = 64;
+
+
+    class Generator
+    {
+      public:
+
+        Generator (const PathMatchTest::TreeOptions& options)
+          : m_options(options), m_random(options.seed)
+        {
+            m_fileData.assign(options.fileSize, 'x');
+        }
+
+        PathMatchTest::TreeStats run (const fs::path& root) {
+            fs::create_directories(root);
+            fillDirectory(root, 0);
+            return m_stats;
+        }
+
+      private:
+
+        //------------------------------------------------------------------------------------------
+        wstring uniqueName (unordered_set<wstring>& used, bool isFile)
+        {
+            // Return a random name not yet used in the current directory. Names are compared
+            // without regard to case, since the tree may live on a case-insensitive file system.
+            // If random names keep colliding, the last one gets a numeric suffix (ahead of any
+            // extension) that makes it unique.
+
+            wstring stem;
+            wstring extension;
+
+            for (int attempt = 0;  attempt < c_maxNameAttempts;  ++attempt) {
+                auto length = m_random.range(m_options.minNameLength, m_options.maxNameLength);
+
+                stem.assign(1, c_nameChars[m_random.range(0, 51)]);   // Always start with a letter.
+                for (int i = 1;  i < length;  ++i)
+                    stem += c_nameChars[m_random.range(0, size(c_nameChars) - 2)];
+
+                extension = isFile ? c_extensions[m_random.range(0, size(c_extensions) - 1)] : L"";
+
+                if (used.insert(foldCase(stem + extension)).second)
+                    return stem + extension;
+            }
+
+            for (size_t suffix = 1;  ;  ++suffix) {
+                auto name = stem + L'_' + to_wstring(suffix) + extension;
+                if (used.insert(foldCase(name)).second)
+                    return name;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        static wstring foldCase (wstring name)
+        {
+            transform(name.begin(), name.end(), name.begin(), towlower);
+            return name;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool hasRoom() const
+        {
+            // Returns false once the entry limit has been reached.
+            return (m_stats.directories + m_stats.files) < m_options.maxEntries;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void createFile (const fs::path& path)
+        {
+            ofstream file (path, ios::binary);
+            if (!file)
+                throw fs::filesystem_error("Couldn't create file", path, make_error_code(errc::io_error));
+            file.write(m_fileData.data(), static_cast<streamsize>(m_fileData.size()));
+            ++m_stats.files;
+            m_stats.bytes += m_fileData.size();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void fillDirectory (const fs::path& dir, int level)
+        {
+            // Fill the directory with entries, descending depth first. The first few directories
+            // visited (in this order) are the large directories.
+
+            unordered_set<wstring> used;
+            vector<fs::path> subdirs;
+
+            auto isLarge = (m_directoryIndex++ < static_cast<size_t>(m_options.largeDirs));
+            auto entryCount = m_options.fanout + (isLarge ? m_options.largeDirSize : 0);
+
+            for (int i = 0;  i < entryCount && hasRoom();  ++i) {
+                auto isDir = (level < m_options.depth) && (i < m_options.fanout)
+                          && m_random.chance(m_options.dirRatio);
+
+                auto path = dir / uniqueName(used, !isDir);
+
+                if (isDir) {
+                    fs::create_directory(path);
+                    ++m_stats.directories;
+                    subdirs.push_back(path);
+                } else {
+                    createFile(path);
+                }
+            }
+
+            for (const auto& subdir : subdirs)
+                fillDirectory(subdir, level + 1);
+        }
+
+        const PathMatchTest::TreeOptions& m_options;
+        SplitMix64               m_random;
+        PathMatchTest::TreeStats m_stats;
+        size_t                   m_directoryIndex {0};
+        string                   m_fileData;
+    };
+}
+
+
+// =================================================================================================
+// PathMatchTest Namespace
+// =================================================================================================
+
+namespace PathMatchTest {
+
+TreeStats generateTree (const fs::path& root, const TreeOptions& options)
+{
+    return Generator(options).run(root);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+wstring describeTree (const TreeOptions& options)
+{
+    wostringstream description;
+
+    description << L"seed " << options.seed << L", depth " << options.depth
+                << L", fanout " << options.fanout << L", dirRatio " << options.dirRatio
+                << L", names " << options.minNameLength << L'-' << options.maxNameLength
+                << L", largeDirs " << options.largeDirs << L" (+" << options.largeDirSize << L" files)"
+                << L", fileSize " << options.fileSize;
+
+    return description.str();
+}
+
+}; // Namespace PathMatchTest
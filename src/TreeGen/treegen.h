@@ -0,0 +1,76 @@
+#ifndef _INCLUDED_TREEGEN_H
+//==================================================================================================
+// treegen.h
+//
+// Declarations for the synthetic directory tree generator. Trees are generated deterministically
+// from a seed, so that traversal benchmarks can be repeated on identical trees, on any file system.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+#define _INCLUDED_TREEGEN_H
+
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+
+namespace PathMatchTest
+{
+
+struct TreeOptions
+{
+    // Parameters that shape a generated tree. The same options always yield the same tree.
+
+    uint64_t seed {1};              // Random number seed
+    int      depth {4};             // Directory levels below the root
+    int      fanout {8};            // Entries in each ordinary directory
+    double   dirRatio {0.25};       // Fraction of entries that are directories (above the leaves)
+    int      minNameLength {3};     // Shortest entry name (not counting file extensions)
+    int      maxNameLength {12};    // Longest entry name (not counting file extensions)
+    int      largeDirs {0};         // Number of directories that get largeDirSize extra files
+    int      largeDirSize {10000};  // Extra files in each large directory
+    size_t   fileSize {0};          // Bytes written to each file
+    size_t   maxEntries {1000000};  // Limit on the total number of entries created
+};
+
+
+struct TreeStats
+{
+    size_t directories {0};   // Directories created (not counting the root)
+    size_t files {0};         // Files created
+    size_t bytes {0};         // Total bytes written to files
+};
+
+
+// Generate a tree under the given root directory, which is created if needed. Throws
+// std::filesystem::filesystem_error if an entry can't be created.
+TreeStats generateTree (const std::filesystem::path& root, const TreeOptions& options);
+
+// Returns a one-line description of the options, used to label a generated tree.
+std::wstring describeTree (const TreeOptions& options);
+
+}; // Namespace PathMatchTest
+
+
+#endif  // _INCLUDED_TREEGEN_H
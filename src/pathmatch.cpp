@@ -27,10 +27,20 @@
 // SOFTWARE.
 //==================================================================================================
 
+#include <pathindex.h>
 #include <pathmatcher.h>
+#include <pathmatchtrace.h>
+#include <patterncache.h>
+#include <ruleset.h>
+#include <pathserver.h>
+#include <pathwatcher.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 
 using namespace PathMatch;
@@ -60,6 +70,10 @@ usage    : pathmatch [<options>] <pattern> ... <pattern>
     "abc\def\ghi\jkl": "abc\d?f\??i\jkl", "abc\*\*\jkl", "abc\...\jkl", and
     "ab...kl".
 
+    Bracketed character classes such as '[a-z_]' or '[!.]' match any single
+    character in (or not in) the class, and brace groups such as
+    '{src,include}' match any one of their comma-separated alternatives.
+
     The following command options are supported:
 
 Command Options:
@@ -67,9 +81,35 @@ Command Options:
         Report absolute paths. By default, reported paths are relative to the
         current working directory.
 
+    --batch
+        Read queries from standard input, one per line, and answer them all in
+        a single run. Each query is a root directory, a pattern, and optional
+        query options (--files, --limit <count>), separated by tabs. The
+        results of each query are preceded by a line "= <count>" giving the
+        number of paths that follow, or are replaced by a line "! <message>"
+        if the query fails. Paths are reported relative to the query root.
+
+    --buildIndex <root> <fileName>
+        Write an index of the directory tree under <root> to the given file,
+        for use with the --index option.
+
+    --buildRules <fileName>
+        Compile the rules of the --ignore files into a rule file, which later
+        runs can give to --ignore in place of the original files. A rule file
+        loads in the same time however many rules it holds.
+
+    --client <socket>
+        Send the patterns to a pathmatch server listening on the given socket
+        (see --serve), and report the matches it returns.
+
     --debug, -D
         Turn on debugging output.
 
+    --dirProfile <count>
+        Print a histogram of directory open and read latencies to the standard
+        error stream at exit, followed by the <count> slowest and <count>
+        largest directories.
+
     --dirSlash, -d
         Print trailing slash for directory matches.
 
@@ -84,25 +124,61 @@ Command Options:
         Suppress output of files and directories that match rules inside a file
         of patterns. The special filename '--' reads from standard input, and
         may be specified for a single option only. The multiple file option
-        requires space-separated '(' and ')' delimiters
+        requires space-separated '(' and ')' delimiters. Rule files hold one
+        pattern per line; blank lines and lines starting with '#' are skipped.
+        A rule that ends in a slash matches directories only. A rule file
+        compiled by --buildRules may be given instead.
+
+    --index <fileName>
+        Answer patterns from an index file written by --buildIndex, rather
+        than from the file system. Results are those that would be reported
+        from the directory where the index was built, for entries within the
+        indexed tree.
 
     --limit <count>, -l<count>
         Limit output to the first <count> matches.
 
+    --refreshIndex <fileName>
+        Bring an index file written by --buildIndex up to date with the file
+        system. Only directories that have changed since the index was built
+        (or last refreshed) are read again. Run this from the directory where
+        the index was built.
+
+    --serve <socket>
+        Run as a server for the tree under the current directory, answering
+        pattern queries from --client on the given Unix domain socket. The
+        server keeps an index of the tree, and refreshes it when any directory
+        in the tree changes. Runs until stopped.
+
     --slash [/|\], -s[/|\]
         Specifies the slash direction to be reported. By default, slashes will
         be back slashes. Use "-s/" to report paths with forward slashes, "-s\"
         to report backslashes. A space is allowed before the slash.
 
+    --stats
+        Print traversal and matching statistics to the standard error stream
+        at exit.
+
     --stream <fileName>|( <file1> <file2> ... <fileN> )
         Apply patterns against input stream of filenames. The special filename
         '--' reads filenames from standard input, and may be specified for a
         single option only. The multiple file option requires space-separated
         '(' and ')' delimiters.
 
+    --trigrams
+        With --buildIndex, also write trigram posting lists to the index.
+        Index queries for patterns with literal text (such as "...foo*bar...")
+        then test only the entries whose paths contain that text.
+
     --version, -v
         Print version information.
 
+    --watch
+        After reporting the matching entries, keep watching the directories
+        that the patterns reach, and report each entry that comes to match as
+        "+ <path>", and each entry that no longer matches as "- <path>". Runs
+        until interrupted.
+
 )";
 
 struct CommandParameters
@@ -113,6 +189,9 @@ struct CommandParameters
     bool printVersion {false};     // Print version information and exit.
 
     bool debug {false};            // Print debug information
+    bool stats {false};            // Print traversal and matching statistics at exit
+    int  dirProfile {-1};          // If non-negative, print the directory latency profile at exit,
+                                   // with this many slowest and largest directories
 
     bool    dirSlash {false};      // Print directories with trailing slashes
     wchar_t slashChar {L'/'};      // Forward or backward slash character to use
@@ -121,12 +200,36 @@ struct CommandParameters
     int     limit {0};             // If positive, then maximum number of matches to print, else unlimited
     size_t  maxPathLength {0};     // Maximum path length
 
+    wstring buildIndexRoot;        // Root of the tree to index
+    wstring buildIndexFile;        // Index file to write
+    bool    trigrams {false};      // Include trigram posting lists in a built index
+    wstring refreshIndexFile;      // Index file to refresh
+    wstring buildRulesFile;        // Rule file to compile the ignore rules into
+    wstring indexFile;             // Index file to answer patterns from
+    bool    watch {false};         // Keep reporting changes to the matches
+    bool    batch {false};         // Answer queries read from standard input
+    wstring serveSocket;           // Socket to serve queries on
+    wstring clientSocket;          // Socket of the server to query
+
     vector<wstring> streamSources; // Source of file paths to match
     vector<wstring> ignoreFiles;   // Files with patterns to ignore
     vector<wstring> patterns;      // Patterns to match
 };
 
 
+struct OutputStats
+{
+    // Counts of the output written by the match callback.
+
+    uint64_t matchesEmitted {0};   // Matching entries printed
+    uint64_t bytesWritten {0};     // Bytes of output (UTF-8)
+};
+
+OutputStats outputStats;
+
+vector<std::unique_ptr<RuleSet>> ignoreRules;   // Rules of the paths not to report
+
+
 inline bool isSlash (wchar_t c) {
     // Return true if the given character is a forward or backward slash.
     return (c == L'/') || (c == L'\\');
@@ -236,15 +339,63 @@ bool parseArguments (CommandParameters& params, int argc, wchar_t *argv[])
                 if (equal(optionWord, L"absolute")) {
                     params.absolute = true;
 
+                } else if (equal(optionWord, L"batch")) {
+                    params.batch = true;
+
+                } else if (equal(optionWord, L"buildIndex")) {
+                    if (argi + 2 >= argc) {
+                        wcerr << L"pathmatch: missing arguments for '--buildIndex' option.\n";
+                        return false;
+                    }
+                    params.buildIndexRoot = argv[++argi];
+                    params.buildIndexFile = argv[++argi];
+
+                } else if (equal(optionWord, L"buildRules")) {
+                    if (++argi >= argc) {
+                        wcerr << L"pathmatch: missing argument for '--buildRules' option.\n";
+                        return false;
+                    }
+                    params.buildRulesFile = argv[argi];
+
                 } else if (equal(optionWord, L"debug")) {
                     params.debug = true;
 
+                } else if (equal(optionWord, L"dirProfile")) {
+                    if (++argi >= argc) {
+                        wcerr << L"pathmatch: missing argument for '--dirProfile' option.\n";
+                        return false;
+                    }
+                    params.dirProfile = std::max(0, _wtoi(argv[argi]));
+
                 } else if (equal(optionWord, L"dirSlash")) {
                     params.dirSlash = true;
 
                 } else if (equal(optionWord, L"files")) {
                     params.filesOnly = true;
 
+                } else if (equal(optionWord, L"stats")) {
+                    params.stats = true;
+
+                } else if (equal(optionWord, L"serve")) {
+                    if (++argi >= argc) {
+                        wcerr << L"pathmatch: missing argument for '--serve' option.\n";
+                        return false;
+                    }
+                    params.serveSocket = argv[argi];
+
+                } else if (equal(optionWord, L"client")) {
+                    if (++argi >= argc) {
+                        wcerr << L"pathmatch: missing argument for '--client' option.\n";
+                        return false;
+                    }
+                    params.clientSocket = argv[argi];
+
+                } else if (equal(optionWord, L"watch")) {
+                    params.watch = true;
+
+                } else if (equal(optionWord, L"trigrams")) {
+                    params.trigrams = true;
+
                 } else if (equal(optionWord, L"stream")) {
                     if (++argi >= argc) {
                         wcerr << L"pathmatch: missing argument for '--stream' option.\n";
@@ -278,6 +429,20 @@ bool parseArguments (CommandParameters& params, int argc, wchar_t *argv[])
                         }
                     }
 
+                } else if (equal(optionWord, L"index")) {
+                    if (++argi >= argc) {
+                        wcerr << L"pathmatch: missing argument for '--index' option.\n";
+                        return false;
+                    }
+                    params.indexFile = argv[argi];
+
+                } else if (equal(optionWord, L"refreshIndex")) {
+                    if (++argi >= argc) {
+                        wcerr << L"pathmatch: missing argument for '--refreshIndex' option.\n";
+                        return false;
+                    }
+                    params.refreshIndexFile = argv[argi];
+
                 } else if (equal(optionWord, L"help")) {
                     params.printHelp = true;
                     return true;
@@ -346,12 +511,24 @@ void printParameters (const CommandParameters& params)
     wcout << L"       printHelp: " << boolValue(params.printHelp);
     wcout << L"    printVersion: " << boolValue(params.printVersion);
     wcout << L"           debug: " << boolValue(params.debug);
+    wcout << L"           stats: " << boolValue(params.stats);
+    wcout << L"      dirProfile: " << params.dirProfile << L'\n';
     wcout << L"        dirSlash: " << boolValue(params.dirSlash);
     wcout << L"        absolute: " << boolValue(params.absolute);
     wcout << L"       filesOnly: " << boolValue(params.filesOnly);
     wcout << L"       slashChar: " << params.slashChar << L'\n';
     wcout << L"           limit: " << params.limit << L'\n';
     wcout << L"   maxPathLength: " << params.maxPathLength << L'\n';
+    wcout << L"  buildIndexRoot: " << params.buildIndexRoot << L'\n';
+    wcout << L"  buildIndexFile: " << params.buildIndexFile << L'\n';
+    wcout << L"        trigrams: " << boolValue(params.trigrams);
+    wcout << L"refreshIndexFile: " << params.refreshIndexFile << L'\n';
+    wcout << L"  buildRulesFile: " << params.buildRulesFile << L'\n';
+    wcout << L"       indexFile: " << params.indexFile << L'\n';
+    wcout << L"           watch: " << boolValue(params.watch);
+    wcout << L"           batch: " << boolValue(params.batch);
+    wcout << L"     serveSocket: " << params.serveSocket << L'\n';
+    wcout << L"    clientSocket: " << params.clientSocket << L'\n';
     wcout << L"     ignoreFiles: "; printWordList(params.ignoreFiles); wcout << L'\n';
     wcout << L"   streamSources: "; printWordList(params.streamSources); wcout << L'\n';
     wcout << L"        patterns: "; printWordList(params.patterns); wcout << L'\n';
@@ -359,6 +536,227 @@ void printParameters (const CommandParameters& params)
 }
 
 
+//--------------------------------------------------------------------------------------------------
+size_t utf8Length (const wstring& str)
+{
+    // Return the number of bytes needed to encode the string in UTF-8. Surrogate pairs (on
+    // platforms with 16-bit wchar_t) take four bytes, or two bytes per half.
+
+    size_t length = 0;
+
+    for (auto c : str) {
+        auto code = static_cast<uint32_t>(c);
+        length += (code < 0x80) ? 1 : (code < 0x800) ? 2 : (code < 0xd800 || code >= 0xe000) ? 3 : 2;
+        if (code > 0xffff)
+            ++length;
+    }
+
+    return length;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void printIndexStats (const wchar_t* operation, const IndexBuildStats& stats)
+{
+    // Print the statistics of an index build or refresh to the standard error stream.
+
+    wcerr << L"pathmatch index " << operation << L":\n";
+    wcerr << L"            directories: " << stats.directories << L'\n';
+    wcerr << L"                  files: " << stats.files << L'\n';
+    wcerr << L"     directories listed: " << stats.directoriesListed << L'\n';
+    wcerr << L"     directories reused: " << stats.directoriesReused << L'\n';
+    wcerr << L"             index size: " << stats.bytes << L" bytes\n";
+}
+
+//--------------------------------------------------------------------------------------------------
+void printStats (const MatchStats& stats, const PatternCache& patterns, const DirectoryCache* cache)
+{
+    // Print the accumulated match statistics, the pattern cache counters, and the directory cache
+    // counters (if a directory cache was used) to the standard error stream.
+
+    auto milliseconds = [](double seconds) { return seconds * 1000.0; };
+
+    const auto& prefilter = stats.prefilter;
+
+    wcerr << L"pathmatch statistics:\n";
+    wcerr << L"     directories opened: " << stats.directoriesOpened << L'\n';
+    wcerr << L"           entries read: " << stats.entriesRead << L'\n';
+    wcerr << L"             stat calls: " << stats.statCalls << L'\n';
+    wcerr << L"      prefilter rejects: " << prefilter.rejected << L" of " << prefilter.tested
+          << L" tested\n";
+    wcerr << L"     full match rejects: " << (prefilter.fullTests - prefilter.fullMatches)
+          << L" of " << prefilter.fullTests << L" tested\n";
+    wcerr << L"       matches reported: " << stats.matchesReported << L'\n';
+    wcerr << L"        matches emitted: " << outputStats.matchesEmitted << L'\n';
+    wcerr << L"          bytes written: " << outputStats.bytesWritten << L'\n';
+    wcerr << L"        peak path depth: " << stats.peakDepth << L'\n';
+
+    auto patternStats = patterns.stats();
+    wcerr << L"     pattern cache hits: " << patternStats.hits << L" of "
+          << (patternStats.hits + patternStats.misses) << L" patterns\n";
+
+    if (cache) {
+        const auto& cacheStats = cache->stats();
+        auto entryHits = cacheStats.entryHits + cacheStats.negativeHits;
+        wcerr << L"     listing cache hits: " << cacheStats.listingHits << L" of "
+              << (cacheStats.listingHits + cacheStats.listingMisses) << L" listings\n";
+        wcerr << L"       entry cache hits: " << entryHits << L" of "
+              << (entryHits + cacheStats.entryMisses) << L" lookups ("
+              << cacheStats.negativeHits << L" missing)\n";
+        wcerr << L"  cache records dropped: " << cacheStats.invalidations << L" changed, "
+              << cacheStats.evictions << L" evicted\n";
+    }
+
+    wcerr << std::fixed << std::setprecision(3);
+    wcerr << L"           compile time: " << milliseconds(stats.compileWallSeconds) << L" ms wall, "
+          << milliseconds(stats.compileCpuSeconds) << L" ms CPU\n";
+    wcerr << L"          traverse time: " << milliseconds(stats.traverseWallSeconds) << L" ms wall, "
+          << milliseconds(stats.traverseCpuSeconds) << L" ms CPU\n";
+}
+
+
+//--------------------------------------------------------------------------------------------------
+wstring durationString (double seconds)
+{
+    // Format a duration in microseconds, milliseconds or seconds, whichever suits its size.
+
+    std::wostringstream out;
+    out << std::fixed;
+
+    if (seconds < 1e-3)
+        out << std::setprecision(0) << seconds * 1e6 << L" us";
+    else if (seconds < 1.0)
+        out << std::setprecision(3) << seconds * 1e3 << L" ms";
+    else
+        out << std::setprecision(3) << seconds << L" s";
+
+    return out.str();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void printDirectoryProfile (const DirectoryProfile& profile)
+{
+    // Print the directory latency histogram, and the slowest and largest directories, to the
+    // standard error stream.
+
+    wcerr << L"pathmatch directory profile:\n";
+    wcerr << L"    directories read: " << profile.directories() << L", "
+          << durationString(profile.totalSeconds()) << L" total\n";
+
+    // Print the histogram from the first to the last non-empty bucket, with bars scaled to the
+    // fullest bucket.
+
+    const auto& histogram = profile.histogram();
+
+    size_t first = 0;
+    size_t last  = histogram.size();
+    while (first < last && histogram[first] == 0) ++first;
+    while (last > first && histogram[last - 1] == 0) --last;
+
+    uint64_t peak = 0;
+    for (auto count : histogram)
+        peak = std::max(peak, count);
+
+    if (first < last)
+        wcerr << L"\n    latency (open + read):\n";
+
+    for (auto bucket = first;  bucket < last;  ++bucket) {
+        wstring range;
+        if (bucket == 0)
+            range = L"< " + durationString(DirectoryProfile::bucketLimit(0));
+        else if (bucket + 1 == histogram.size())
+            range = L">= " + durationString(DirectoryProfile::bucketLimit(bucket - 1));
+        else
+            range = L"< " + durationString(DirectoryProfile::bucketLimit(bucket));
+
+        auto barLength = static_cast<size_t>((40 * histogram[bucket] + peak - 1) / peak);
+
+        wcerr << L"    " << std::setw(14) << range << L"  " << std::setw(8) << histogram[bucket]
+              << L"  " << wstring(barLength, L'#') << L'\n';
+    }
+
+    auto slowest = profile.slowest();
+    if (!slowest.empty()) {
+        wcerr << L"\n    slowest directories:\n";
+        for (const auto& timing : slowest) {
+            wcerr << L"    " << std::setw(12) << durationString(timing.totalSeconds())
+                  << L"  (open " << durationString(timing.openSeconds) << L", "
+                  << timing.entries << L" entries)  " << timing.path << L'\n';
+        }
+    }
+
+    auto largest = profile.largest();
+    if (!largest.empty()) {
+        wcerr << L"\n    largest directories:\n";
+        for (const auto& timing : largest) {
+            wcerr << L"    " << std::setw(12) << timing.entries << L" entries  ("
+                  << durationString(timing.totalSeconds()) << L")  " << timing.path << L'\n';
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool readIgnoreRules (const wstring& source, vector<wstring>& rules, wstring& error)
+{
+    // Read the text rules of an ignore source, which is either a file or '--' for the standard
+    // input stream. Returns false and sets the error message if the source can't be read.
+
+    if (source != L"--")
+        return RuleSet::readRules(source, rules, error);
+
+    wstring line;
+
+    while (std::getline(std::wcin, line)) {
+        if (!line.empty() && line.back() == L'\r')
+            line.pop_back();
+        if (!line.empty() && line[0] != L'#')
+            rules.push_back(line);
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool loadIgnoreRules (const CommandParameters& params, wstring& error)
+{
+    // Load the rule set of each ignore source. Returns false and sets the error message if any
+    // source can't be read.
+
+    for (const auto& source : params.ignoreFiles) {
+        auto rules = std::make_unique<RuleSet>();
+
+        if (source == L"--") {
+            vector<wstring> ruleList;
+            readIgnoreRules(source, ruleList, error);
+            rules->assign(ruleList);
+        } else if (!rules->open(source, error)) {
+            return false;
+        }
+
+        ignoreRules.push_back(std::move(rules));
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool isIgnored (const wstring& path, bool isDirectory)
+{
+    // Return true if the path matches any of the ignore rules.
+
+    for (const auto& rules : ignoreRules) {
+        if (rules->matches(path, isDirectory))
+            return true;
+    }
+
+    return false;
+}
+
+
 //--------------------------------------------------------------------------------------------------
 bool mtCallback (
     const fs::path& path,
@@ -393,7 +791,14 @@ bool mtCallback (
     // TODO: Handle absolute and relative paths (reportOpts->absolute).
     // TODO: Handle desired slash character (reportOpts->slashChar).
 
-    wcout << path.wstring() << L'\n';
+    auto pathString = path.wstring();
+
+    if (isIgnored(pathString, isDirectory))
+        return true;
+    wcout << pathString << L'\n';
+
+    ++outputStats.matchesEmitted;
+    outputStats.bytesWritten += utf8Length(pathString) + 1;
 
     #if 0
     if (!params->absolute)
@@ -427,6 +832,217 @@ bool mtCallback (
 }
 
 
+//--------------------------------------------------------------------------------------------------
+bool indexCallback (const wstring& path, bool isDirectory, void* cbdata)
+{
+    // This is the callback function for PathIndex queries. It reports matches the same way as
+    // mtCallback, but takes the entry type from the index rather than from the file system.
+
+    auto params = static_cast<const CommandParameters*>(cbdata);
+
+    if (params->filesOnly && isDirectory)
+        return true;
+
+    if (isIgnored(path, isDirectory))
+        return true;
+
+    wcout << path << L'\n';
+
+    ++outputStats.matchesEmitted;
+    outputStats.bytesWritten += utf8Length(path) + 1;
+
+    return true;   // Continue enumeration.
+}
+
+
+//--------------------------------------------------------------------------------------------------
+struct WatchReport
+{
+    // The callback data for watch mode reports.
+
+    const CommandParameters* params;
+    bool started {false};         // False while reporting the initial matches
+};
+
+bool watchCallback (const wstring& path, bool isDirectory, bool added, void* cbdata)
+{
+    // This is the callback function for PathWatcher changes. The initial matches are reported
+    // plainly; later changes are marked as added or removed.
+
+    auto report = static_cast<const WatchReport*>(cbdata);
+
+    if (report->params->filesOnly && isDirectory)
+        return true;
+
+    if (isIgnored(path, isDirectory))
+        return true;
+
+    if (report->started)
+        wcout << (added ? L"+ " : L"- ");
+
+    wcout << path << L'\n';
+
+    ++outputStats.matchesEmitted;
+    outputStats.bytesWritten += utf8Length(path) + 1 + (report->started ? 2 : 0);
+
+    return true;   // Continue watching.
+}
+
+
+//--------------------------------------------------------------------------------------------------
+struct BatchQuery
+{
+    // A query record read in batch mode.
+
+    wstring root;               // Directory to match from (relative to the starting directory)
+    wstring pattern;            // Pattern to match
+    bool    filesOnly {false};  // If true, report only files (not directories)
+    int     limit {0};          // If positive, then maximum number of matches to report
+
+    size_t  matches {0};        // Matches gathered so far
+    wstring* output {nullptr};  // Buffer for the gathered matches
+};
+
+
+//--------------------------------------------------------------------------------------------------
+bool parseBatchQuery (const wstring& line, BatchQuery& query, wstring& error)
+{
+    // Parse a batch query record: a root directory, a pattern and optional query options,
+    // separated by tabs. The options are separated by spaces. Returns false and sets the error
+    // message if the record is malformed.
+
+    vector<wstring> fields;
+    size_t start = 0;
+
+    for (;;) {
+        auto tab = line.find(L'\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == wstring::npos)
+            break;
+        start = tab + 1;
+    }
+
+    if (fields.size() < 2 || fields.size() > 3 || fields[1].empty()) {
+        error = L"Expected <root> <tab> <pattern> [<tab> <options>]";
+        return false;
+    }
+
+    query.root    = fields[0];
+    query.pattern = fields[1];
+
+    if (fields.size() < 3)
+        return true;
+
+    std::wistringstream options (fields[2]);
+    wstring option;
+
+    while (options >> option) {
+        if (equal(option.c_str(), L"--files") || equal(option.c_str(), L"-f")) {
+            query.filesOnly = true;
+        } else if (equal(option.c_str(), L"--limit") || equal(option.c_str(), L"-l")) {
+            if (!(options >> option)) {
+                error = L"Missing argument for '--limit' query option";
+                return false;
+            }
+            query.limit = std::max(0, _wtoi(option.c_str()));
+        } else {
+            error = L"Unrecognized query option (" + option + L")";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+bool batchCallback (
+    const fs::path& path,
+    const fs::directory_entry& dirEntry,
+    void* cbdata)
+{
+    // This is the callback function for batch queries. Matches are gathered into the output
+    // buffer, so that the query's results can be preceded by their count. Enumeration stops once
+    // the query's limit is reached.
+
+    auto& query = *static_cast<BatchQuery*>(cbdata);
+
+    std::error_code errorCode;
+    auto isDirectory = dirEntry.is_directory(errorCode);
+
+    if (query.filesOnly && isDirectory)
+        return true;
+
+    auto pathString = path.wstring();
+
+    if (isIgnored(pathString, isDirectory))
+        return true;
+
+    query.output->append(pathString);
+    query.output->push_back(L'\n');
+    ++query.matches;
+
+    return (query.limit <= 0) || (query.matches < static_cast<size_t>(query.limit));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void runBatch (PathMatcher& matcher, MatchStats& stats)
+{
+    // Answer the queries read from standard input until the end of input. All queries share one
+    // matcher (with its pattern and directory caches) and one output buffer. Each query is matched
+    // from its root directory, so that its results are the same as a separate run of pathmatch
+    // from there. The results of each query are written and flushed as soon as the query
+    // completes, so that a caller can feed queries one at a time.
+
+    auto startDirectory = fs::current_path();
+
+    wstring output;   // Matches of the current query
+    wstring line;
+
+    auto fail = [](const wstring& message) {
+        wcout << L"! " << message << L'\n' << std::flush;
+        outputStats.bytesWritten += utf8Length(message) + 3;
+    };
+
+    while (std::getline(std::wcin, line)) {
+        if (!line.empty() && line.back() == L'\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        BatchQuery query;
+        wstring error;
+
+        if (!parseBatchQuery(line, query, error)) {
+            fail(error);
+            continue;
+        }
+
+        std::error_code errorCode;
+        fs::current_path(startDirectory / query.root, errorCode);
+        if (errorCode) {
+            fail(L"Unable to change to root directory \"" + query.root + L"\"");
+            continue;
+        }
+
+        output.clear();
+        query.output = &output;
+        matcher.match (query.pattern, &batchCallback, &query);
+        stats += matcher.stats();
+
+        auto header = L"= " + std::to_wstring(query.matches) + L'\n';
+        wcout << header << output << std::flush;
+
+        outputStats.matchesEmitted += query.matches;
+        outputStats.bytesWritten += utf8Length(header) + utf8Length(output);
+    }
+
+    std::error_code errorCode;
+    fs::current_path(startDirectory, errorCode);
+}
+
+
 //--------------------------------------------------------------------------------------------------
 #ifndef MS_STDLIB_BUGS
     #if ( _MSC_VER || __MINGW32__ || __MSVCRT__ )
@@ -480,6 +1096,7 @@ int wmain (int argc, wchar_t *argv[])
 
     if (params.debug) {
         printParameters(params);
+        setTrace(&wcerr, TraceLevel::Info);
     }
 
     if (params.printHelp) {
@@ -492,9 +1109,163 @@ int wmain (int argc, wchar_t *argv[])
         exit(0);
     }
 
+    if (!params.buildIndexFile.empty()) {
+        wstring error;
+        IndexBuildStats buildStats;
+        if (!PathIndex::build(params.buildIndexRoot, params.buildIndexFile, params.trigrams, error,
+                              &buildStats)) {
+            wcerr << L"pathmatch: " << error << L".\n";
+            exit(1);
+        }
+        if (params.stats)
+            printIndexStats(L"build", buildStats);
+    }
+
+    if (!params.refreshIndexFile.empty()) {
+        wstring error;
+        IndexBuildStats buildStats;
+        if (!PathIndex::refresh(params.refreshIndexFile, error, &buildStats)) {
+            wcerr << L"pathmatch: " << error << L".\n";
+            exit(1);
+        }
+        if (params.stats)
+            printIndexStats(L"refresh", buildStats);
+    }
+
+    if (params.batch && std::find(params.ignoreFiles.begin(), params.ignoreFiles.end(), L"--")
+                        != params.ignoreFiles.end()) {
+        wcerr << L"pathmatch: The '--batch' option can't be used with '--ignore --'.\n";
+        exit(1);
+    }
+
+    if (!params.buildRulesFile.empty()) {
+        // Compile the rules of all ignore sources into one rule set, which then serves as the
+        // ignore rules of this run.
+
+        vector<wstring> rules;
+        wstring error;
+
+        for (const auto& source : params.ignoreFiles) {
+            if (!readIgnoreRules(source, rules, error)) {
+                wcerr << L"pathmatch: " << error << L".\n";
+                exit(1);
+            }
+        }
+
+        auto ruleSet = std::make_unique<RuleSet>();
+        ruleSet->assign(rules);
+
+        if (!ruleSet->write(params.buildRulesFile, error)) {
+            wcerr << L"pathmatch: " << error << L".\n";
+            exit(1);
+        }
+
+        ignoreRules.push_back(std::move(ruleSet));
+
+    } else {
+        wstring error;
+        if (!loadIgnoreRules(params, error)) {
+            wcerr << L"pathmatch: " << error << L".\n";
+            exit(1);
+        }
+    }
+
+    PathIndex index;
+
+    if (!params.indexFile.empty()) {
+        wstring error;
+        if (!index.open(params.indexFile, error)) {
+            wcerr << L"pathmatch: " << error << L".\n";
+            exit(1);
+        }
+    }
+
+    if (!params.serveSocket.empty()) {
+        // The server is destroyed before exiting, so that it removes its socket and snapshot.
+
+        wstring error;
+        bool    served = PathServer(params.serveSocket).run(error);
+
+        if (!served) {
+            wcerr << L"pathmatch: " << error << L".\n";
+            exit(1);
+        }
+
+        exit(0);
+    }
+
+    if (!params.clientSocket.empty()) {
+        wstring error;
+
+        if (!PathServer::query(params.clientSocket, params.patterns, &indexCallback, &params, error)) {
+            wcerr << L"pathmatch: " << error << L".\n";
+            exit(1);
+        }
+
+        exit(0);
+    }
+
+    if (params.batch && (!params.patterns.empty() || !params.indexFile.empty() || params.watch)) {
+        wcerr << L"pathmatch: The '--batch' option reads its queries from standard input, and can't"
+                 L" be used with patterns, '--index' or '--watch'.\n";
+        exit(1);
+    }
+
+    if (params.watch) {
+        if (!params.indexFile.empty()) {
+            wcerr << L"pathmatch: The '--watch' option can't be used with '--index'.\n";
+            exit(1);
+        }
+
+        PathWatcher watcher (params.patterns);
+        WatchReport report { &params };
+
+        watcher.start(&watchCallback, &report);
+        wcout << std::flush;
+        report.started = true;
+
+        while (watcher.update(-1, &watchCallback, &report))
+            wcout << std::flush;
+
+        exit(0);
+    }
+
+    MatchStats stats;
+
+    // When more than one pattern is matched, directory listings are kept for reuse by later
+    // patterns.
+
+    PatternCache patternCache;
+    matcher.setPatternCache(&patternCache);
+
+    DirectoryCache cache;
+    auto useCache = params.batch || (params.indexFile.empty() && params.patterns.size() > 1);
+    if (useCache)
+        matcher.setDirectoryCache(&cache);
+
+    DirectoryProfile profile (std::max(0, params.dirProfile));
+    if (params.dirProfile >= 0)
+        matcher.setDirectoryProfile(&profile);
+
+    if (params.batch)
+        runBatch (matcher, stats);
+
     for (auto pattern: params.patterns) {
-        matcher.match (pattern, &mtCallback, &params);
+        if (params.indexFile.empty()) {
+            matcher.match (pattern, &mtCallback, &params);
+            stats += matcher.stats();
+        } else {
+            MatchStats indexStats;
+            index.match (*patternCache.plan(pattern), &indexCallback, &params, &indexStats);
+            stats += indexStats;
+        }
     }
 
+    if (params.stats)
+        printStats(stats, patternCache, useCache ? &cache : nullptr);
+
+    if (params.dirProfile >= 0)
+        printDirectoryProfile(profile);
+
     exit (0);
 }
@@ -0,0 +1,221 @@
+//==================================================================================================
+// treegen.cpp
+//
+// Command-line tool that generates a synthetic directory tree for pathmatch benchmarks. The tree is
+// fully determined by its options, so benchmarks can be repeated on identical trees, whether on
+// disk or on a RAM-backed file system.
+//
+//                                                                Copyright 2010-2026 Steve Hollasch
+//==================================================================================================
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//==================================================================================================
+
+#include <treegen.h>
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string>
+
+using namespace std;
+using namespace PathMatchTest;
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+const char usageString[] = R"(
+treegen: Generate a synthetic directory tree for pathmatch benchmarks
+usage  : treegen [<options>] <root>
+
+    Generates a tree of empty (or fixed-size) files and directories under the
+    given root directory. The same options always generate the same tree.
+
+Options:
+    --help, -h, /?        Print this help information
+    --seed <n>            Random number seed (default 1)
+    --depth <n>           Directory levels below the root (default 4)
+    --fanout <n>          Entries in each directory (default 8)
+    --dirRatio <f>        Fraction of entries that are directories (default 0.25)
+    --nameLength <n>-<m>  Range of entry name lengths (default 3-12)
+    --largeDirs <n>       Number of very large directories (default 0)
+    --largeDirSize <n>    Extra files in each large directory (default 10000)
+    --fileSize <n>        Bytes written to each file (default 0)
+    --maxEntries <n>      Limit on the total number of entries (default 1000000)
+)";
+
+//--------------------------------------------------------------------------------------------------
+bool parseInt (const char* value, int minimum, int& result)
+{
+    // Parse a whole decimal integer no less than the given minimum. Returns false if the value is
+    // malformed or out of range.
+
+    char* end;
+    errno = 0;
+    auto number = strtol(value, &end, 10);
+
+    if (end == value || *end != 0 || errno == ERANGE || number < minimum || number > INT_MAX)
+        return false;
+
+    result = static_cast<int>(number);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+template <typename Unsigned>
+bool parseUnsigned (const char* value, Unsigned& result)
+{
+    // Parse a whole, non-negative decimal integer. Returns false if the value is malformed or out
+    // of range.
+
+    char* end;
+    errno = 0;
+    auto number = strtoull(value, &end, 10);
+
+    if (!isdigit(static_cast<unsigned char>(*value)) || *end != 0 || errno == ERANGE
+        || number > numeric_limits<Unsigned>::max())
+        return false;
+
+    result = static_cast<Unsigned>(number);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool parseRatio (const char* value, double& result)
+{
+    // Parse a fraction in the range [0, 1]. Returns false if the value is malformed or out of range.
+
+    char* end;
+    auto number = strtod(value, &end);
+
+    if (end == value || *end != 0 || !(number >= 0 && number <= 1))
+        return false;
+
+    result = number;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool parseNameLength (const char* value, int& minimum, int& maximum)
+{
+    // Parse a name length "<n>" or a range "<n>-<m>", with 1 <= n <= m.
+
+    string text = value;
+    auto dash = text.find('-');
+
+    if (dash == string::npos) {
+        if (!parseInt(value, 1, minimum))
+            return false;
+        maximum = minimum;
+        return true;
+    }
+
+    return parseInt(text.substr(0, dash).c_str(), 1, minimum)
+        && parseInt(text.substr(dash + 1).c_str(), minimum, maximum);
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+    TreeOptions options;
+    const char* root = nullptr;
+
+    for (int i = 1;  i < argc;  ++i) {
+        auto option = argv[i];
+        auto value  = (i + 1 < argc) ? argv[i+1] : nullptr;
+
+        // Help is checked first, since it takes no value (and "/?" doesn't start with a dash).
+
+        if (0 == strcmp(option, "--help") || 0 == strcmp(option, "-h")
+            || 0 == strcmp(option, "/?")) {
+            cout << usageString;
+            return 0;
+        }
+
+        if (option[0] != '-') {
+            root = option;
+            continue;
+        }
+
+        if (!value) {
+            cerr << "treegen: Missing value for option " << option << ".\n";
+            return 1;
+        }
+
+        ++i;
+
+        bool valid;
+
+        if (0 == strcmp(option, "--seed"))
+            valid = parseUnsigned(value, options.seed);
+        else if (0 == strcmp(option, "--depth"))
+            valid = parseInt(value, 0, options.depth);
+        else if (0 == strcmp(option, "--fanout"))
+            valid = parseInt(value, 0, options.fanout);
+        else if (0 == strcmp(option, "--dirRatio"))
+            valid = parseRatio(value, options.dirRatio);
+        else if (0 == strcmp(option, "--nameLength"))
+            valid = parseNameLength(value, options.minNameLength, options.maxNameLength);
+        else if (0 == strcmp(option, "--largeDirs"))
+            valid = parseInt(value, 0, options.largeDirs);
+        else if (0 == strcmp(option, "--largeDirSize"))
+            valid = parseInt(value, 0, options.largeDirSize);
+        else if (0 == strcmp(option, "--fileSize"))
+            valid = parseUnsigned(value, options.fileSize);
+        else if (0 == strcmp(option, "--maxEntries"))
+            valid = parseUnsigned(value, options.maxEntries);
+        else {
+            cerr << "treegen: Unrecognized option " << option << ".\n" << usageString;
+            return 1;
+        }
+
+        if (!valid) {
+            cerr << "treegen: Invalid value '" << value << "' for option " << option << ".\n"
+                 << usageString;
+            return 1;
+        }
+    }
+
+    if (!root) {
+        cerr << usageString;
+        return 1;
+    }
+
+    try {
+        auto stats = generateTree(root, options);
+        wcout << L"Generated " << stats.directories << L" directories and " << stats.files
+              << L" files (" << describeTree(options) << L")\n";
+    } catch (const fs::filesystem_error& error) {
+        cerr << "treegen: " << error.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -78,7 +78,14 @@ REM ----------------------------------------------------------------------------
     set testOutput=%testOutDir%\%testName%.out
     echo>%testOutput% %testArgs%
     echo.>>%testOutput%
-    %pathmatch% %testArgs%>>%testOutput%
+
+    REM A test may supply its standard input in a file named after the test, with extension .in.
+    if not exist %testName%.in goto :noInput
+        %pathmatch% %testArgs% <%testName%.in >>%testOutput%
+        goto :ranTest
+    :noInput
+        %pathmatch% %testArgs%>>%testOutput%
+    :ranTest
 
     move >nul %testOutput% %testOutput%.original
     eol \n <%testOutput%.original >%testOutput%